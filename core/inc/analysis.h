@@ -0,0 +1,43 @@
+#ifndef __RND_GEN_CORE_ANALYSIS_H__
+#define __RND_GEN_CORE_ANALYSIS_H__
+
+#include "core.h"
+
+using namespace rnd_gen;
+
+// Exact output distribution of one evaluate() of a root Item, found by walking the
+// tree once instead of sampling. ItemRef targets are nodes of a DAG rather than
+// copies, so shared subtrees are only visited once. Chances are Rationals built from
+// the integer weights, so they are exact: the rarest leaf of a deep library never
+// rounds to zero, and a document gives the same answers on every platform.
+class Analysis {
+private:
+	typedef struct {
+		unsigned int to;
+		Rational share;
+	} edge;
+
+	const Item* _root;
+	vector<const Item*> _order;						// Topological: every node after all its users
+	hashmap<const Item*, unsigned int> _index;
+	vector<vector<edge>> _edges;
+	vector<bool> _choice;							// Picks one edge rather than taking all of them
+	vector<Rational> _expected;
+
+	unsigned int index_of(const Item* item) const;
+	void out_edges(const Item* item, vector<const Item*> &targets, vector<Rational> &shares) const;
+	void walk();
+public:
+	Analysis(const Item* root);
+	~Analysis();
+
+	const Item* root() const;
+	unsigned int size() const;
+	bool reaches(const Item* item) const;
+
+	Rational expected(const Item* item) const;
+	Rational probability(const Item* item) const;
+	vector<const Option*> leaves() const;
+};
+
+#endif // !__RND_GEN_CORE_ANALYSIS_H__
\ No newline at end of file
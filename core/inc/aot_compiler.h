@@ -0,0 +1,45 @@
+#ifndef __RND_GEN_CORE_AOT_COMPILER_H__
+#define __RND_GEN_CORE_AOT_COMPILER_H__
+
+#include "core.h"
+#include "aot_runtime.h"
+
+using namespace rnd_gen;
+
+// Flattens the trees under a set of Generator paths into the tables AotRuntime reads
+// and writes them out as a C++ translation unit. References are bound at compile time,
+// so they cost nothing at run time; shared subtrees and repeated literals are stored once.
+// Groups with only a few options are marked so the runtime picks them with a short
+// fixed scan instead of a binary search.
+class AotCompiler {
+private:
+	const Generator &_generator;
+	vector<aot_node> _nodes;
+	vector<unsigned int> _edges;
+	vector<unsigned long long> _sums;
+	string _pool;
+	hashmap<string, unsigned int> _literals;
+	hashmap<const Item*, unsigned int> _index;
+	vector<std::pair<string, unsigned int>> _entries;
+
+	static const Item* target(const Item* item);
+	static vector<const Item*> out_edges(const Item* item);
+	static void check_cycles(const Item* root);
+	unsigned int literal(const string &text);
+	unsigned int node_for(const Item* item, vector<const Item*> &pending);
+	void build(const Item* root);
+
+	static void write_literal(FILE* out, const string &text);
+public:
+	AotCompiler(const Generator &gen);
+	~AotCompiler();
+
+	void add_entry(const string &path);
+	unsigned int size() const;
+	void write(FILE* out, const string &table_name) const;
+	// The same tables write() emits, read in place so they can be run in this process.
+	// Valid while the compiler and `entries` live and no entry is added.
+	aot_table table(vector<aot_entry> &entries) const;
+};
+
+#endif // !__RND_GEN_CORE_AOT_COMPILER_H__
\ No newline at end of file
@@ -0,0 +1,113 @@
+#ifndef __RND_GEN_CORE_AOT_RUNTIME_H__
+#define __RND_GEN_CORE_AOT_RUNTIME_H__
+
+// Everything a translation unit written by AotCompiler needs at run time. It only
+// depends on the engine, so a client can ship generators without the XML loader or
+// the Item tree.
+#include "counter_engine.h"
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+enum aot_kind {
+	AOT_SEQUENCE,		// Every edge in order, like Item
+	AOT_DRAW,			// One edge by weight, like a Group with options
+	AOT_SMALL_DRAW		// AOT_DRAW over a handful of edges, picked without a search
+};
+
+typedef struct {
+	unsigned int text;			// Offset of the literal in the pool
+	unsigned int text_length;
+	unsigned int first;			// First edge
+	unsigned int count;
+	unsigned int kind;
+} aot_node;
+
+typedef struct {
+	const char* path;
+	unsigned int node;
+} aot_entry;
+
+// Tables are emitted as constexpr arrays, so all of this sits in read-only data.
+// For draw nodes, sums[first + i] is the total weight of edges 0..i.
+typedef struct {
+	const aot_node* nodes;
+	const unsigned int* edges;
+	const unsigned long long* sums;
+	const char* pool;
+	const aot_entry* entries;
+	unsigned int entry_count;
+} aot_table;
+
+// Produces the same results as Item::evaluate_at for the tree the table was compiled
+// from: nodes are visited in the same order and draws take the same values from the
+// engine. The compiler has already rejected cycles, so no budget is needed.
+class AotRuntime {
+private:
+	const aot_table &_table;
+	std::vector<unsigned int> _stack;
+
+	unsigned int draw(const aot_node &node, CounterEngine &rng) const {
+		const unsigned long long* sums = _table.sums + node.first;
+		unsigned long long target = rng.below(sums[node.count - 1]);
+		unsigned int low = 0, high = node.count - 1;
+		while (low < high) {
+			unsigned int mid = (low + high) / 2;
+			if (sums[mid] <= target) low = mid + 1;
+			else high = mid;
+		}
+		return _table.edges[node.first + low];
+	}
+
+	// Same pick as draw(): the number of running sums at or below the target is the
+	// index of the first one above it. The loop is short and has no data-dependent
+	// branch, so it compiles to a few compares and adds.
+	unsigned int small_draw(const aot_node &node, CounterEngine &rng) const {
+		const unsigned long long* sums = _table.sums + node.first;
+		unsigned long long target = rng.below(sums[node.count - 1]);
+		unsigned int low = 0;
+		for (unsigned int i = 0; i + 1 < node.count; i++) low += sums[i] <= target;
+		return _table.edges[node.first + low];
+	}
+public:
+	static const unsigned int NO_ENTRY = ~0u;
+
+	AotRuntime(const aot_table &table) : _table(table) { }
+
+	unsigned int find(const char* path) const {
+		for (unsigned int i = 0; i < _table.entry_count; i++) {
+			if (strcmp(_table.entries[i].path, path) == 0) return _table.entries[i].node;
+		}
+		return NO_ENTRY;
+	}
+
+	void evaluate_at(unsigned int root, unsigned long long seed, unsigned long long index, std::string &out) {
+		CounterEngine rng(seed, index);
+		out.clear();
+		_stack.clear();
+		_stack.push_back(root);
+		while (!_stack.empty()) {
+			const aot_node &node = _table.nodes[_stack.back()];
+			_stack.pop_back();
+			out.append(_table.pool + node.text, node.text_length);
+			if (node.kind == AOT_SMALL_DRAW) {
+				_stack.push_back(small_draw(node, rng));
+				continue;
+			}
+			if (node.kind == AOT_DRAW) {
+				_stack.push_back(draw(node, rng));
+				continue;
+			}
+			for (unsigned int i = node.count; i > 0; i--) _stack.push_back(_table.edges[node.first + i - 1]);
+		}
+	}
+
+	std::string evaluate_at(unsigned int root, unsigned long long seed, unsigned long long index) {
+		std::string ret;
+		evaluate_at(root, seed, index, ret);
+		return ret;
+	}
+};
+
+#endif // !__RND_GEN_CORE_AOT_RUNTIME_H__
\ No newline at end of file
@@ -0,0 +1,77 @@
+#ifndef __RND_GEN_CORE_ARENA_H__
+#define __RND_GEN_CORE_ARENA_H__
+
+#include "typedefs.h"
+
+#include <stddef.h>
+
+using namespace rnd_gen;
+
+// Bump allocator for per-result temporaries. Memory is only given back all at once
+// by reset(), which keeps every chunk for the next result, so a warmed-up arena never
+// touches the global allocator. One per thread; it does no locking.
+// Only the evaluator's child lists live here. Result text is appended straight to the
+// caller's string, which the batch and serve loops reuse from one result to the next,
+// and evaluation reads no attributes, so neither has temporaries to move.
+// Copying would free every chunk twice, so an Arena cannot be copied.
+class Arena {
+private:
+	static const size_t FIRST_CHUNK_SIZE = 64 * 1024;
+
+	typedef struct {
+		char* data;
+		size_t size;
+	} chunk;
+
+	vector<chunk> _chunks;
+	unsigned int _current;
+	size_t _used;					// Bytes taken from the current chunk
+	size_t _total;					// Bytes handed out since the last reset
+public:
+	Arena();
+	Arena(const Arena&) = delete;
+	~Arena();
+
+	Arena& operator=(const Arena&) = delete;
+
+	void* allocate(size_t size, size_t align);
+	void reset();
+
+	size_t used() const;
+	size_t capacity() const;
+};
+
+// Lets standard containers draw from an Arena; freeing is a no-op
+template<class T>
+class ArenaAllocator {
+private:
+	template<class U>
+	friend class ArenaAllocator;
+
+	Arena* _arena;
+public:
+	typedef T value_type;
+
+	ArenaAllocator(Arena &arena) : _arena(&arena) { }
+	template<class U>
+	ArenaAllocator(const ArenaAllocator<U> &other) : _arena(other._arena) { }
+
+	T* allocate(size_t count) {
+		return static_cast<T*>(_arena->allocate(count * sizeof(T), alignof(T)));
+	}
+	void deallocate(T*, size_t) { }
+
+	template<class U>
+	bool operator==(const ArenaAllocator<U> &other) const {
+		return _arena == other._arena;
+	}
+	template<class U>
+	bool operator!=(const ArenaAllocator<U> &other) const {
+		return _arena != other._arena;
+	}
+};
+
+template<class T>
+using arena_vector = std::vector<T, ArenaAllocator<T>>;
+
+#endif // !__RND_GEN_CORE_ARENA_H__
\ No newline at end of file
@@ -0,0 +1,82 @@
+#ifndef __RND_GEN_CORE_BATCH_H__
+#define __RND_GEN_CORE_BATCH_H__
+
+#include "core.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace rnd_gen;
+
+const unsigned int BATCH_BLOCK_SIZE = 4096;			// Results written out per block
+const unsigned int BATCH_SPLIT_SIZE = 256;			// Results per piece of a block another thread can steal
+const unsigned int BATCH_BLOCKS_PER_THREAD = 4;		// Blocks each thread may have in flight
+const unsigned long long MAX_THREADS = 1024;		// Most threads any command line may ask for
+
+enum output_format {
+	FORMAT_TEXT,
+	FORMAT_JSONL,
+	FORMAT_TSV,
+	FORMAT_BINARY
+};
+
+typedef struct {
+	string generator;
+	unsigned long long count;
+	unsigned long long seed;
+	unsigned int threads;
+	output_format format;
+	unsigned int formatters;		// Formatter threads; 0 runs the single-stage Batch
+	bool stats;						// Report per-stage throughput and stalls
+} batch_config;
+
+batch_config default_batch_config();
+bool parse_number(const char* text, unsigned long long max, unsigned long long &out);
+bool parse_number(const char* text, unsigned long long max, unsigned int &out);
+bool parse_format(const string &name, output_format &format);
+bool parse_batch_args(int argc, const char** argv, batch_config &config);
+void format_result(vector<char> &out, output_format format, unsigned long long index, const string &result);
+
+// Queues whole buffers and hands them to the kernel in as few writev() calls as it can
+class OutputWriter {
+private:
+	int _fd;
+	vector<const vector<char>*> _pending;
+	size_t _pending_size;
+public:
+	OutputWriter(int fd);
+	~OutputWriter();
+
+	void add(const vector<char>* buffer);
+	size_t pending() const;
+	void flush();
+};
+
+class Batch {
+private:
+	typedef struct {
+		vector<vector<char>> pieces;	// One buffer per BATCH_SPLIT_SIZE results
+		bool ready;
+	} block;
+
+	const Generator &_generator;
+	batch_config _config;
+	const Item* _item;
+	vector<block> _blocks;				// Ring of in-flight blocks, indexed by block % size
+	unsigned long long _block_count;
+	std::mutex _lock;
+	std::condition_variable _changed;
+	std::atomic<bool> _failed;
+
+	void generate(unsigned long long first, unsigned long long last, vector<char> &out) const;
+	void fill(Scheduler &pool, unsigned long long block_index);
+public:
+	Batch(const Generator &gen, const batch_config &config);
+	~Batch();
+
+	void run(int fd);
+};
+
+#endif // !__RND_GEN_CORE_BATCH_H__
\ No newline at end of file
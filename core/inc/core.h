@@ -1,7 +1,30 @@
 #pragma once
 
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "typedefs.h"
 #include "xml_wrapper.h"
-#include "gen_tree.h"
\ No newline at end of file
+#include "weight_tree.h"
+#include "rational.h"
+#include "string_pool.h"
+#include "arena.h"
+#include "factory_table.h"
+#include "lz.h"
+#include "bundle.h"
+#include "evaluator.h"
+#include "result_stream.h"
+#include "scheduler.h"
+#include "ring.h"
+#include "metrics.h"
+#include "gen_tree.h"
+#include "item_path.h"
+#include "deck.h"
+#include "server.h"
+#include "shm_ring.h"
+#include "batch.h"
+#include "pipeline.h"
+#include "analysis.h"
+#include "interner.h"
+#include "validator.h"
+#include "aot_compiler.h"
\ No newline at end of file
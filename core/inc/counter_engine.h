@@ -0,0 +1,89 @@
+#ifndef __RND_GEN_CORE_COUNTER_ENGINE_H__
+#define __RND_GEN_CORE_COUNTER_ENGINE_H__
+
+// Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3").
+// The stream for result #i of a run is a pure function of (seed, i), so any
+// result can be regenerated on its own and results can be produced in any order.
+class CounterEngine {
+private:
+	unsigned int _key[2];
+	unsigned int _counter[4];		// [0..1] stream index, [2..3] block within the stream
+	unsigned int _out[4];
+	unsigned int _used;				// 64-bit words of _out already handed out
+
+	static const unsigned int M0 = 0xD2511F53;
+	static const unsigned int M1 = 0xCD9E8D57;
+	static const unsigned int W0 = 0x9E3779B9;
+	static const unsigned int W1 = 0xBB67AE85;
+
+	void refill() {
+		unsigned int c[4] = { _counter[0], _counter[1], _counter[2], _counter[3] };
+		unsigned int k[2] = { _key[0], _key[1] };
+		for (int round = 0; round < 10; round++) {
+			unsigned long long p0 = (unsigned long long)M0 * c[0];
+			unsigned long long p1 = (unsigned long long)M1 * c[2];
+			unsigned int next[4] = {
+				(unsigned int)(p1 >> 32) ^ c[1] ^ k[0], (unsigned int)p1,
+				(unsigned int)(p0 >> 32) ^ c[3] ^ k[1], (unsigned int)p0
+			};
+			c[0] = next[0]; c[1] = next[1]; c[2] = next[2]; c[3] = next[3];
+			k[0] += W0;
+			k[1] += W1;
+		}
+		_out[0] = c[0]; _out[1] = c[1]; _out[2] = c[2]; _out[3] = c[3];
+		if (++_counter[2] == 0) ++_counter[3];
+		_used = 0;
+	}
+public:
+	typedef unsigned long long result_type;
+
+	CounterEngine() {
+		seek(0, 0);
+	}
+	CounterEngine(unsigned long long seed) {
+		seek(seed, 0);
+	}
+	CounterEngine(unsigned long long seed, unsigned long long index) {
+		seek(seed, index);
+	}
+
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return ~0ULL; }
+
+	void seek(unsigned long long seed, unsigned long long index) {
+		_key[0] = (unsigned int)seed;
+		_key[1] = (unsigned int)(seed >> 32);
+		_counter[0] = (unsigned int)index;
+		_counter[1] = (unsigned int)(index >> 32);
+		_counter[2] = _counter[3] = 0;
+		_used = 2;
+	}
+
+	// Starts at `block` of the stream rather than its beginning; each block is two results
+	void seek(unsigned long long seed, unsigned long long index, unsigned long long block) {
+		seek(seed, index);
+		_counter[2] = (unsigned int)block;
+		_counter[3] = (unsigned int)(block >> 32);
+	}
+
+	result_type operator()() {
+		if (_used == 2) refill();
+		result_type ret = ((result_type)_out[2 * _used] << 32) | _out[2 * _used + 1];
+		_used++;
+		return ret;
+	}
+
+	// Uniform in [0, bound), with the same answer on every platform and standard library
+	result_type below(result_type bound) {
+		result_type threshold = (0 - bound) % bound;
+		result_type r = (*this)();
+		while (r < threshold) r = (*this)();
+		return r % bound;
+	}
+
+	void discard(unsigned long long count) {
+		while (count-- > 0) (*this)();
+	}
+};
+
+#endif // !__RND_GEN_CORE_COUNTER_ENGINE_H__
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef __RND_GEN_CORE_DECK_H__
+#define __RND_GEN_CORE_DECK_H__
+
+#include "core.h"
+
+using namespace rnd_gen;
+
+// The drawn options by handle, so a snapshot survives slots moving in the Group
+typedef vector<item_handle> deck_state;
+
+// Draws options from a Group without replacement until reset, like a deck of cards.
+// The deck follows the Group's version. Reweights are replayed slot by slot, skipping
+// drawn slots; when options are added or removed it rebuilds from the Group, still
+// leaving out whatever was already drawn.
+class Deck {
+private:
+	const Group* _group;
+	unsigned long long _version;		// Group version _remaining was built from
+	WeightTree _remaining;
+	vector<unsigned int> _drawn;		// Group slots taken out since the last reset
+	vector<bool> _taken;				// By slot: whether _drawn holds it
+	deck_state _drawn_items;			// The options in those slots, to find them after a change
+
+	void sync();
+	void take(unsigned int slot);
+	void take(const deck_state &items);
+public:
+	Deck(const Group* group);
+	~Deck();
+
+	// Everything but group() catches up with the Group first, so none of it is const
+	const Group* group() const;
+	unsigned int drawn();
+	bool empty();
+	bool has(const Option* option);
+
+	const Option* draw(random_engine &rng);
+	vector<const Option*> draw(random_engine &rng, unsigned int count);
+	void remove(const Option* option);
+	void reset();
+
+	deck_state snapshot();
+	void restore(const deck_state &state);
+};
+
+#endif // !__RND_GEN_CORE_DECK_H__
\ No newline at end of file
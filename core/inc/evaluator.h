@@ -0,0 +1,44 @@
+#ifndef __RND_GEN_CORE_EVALUATOR_H__
+#define __RND_GEN_CORE_EVALUATOR_H__
+
+#include "core.h"
+
+using namespace rnd_gen;
+
+class Item;
+
+// Limits on a single result; zero means unlimited
+typedef struct {
+	unsigned long long max_nodes;		// Items visited, references included
+	unsigned long long max_bytes;		// Length of the output
+	unsigned int max_depth;				// Nesting, counting each reference as a level
+} eval_budget;
+
+eval_budget default_eval_budget();
+
+// Evaluates an Item without recursing: pending items sit on an explicit stack that
+// is kept between runs, and child lists come from an arena that is reset at the start
+// of each run, so a long-lived Evaluator stops allocating once it has seen its
+// largest result. Every Item::evaluate() and evaluate_at() runs through one.
+// Going over the budget throws instead of letting one result hold a worker.
+class Evaluator {
+private:
+	typedef struct {
+		const Item* item;
+		unsigned int depth;
+	} frame;
+
+	vector<frame> _stack;
+	Arena _arena;						// Temporaries of the current run
+	unsigned long long _nodes;
+public:
+	Evaluator();
+	~Evaluator();
+
+	void run(const Item* root, random_engine &rng, const eval_budget &budget, string &out);
+	string run(const Item* root, random_engine &rng, const eval_budget &budget);
+
+	unsigned long long nodes() const;		// Items visited by the last run
+};
+
+#endif // !__RND_GEN_CORE_EVALUATOR_H__
\ No newline at end of file
@@ -3,6 +3,8 @@
 
 #include "core.h"
 
+#include <atomic>
+
 using namespace rnd_gen;
 
 class Generator;
@@ -14,26 +16,75 @@ class Option;
 class OptionRef;
 class GroupOption;
 class GroupOptionRef;
+class ItemPath;
 
 typedef Item* (*item_factory)(Generator &gen, XMLNode &node);
 
+// Names an Item slot in its Generator; a stale handle to a reused slot resolves to null
+typedef struct {
+	unsigned int id;
+	unsigned int generation;
+} item_handle;
+
+template<class item_type>
+Item* item_factory_for_(Generator &gen, XMLNode &node) {
+	return new item_type(gen, node);
+}
+
+// Output length of one evaluation, filled in by Generator::measure()
+typedef struct {
+	unsigned long long min;
+	unsigned long long max;			// OUTPUT_UNBOUNDED if a reference cycle is reachable
+	double expected;
+} size_bounds;
+
+const unsigned long long OUTPUT_UNBOUNDED = ~0ULL;
+
+// One bit per class; a class's typemask also carries the bits of all its ancestors
+enum item_type_bit {
+	ITEM_BIT = 1 << 0,
+	ITEM_REF_BIT = 1 << 1,
+	GENERATOR_BIT = 1 << 2,
+	GROUP_BIT = 1 << 3,
+	GROUP_REF_BIT = 1 << 4,
+	OPTION_BIT = 1 << 5,
+	OPTION_REF_BIT = 1 << 6,
+	GROUP_OPTION_BIT = 1 << 7,
+	GROUP_OPTION_REF_BIT = 1 << 8
+};
+
 class Item {
 protected:
 	unsigned int _id;
 	string _name;
 	Generator &_generator;
 	Item* _parent;
-	hashmap<string, Item*> _children;
+	name_map<Item*> _children;
+	vector<Item*> _order;			// The same children, in the order they were added; 0 where one left
+	unsigned int _holes = 0;		// How many of _order are 0
+	unsigned int _position = 0;		// This Item's index in its parent's _order
 	hashmap<string, attribute> _attrs;
+	size_bounds _bounds = { 0, 0, 0 };
+	std::atomic<unsigned long long> _epoch{ 0 };	// Bumped whenever anything below changes
+	bool _shared = false;			// Stands in for merged copies, so it must not change
+	bool _dying = false;
+
+	void check_writable(const Item* removed = 0) const;
+	void unlink(Item* old_child);
 public:
 	static const string classname;
+	static constexpr type_mask typemask = ITEM_BIT;
+	static const char* const id_attr;
 
-	Item();
+	Item(Generator& gen);
 	Item(Generator& gen, const XMLNode &node);
-	~Item();
+	virtual ~Item();
 
 	static bool is(const Item* item);
-	virtual bool instanceof(const string &classname) const;
+	virtual type_mask types() const;
+	bool instanceof(type_mask mask) const {
+		return (types() & mask) == mask;
+	}
 
 	unsigned int id() const;
 	void id(unsigned int new_id);
@@ -46,12 +97,14 @@ public:
 
 	virtual vector<const Item*> children() const;
 	virtual vector<Item*> children();
+	virtual void children(arena_vector<const Item*> &out) const;
 	virtual const Item* child(const string &name) const;
 	virtual Item* child(const string &name);
+	const Item* find_child(std::string_view name) const;		// This item's own child, or 0; never looks through a reference
 	virtual const Item* child(unsigned int id) const;
 	virtual Item* child(unsigned int id);
-	virtual const Item* child(const vector<unsigned int> id) const;
-	virtual Item* child(const vector<unsigned int> id);
+	virtual const Item* child(const vector<unsigned int> &child_path) const;
+	virtual Item* child(const vector<unsigned int> &child_path);
 	virtual bool has_child(const Item* child) const;
 	virtual bool has_child(const string &child_name) const;
 	virtual bool has_child(unsigned int child_id) const;
@@ -62,13 +115,23 @@ public:
 	virtual void remove_child(const string &child_name);
 	virtual void remove_child(unsigned int child_id);
 	virtual void remove_child(const vector<unsigned int> &child_path);
+	virtual void replace_child(Item* old_child, Item* new_child);
 
 	bool has_parent() const;
 	const Item* parent() const;
 	Item* parent();
 	void parent(Item* new_parent);
 
-	virtual vector<const attribute> attributes() const;
+	unsigned long long epoch() const;
+	void touch();
+
+	// The Interner marks what it merged: every name that referred to a copy now sees
+	// this one, so changing it would change all of them. Shared items throw
+	// ITEM_SHARED from anything that would change them or their children.
+	bool shared() const;
+	void shared(bool is_shared);
+
+	virtual vector<attribute> attributes() const;
 	virtual vector<attribute> attributes();
 	virtual string attr(const string &attr_name) const;
 	virtual void attr(const string &attr_name, const string &attr_value);
@@ -82,34 +145,48 @@ public:
 	virtual const string& operator[](const string &attr_name) const;
 	virtual string& operator[](const string &attr_name);
 
-	virtual string evaluate() const;
+	const size_bounds& bounds() const;
+	void bounds(const size_bounds &new_bounds);
+
+	string evaluate() const;
+	string evaluate(random_engine &rng) const;
+	string evaluate_at(unsigned long long seed, unsigned long long index) const;
+	void evaluate_at(unsigned long long seed, unsigned long long index, string &out) const;
+	ResultStream stream(unsigned long long seed, unsigned long long first = 0) const;
 };
 
-class ItemRef : public Item {
+// Stands in for its base everywhere but the tree itself: children and attributes are
+// the base's. A loaded reference keeps its `ref` path until the Generator binds it.
+class ItemRef : public virtual Item {
 protected:
 	Item* _base;
+	string _base_path;
 public:
 	static const string classname;
+	static constexpr type_mask typemask = ITEM_REF_BIT | Item::typemask;
+	static const char* const ref_attr;
 
-	ItemRef();
+	ItemRef(Generator& gen);
 	ItemRef(Generator& gen, const XMLNode &node);
 	ItemRef(Item* base);
 	~ItemRef();
 
-	virtual bool instanceof(const string &classname) const;
+	virtual type_mask types() const;
 
 	const Item* base() const;
 	Item* base();
 	void base(Item* new_base);
+	const string& base_path() const;
 
 	virtual vector<const Item*> children() const;
 	virtual vector<Item*> children();
+	virtual void children(arena_vector<const Item*> &out) const;
 	virtual const Item* child(const string &name) const;
 	virtual Item* child(const string &name);
 	virtual const Item* child(unsigned int id) const;
 	virtual Item* child(unsigned int id);
-	virtual const Item* child(const vector<unsigned int> id) const;
-	virtual Item* child(const vector<unsigned int> id);
+	virtual const Item* child(const vector<unsigned int> &child_path) const;
+	virtual Item* child(const vector<unsigned int> &child_path);
 	virtual bool has_child(const Item* child) const;
 	virtual bool has_child(const string &child_name) const;
 	virtual bool has_child(unsigned int child_id) const;
@@ -120,8 +197,9 @@ public:
 	virtual void remove_child(const string &child_name);
 	virtual void remove_child(unsigned int child_id);
 	virtual void remove_child(const vector<unsigned int> &child_path);
+	virtual void replace_child(Item* old_child, Item* new_child);
 
-	virtual vector<const attribute> attributes() const;
+	virtual vector<attribute> attributes() const;
 	virtual vector<attribute> attributes();
 	virtual string attr(const string &attr_name) const;
 	virtual void attr(const string &attr_name, const string &attr_value);
@@ -132,111 +210,236 @@ public:
 	virtual void add_attr(const string &attr_name, const string& attr_value);
 	virtual void remove_attr(const attribute attribute);
 	virtual void remove_attr(const string &attr_name);
-
-	virtual string evaluate() const;
 };
 
 class Generator : public Item {
 private:
-	hashmap<unsigned int, Item*> _items;
-	hashmap<string, item_factory> _factories;
+	typedef struct {
+		Item* item;
+		unsigned int generation;
+	} item_slot;
+
+	vector<item_slot> _items;			// Indexed by Item::id()
+	vector<unsigned int> _free_ids;
+	eval_budget _budget = default_eval_budget();
+	xml::factory_table<item_factory> _factories;
+	xml::factory_table<type_mask> _kinds;			// What each factory builds, by the same names
+	StringPool _strings;
 	string _space;
+	unsigned int _documents = 0;
+
+	static XMLDoc* open_entry(xml::bundle &source, const string &entry_name);
+	void load(size_t count, const std::function<XMLDoc*(size_t)> &open, Scheduler &pool);
+	void build(const vector<XMLDoc*> &docs);
+	void bind_refs();
 public:
+	static constexpr type_mask typemask = GENERATOR_BIT | Item::typemask;
+
 	Generator();
+	Generator(const string &xml_file);
 	~Generator();
 
-	virtual string evaluate() const;
+	void load(const string &xml_file);
+	void load(const vector<string> &xml_files, Scheduler &pool);
+	void load(xml::bundle &source, Scheduler &pool);
+	void load(xml::bundle &source, const string &entry_name);
+	unsigned int documents() const;
+	unsigned int intern();
+	Item* create(const XMLNode &node);
+
+	virtual type_mask types() const;
+
+	// Register every factory, then freeze once before anything looks one up
+	template<class item_type>
+	void register_() {
+		_factories.add(item_type::classname, item_factory_for_<item_type>);
+		_kinds.add(item_type::classname, item_type::typemask);
+	}
+	void freeze_factories();
+	item_factory factory(const char* name, size_t length) const;
+	type_mask kind(const char* name, size_t length) const;
+
+	unsigned int allocate(Item* new_item);
+	void release(unsigned int old_id);
+	bool has_item(unsigned int item_id) const;
+	const Item* item(unsigned int item_id) const;
+	Item* item(unsigned int item_id);
+	item_handle handle(unsigned int item_id) const;
+	const Item* item(const item_handle &handle) const;
+	Item* item(const item_handle &handle);
+	unsigned int item_count() const;
+
+	ItemPath compile(const Item* root, const vector<unsigned int> &path) const;
+	const Item* resolve(const ItemPath &path) const;
+	Item* resolve(const ItemPath &path);
+
+	const Item* find(const string &path) const;
+	Item* find(const string &path);
+
+	const StringPool& strings() const;
+	StringPool& strings();
+	void measure();
+
+	const eval_budget& budget() const;
+	void budget(const eval_budget &new_budget);
 };
 
-class Group : public Item {
+class Group : public virtual Item {
+	friend class Deck;
+	friend class Evaluator;
+protected:
+	vector<Option*> _options;
+	hashmap<const Option*, unsigned int> _slots;	// Map an option to its index in _weights
+	WeightTree _weights;
+	unsigned long long _version = 0;				// Bumped when options or weights change
+	unsigned long long _layout = 0;					// _version when the options last changed
+	vector<unsigned int> _reweighted;				// Slots reweighted since, one per version
+
+	void push_option(Option* new_option);
+	void drop_option(Option* old_option);
+	void relayout();
 public:
 	static const string classname;
+	static constexpr type_mask typemask = GROUP_BIT | Item::typemask;
 
-	Group();
+	Group(Generator& gen);
 	Group(Generator& gen, const XMLNode &node);
 	~Group();
 
-	virtual bool instanceof(const string &classname) const;
+	virtual type_mask types() const;
 
-	virtual string evaluate() const;
+	using Item::add_child;
+	using Item::remove_child;
+	virtual void add_child(Item* new_child);
+	virtual void remove_child(Item* old_child);
+	virtual void replace_child(Item* old_child, Item* new_child);
+
+	vector<const Option*> options() const;
+	vector<Option*> options();
+	bool has_option(const Option* option) const;
+	unsigned long long total_weight() const;
+	unsigned long long version() const;
+	virtual void reweight(const Option* option);
+
+	const Option* draw(random_engine &rng) const;
+	Option* draw(random_engine &rng);
+	// Without replacement: at most count options, fewer if fewer have any weight
+	vector<const Option*> draw(random_engine &rng, unsigned int count) const;
+	vector<Option*> draw(random_engine &rng, unsigned int count);
 };
 
-class GroupRef : public Group, public ItemRef {
+class GroupRef : public virtual Group, public virtual ItemRef {
 public:
 	static const string classname;
+	static constexpr type_mask typemask = GROUP_REF_BIT | Group::typemask | ItemRef::typemask;
 
-	GroupRef();
+	GroupRef(Generator &gen);
 	GroupRef(Generator &gen, const XMLNode &node);
 	GroupRef(Group* base);
 	~GroupRef();
 
-	virtual bool instanceof(const string &classname) const;
+	virtual type_mask types() const;
 
-	virtual string evaluate() const;
+	using ItemRef::add_child;
+	using ItemRef::remove_child;
+	virtual void add_child(Item* new_child);
+	virtual void remove_child(Item* old_child);
+	virtual void replace_child(Item* old_child, Item* new_child);
 };
 
-class Option : public Item {
+class Option : public virtual Item {
 protected:
 	unsigned int _weight;
+	unsigned int _text = StringPool::EMPTY;		// Id in the Generator's string pool
 public:
 	static const string classname;
+	static constexpr type_mask typemask = OPTION_BIT | Item::typemask;
 	static const unsigned int default_weight;
+	static const char* const weight_attr;
 
-	Option();
+	static bool parse_weight(const string &value, unsigned int &weight);
+
+	Option(Generator& gen);
 	Option(Generator& gen, const XMLNode &node);
 	~Option();
 
-	virtual bool instanceof(const string &classname) const;
+	virtual type_mask types() const;
 
 	virtual unsigned int weight() const;
 	virtual void weight(unsigned int new_weight);
 
-	virtual string evaluate() const;
+	virtual string text() const;
+	virtual void text(const string &new_text);
+	unsigned int text_id() const;
+	void append_text(string &out) const;
 };
 
-class OptionRef : public Option, public ItemRef {
+class OptionRef : public virtual Option, public virtual ItemRef {
 public:
 	static const string classname;
+	static constexpr type_mask typemask = OPTION_REF_BIT | Option::typemask | ItemRef::typemask;
 
-	OptionRef();
+	OptionRef(Generator &gen);
 	OptionRef(Generator &gen, const XMLNode &node);
 	OptionRef(Option* base);
 	~OptionRef();
 
-	virtual bool instanceof(const string &classname) const;
+	virtual type_mask types() const;
 
 	virtual unsigned int weight() const;
 	virtual void weight(unsigned int new_weight);
-
-	virtual string evaluate() const;
+	virtual string text() const;
+	virtual void text(const string &new_text);
 };
 
-class GroupOption : public Option, public Group {
+class GroupOption : public virtual Option, public virtual Group {
 public:
 	static const string classname;
+	static constexpr type_mask typemask = GROUP_OPTION_BIT | Option::typemask | Group::typemask;
 	static const unsigned int default_weight;
 
-	GroupOption();
+	GroupOption(Generator& gen);
 	GroupOption(Generator& gen, const XMLNode &node);
 	~GroupOption();
 
-	virtual bool instanceof(const string &classname) const;
-
-	virtual string evaluate() const;
+	virtual type_mask types() const;
 };
 
 class GroupOptionRef : public GroupOption, public GroupRef {
 public:
 	static const string classname;
+	static constexpr type_mask typemask = GROUP_OPTION_REF_BIT | GroupOption::typemask | GroupRef::typemask;
 	static const unsigned int default_weight;
 
-	GroupOptionRef();
+	GroupOptionRef(Generator& gen);
 	GroupOptionRef(Generator& gen, const XMLNode &node);
 	~GroupOptionRef();
 
-	virtual bool instanceof(const string &classname) const;
+	virtual type_mask types() const;
 
-	virtual string evaluate() const;
+	using GroupRef::add_child;
+	using GroupRef::remove_child;
+	virtual void add_child(Item* new_child);
+	virtual void remove_child(Item* old_child);
+	virtual void replace_child(Item* old_child, Item* new_child);
+
+	virtual unsigned int weight() const;
+	virtual void weight(unsigned int new_weight);
+	virtual string text() const;
+	virtual void text(const string &new_text);
 };
 
+// Checked downcast: the tag test rejects in one AND, and dynamic_cast is only paid
+// on a hit, where it is still needed to find the right base in the diamond classes
+template<class T>
+const T* item_cast(const Item* item) {
+	if (item == 0 || !item->instanceof(T::typemask)) return 0;
+	return dynamic_cast<const T*>(item);
+}
+template<class T>
+T* item_cast(Item* item) {
+	if (item == 0 || !item->instanceof(T::typemask)) return 0;
+	return dynamic_cast<T*>(item);
+}
+
 #endif // !__RND_GEN_CORE_GEN_TREE_H__
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef __RND_GEN_CORE_INTERNER_H__
+#define __RND_GEN_CORE_INTERNER_H__
+
+#include "core.h"
+
+using namespace rnd_gen;
+
+// Load-time hash-consing: structurally identical subtrees anywhere in a Generator are
+// collapsed onto one canonical instance, and every other copy becomes a reference to it
+// under its own name. Nothing runs it on load: Generator::intern() does, when asked. The
+// merged instances are marked shared and refuse changes from then on.
+class Interner {
+private:
+	hashmap<string, unsigned int> _classes;			// Structural key to class id
+	hashmap<const Item*, unsigned int> _class_of;
+	vector<unsigned int> _counts;
+	vector<Item*> _canonical;
+	vector<bool> _merged;							// Class had copies replaced by references
+	hashmap<const Item*, Item*> _replaced;			// Removed item to its stand-in
+	vector<Item*> _removed;
+
+	static bool internable(const Item* item);
+	string key(Item* item);
+	void classify(Item* root);
+	void share(Item* root);
+	void forward(Item* removed);
+	void rebind(Generator &gen);
+	void mark_shared();
+	Item* stand_in(Item* original) const;
+public:
+	Interner();
+	~Interner();
+
+	unsigned int intern(Generator &gen);
+	unsigned int classes() const;
+};
+
+#endif // !__RND_GEN_CORE_INTERNER_H__
\ No newline at end of file
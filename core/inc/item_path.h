@@ -0,0 +1,39 @@
+#ifndef __RND_GEN_CORE_ITEM_PATH_H__
+#define __RND_GEN_CORE_ITEM_PATH_H__
+
+#include "core.h"
+
+#include <atomic>
+
+using namespace rnd_gen;
+
+// A child id path compiled by Generator::compile(). It caches the item it resolved to
+// and its root's epoch at the time, so repeat lookups skip the walk until something
+// below the root changes; edits elsewhere in the Generator leave it valid. A path that
+// passes through a reference is walked every time, since edits under the reference's
+// base do not reach the root.
+// Any number of threads may resolve one ItemPath at once, but like every lookup, not
+// while the tree is being edited.
+class ItemPath {
+	friend class Generator;
+private:
+	static constexpr unsigned long long UNCACHED = ~0ULL;
+
+	const Item* _root;
+	vector<unsigned int> _ids;
+	mutable std::atomic<unsigned long long> _target;	// Item id in the high half, generation in the low
+	mutable std::atomic<unsigned long long> _epoch;
+
+	ItemPath(const Item* root, const vector<unsigned int> &ids);
+public:
+	ItemPath();
+	ItemPath(const ItemPath &other);
+	~ItemPath();
+
+	ItemPath& operator=(const ItemPath &other);
+
+	const Item* root() const;
+	const vector<unsigned int>& ids() const;
+};
+
+#endif // !__RND_GEN_CORE_ITEM_PATH_H__
\ No newline at end of file
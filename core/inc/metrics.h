@@ -0,0 +1,125 @@
+#ifndef __RND_GEN_CORE_METRICS_H__
+#define __RND_GEN_CORE_METRICS_H__
+
+#include "core.h"
+
+#include <atomic>
+#include <mutex>
+
+using namespace rnd_gen;
+
+const unsigned int METRICS_SHARDS = 16;					// Copies of each metric, spread over threads
+const unsigned int HISTOGRAM_SUB_BITS = 5;				// 32 buckets per power of two, within ~3%
+const unsigned int HISTOGRAM_MAX_MAGNITUDE = 40;		// Largest value kept is just under 2^41 (~37 minutes in ns)
+const unsigned int HISTOGRAM_BUCKETS = (HISTOGRAM_MAX_MAGNITUDE - HISTOGRAM_SUB_BITS + 2) << HISTOGRAM_SUB_BITS;
+
+enum metric_type {
+	METRIC_COUNTER,
+	METRIC_GAUGE,
+	METRIC_SUMMARY
+};
+
+// The shard the calling thread updates; threads take shards round robin on first use
+unsigned int metrics_shard();
+unsigned long long metrics_now();		// Monotonic nanoseconds, for timing what a Histogram records
+
+// Monotonic count. Each thread adds to its own cache line, so hot counters on
+// different workers never share a line; value() sums the shards.
+class Counter {
+private:
+	typedef struct {
+		alignas(CACHE_LINE_SIZE) std::atomic<unsigned long long> value;
+	} shard;
+
+	shard _shards[METRICS_SHARDS];
+public:
+	Counter();
+	~Counter();
+
+	void add(unsigned long long amount = 1);
+	unsigned long long value() const;
+};
+
+class Gauge {
+private:
+	std::atomic<long long> _value;
+public:
+	Gauge();
+	~Gauge();
+
+	void set(long long value);
+	void add(long long amount);
+	long long value() const;
+};
+
+// Log-linear histogram in the style of HdrHistogram: values below 2^SUB_BITS get a
+// bucket each, and every power of two above that is split into 2^SUB_BITS buckets,
+// so any quantile is within about 3% of the true value at a fixed size. Like Counter,
+// each thread records into its own shard.
+class Histogram {
+private:
+	typedef struct {
+		alignas(CACHE_LINE_SIZE) std::atomic<unsigned long long> buckets[HISTOGRAM_BUCKETS];
+		std::atomic<unsigned long long> count;
+		std::atomic<unsigned long long> sum;
+	} shard;
+
+	shard* _shards;
+public:
+	Histogram();
+	~Histogram();
+	Histogram(const Histogram&) = delete;
+	Histogram& operator=(const Histogram&) = delete;
+
+	static unsigned int bucket(unsigned long long value);
+	static unsigned long long bucket_low(unsigned int index);		// Smallest value in the bucket
+	static unsigned long long bucket_high(unsigned int index);		// Largest value in the bucket
+
+	void record(unsigned long long value);
+	unsigned long long count() const;
+	unsigned long long sum() const;
+	// Values at each quantile in `quantiles` (0..1, ascending), taken from one snapshot
+	vector<unsigned long long> quantiles(const vector<double> &quantiles) const;
+};
+
+// Named metrics, written out in the Prometheus text exposition format. Registering
+// takes a lock and is meant for start-up; the metrics it returns stay put and are
+// updated without locks. A family is one metric name; each labelled series in it is
+// registered separately, e.g. counter("requests_total", "...", "status=\"ok\"").
+class Metrics {
+private:
+	typedef struct {
+		string labels;
+		Counter* counter;
+		Gauge* gauge;
+		Histogram* histogram;
+		double scale;					// Histogram values are multiplied by this on output
+	} series;
+
+	typedef struct {
+		string name;
+		string help;
+		metric_type type;
+		vector<series> members;
+	} family;
+
+	vector<family> _families;
+	std::mutex _lock;
+
+	family& find(const string &name, const string &help, metric_type type);
+public:
+	Metrics();
+	~Metrics();
+	Metrics(const Metrics&) = delete;
+	Metrics& operator=(const Metrics&) = delete;
+
+	Counter& counter(const string &name, const string &help, const string &labels = "");
+	Gauge& gauge(const string &name, const string &help, const string &labels = "");
+	// Exposed as a summary with p50/p90/p99/p999 plus _sum and _count
+	Histogram& histogram(const string &name, const string &help, double scale = 1, const string &labels = "");
+
+	void write(string &out);
+	bool write_file(const string &path);		// Replaces `path` whole, for node_exporter's textfile collector
+};
+
+#endif // !__RND_GEN_CORE_METRICS_H__
\ No newline at end of file
@@ -0,0 +1,114 @@
+#ifndef __RND_GEN_CORE_PIPELINE_H__
+#define __RND_GEN_CORE_PIPELINE_H__
+
+#include "core.h"
+
+#include <atomic>
+#include <exception>
+#include <thread>
+
+using namespace rnd_gen;
+
+const unsigned int PIPELINE_CHUNK_SIZE = 1024;				// Results per unit passed between stages
+const unsigned int PIPELINE_RING_SIZE = 8;					// Chunks each ring holds
+const unsigned int PIPELINE_CHUNKS_PER_THREAD = 4;			// Chunks each generator may be ahead of the writer
+const size_t PIPELINE_WRITE_SIZE = 1 << 20;					// Bytes gathered before each write
+const unsigned int PIPELINE_SPINS = 256;					// Checks before a waiting stage sleeps
+
+typedef struct {
+	string name;
+	unsigned int threads;
+	unsigned long long items;			// Results through the stage
+	unsigned long long bytes;			// Bytes out of the stage
+	double busy;						// Seconds spent working, summed over threads
+	double stalled;						// Seconds spent waiting on a neighbour stage
+} stage_stats;
+
+void print_stats(FILE* out, const stage_stats &stats);
+
+// Lets a stage sleep until a neighbour has done something it may be waiting for.
+// wait_until() takes a ticket before each attempt and only sleeps if the attempt
+// fails and no notify() has happened since, so a wakeup cannot be lost. The other
+// side is usually about to move, so it spins briefly before parking on the counter,
+// which is a futex where the platform has one.
+class StageSignal {
+private:
+	std::atomic<unsigned int> _events;
+	std::atomic<unsigned int> _sleepers;
+public:
+	StageSignal() : _events(0), _sleepers(0) { }
+
+	template<class attempt>
+	void wait_until(attempt done) {
+		while (true) {
+			unsigned int ticket = _events.load();
+			if (done()) return;
+			unsigned int spins = 0;
+			while (_events.load(std::memory_order_relaxed) == ticket && spins < PIPELINE_SPINS) spins++;
+			if (spins < PIPELINE_SPINS) continue;
+			_sleepers++;
+			_events.wait(ticket);
+			_sleepers--;
+		}
+	}
+
+	void notify() {
+		_events++;
+		if (_sleepers.load() > 0) _events.notify_all();
+	}
+};
+
+// Batch export as three stages: generator threads evaluate chunks of results,
+// formatter threads turn them into records, and the calling thread writes them out
+// in order. Generators hand chunks to formatters over SPSC rings, formatters to the
+// writer over one MPSC ring; a full ring or the writer falling behind parks the stage
+// before it, and an empty one parks the stage after it. Each stage times its own work and waits, so the slowest one shows.
+class Pipeline {
+private:
+	typedef struct {
+		unsigned long long index;
+		unsigned long long first;
+		vector<string> results;
+	} raw_chunk;
+
+	typedef struct {
+		unsigned long long index;
+		vector<char> records;
+	} formatted_chunk;
+
+	const Generator &_generator;
+	batch_config _config;
+	const Item* _item;
+	unsigned int _formatters;
+	unsigned long long _chunk_count;
+	unsigned long long _window;
+	vector<SpscRing<raw_chunk>*> _raw;			// One per generator thread
+	MpscRing<formatted_chunk> _formatted;
+	std::atomic<unsigned long long> _next_chunk;
+	std::atomic<unsigned long long> _written;	// Chunks the writer has taken
+	std::atomic<bool> _failed;
+	std::exception_ptr _error;					// First exception out of any stage, under _lock
+	StageSignal _progress;						// The writer took more chunks
+	StageSignal _raw_ready;						// A generator pushed or closed
+	StageSignal _raw_space;						// A formatter popped
+	StageSignal _formatted_ready;				// A formatter pushed
+	StageSignal _formatted_space;				// The writer popped
+	std::mutex _lock;
+	vector<stage_stats> _stats;
+
+	void stage(void (Pipeline::*body)(unsigned int), unsigned int worker);
+	void generate(unsigned int worker);
+	void format(unsigned int worker);
+	void write(int fd);
+	void report(unsigned int stage, const stage_stats &part);
+	void fail();
+	void fail(std::exception_ptr error);
+public:
+	Pipeline(const Generator &gen, const batch_config &config);
+	~Pipeline();
+
+	void run(int fd);
+	const vector<stage_stats>& stats() const;
+};
+
+#endif // !__RND_GEN_CORE_PIPELINE_H__
\ No newline at end of file
@@ -0,0 +1,51 @@
+#ifndef __RND_GEN_CORE_RATIONAL_H__
+#define __RND_GEN_CORE_RATIONAL_H__
+
+#include "typedefs.h"
+
+using namespace rnd_gen;
+
+// Non-negative fraction of two unbounded integers, always kept in lowest terms.
+// Everything is integer arithmetic on 32-bit limbs, so a result is the same on every
+// compiler and no chance is too small to hold. Subtracting a larger value throws.
+class Rational {
+private:
+	typedef vector<unsigned int> natural;	// Little-endian limbs, no leading zero limbs
+
+	natural _num;
+	natural _den;
+
+	static natural from(unsigned long long value);
+	static int compare(const natural &a, const natural &b);
+	static natural add(const natural &a, const natural &b);
+	static natural subtract(const natural &a, const natural &b);
+	static natural multiply(const natural &a, const natural &b);
+	static natural divide(const natural &a, const natural &b);
+	static unsigned int divide(natural &a, unsigned int divisor);
+	static natural gcd(natural a, natural b);
+	static unsigned int bits(const natural &a);
+	static unsigned long long top(const natural &a, int &exponent);
+
+	Rational(const natural &num, const natural &den);
+public:
+	Rational();
+	Rational(unsigned long long num, unsigned long long den = 1);
+	~Rational();
+
+	bool zero() const;
+	Rational operator+(const Rational &other) const;
+	Rational operator-(const Rational &other) const;
+	Rational operator*(const Rational &other) const;
+	Rational& operator+=(const Rational &other);
+
+	bool operator==(const Rational &other) const;
+	bool operator!=(const Rational &other) const;
+	bool operator<(const Rational &other) const;
+	bool operator>(const Rational &other) const;
+
+	// Nearest double, for display: comparisons should use the Rational itself
+	double approx() const;
+	string str() const;						// "numerator/denominator", or just the numerator
+};
+
+#endif // !__RND_GEN_CORE_RATIONAL_H__
\ No newline at end of file
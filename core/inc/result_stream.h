@@ -0,0 +1,102 @@
+#ifndef __RND_GEN_CORE_RESULT_STREAM_H__
+#define __RND_GEN_CORE_RESULT_STREAM_H__
+
+#include "core.h"
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+
+using namespace rnd_gen;
+
+// Lazy, unbounded range of results from Item::stream(). Nothing is generated until
+// the consumer asks for the next result, and every result is written into the same
+// buffer, so a reference is only valid until the iterator is advanced. The consumer
+// ends the stream by stopping; a failed evaluation is rethrown from the advance.
+class ResultStream {
+public:
+	class promise_type {
+		friend class ResultStream;
+	private:
+		const string* _current = 0;
+		std::exception_ptr _error;
+	public:
+		ResultStream get_return_object() {
+			return ResultStream(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		std::suspend_always yield_value(const string &result) noexcept {
+			_current = &result;
+			return {};
+		}
+		void return_void() { }
+		void unhandled_exception() {
+			_error = std::current_exception();
+		}
+	};
+
+	class iterator {
+	private:
+		std::coroutine_handle<promise_type> _handle;
+	public:
+		iterator() : _handle(0) { }
+		explicit iterator(std::coroutine_handle<promise_type> handle) : _handle(handle) { }
+
+		const string& operator*() const {
+			return *_handle.promise()._current;
+		}
+		const string* operator->() const {
+			return _handle.promise()._current;
+		}
+		iterator& operator++() {
+			ResultStream::advance(_handle);
+			return *this;
+		}
+		void operator++(int) {
+			++*this;
+		}
+		bool operator==(std::default_sentinel_t) const {
+			return !_handle || _handle.done();
+		}
+	};
+
+	explicit ResultStream(std::coroutine_handle<promise_type> handle) : _handle(handle) { }
+	ResultStream(ResultStream &&other) noexcept : _handle(other._handle) {
+		other._handle = 0;
+	}
+	ResultStream& operator=(ResultStream &&other) noexcept {
+		if (this != &other) {
+			if (_handle) _handle.destroy();
+			_handle = other._handle;
+			other._handle = 0;
+		}
+		return *this;
+	}
+	ResultStream(const ResultStream&) = delete;
+	ResultStream& operator=(const ResultStream&) = delete;
+	~ResultStream() {
+		if (_handle) _handle.destroy();
+	}
+
+	iterator begin() {
+		if (_handle && _handle.promise()._current == 0) advance(_handle);
+		return iterator(_handle);
+	}
+	std::default_sentinel_t end() const {
+		return std::default_sentinel;
+	}
+private:
+	std::coroutine_handle<promise_type> _handle;
+
+	static void advance(std::coroutine_handle<promise_type> handle) {
+		handle.resume();
+		if (handle.promise()._error) {
+			std::exception_ptr error = handle.promise()._error;
+			handle.promise()._error = 0;
+			std::rethrow_exception(error);
+		}
+	}
+};
+
+#endif // !__RND_GEN_CORE_RESULT_STREAM_H__
\ No newline at end of file
@@ -0,0 +1,115 @@
+#ifndef __RND_GEN_CORE_RING_H__
+#define __RND_GEN_CORE_RING_H__
+
+#include "typedefs.h"
+
+#include <atomic>
+#include <stddef.h>
+
+using namespace rnd_gen;
+
+const size_t CACHE_LINE_SIZE = 64;
+
+inline size_t ring_capacity(size_t wanted) {
+	size_t ret = 1;
+	while (ret < wanted) ret <<= 1;
+	return ret;
+}
+
+// Bounded single-producer, single-consumer queue. push() and pop() never block:
+// they fail when the ring is full or empty, and the caller decides how to wait.
+// Items are moved in and out only on success, so a failed push can be retried.
+template<class T>
+class SpscRing {
+private:
+	vector<T> _slots;
+	size_t _mask;
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> _head;		// Next slot to read
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> _tail;		// Next slot to write
+	std::atomic<bool> _closed;
+public:
+	SpscRing(size_t capacity) : _slots(ring_capacity(capacity)), _mask(ring_capacity(capacity) - 1), _head(0), _tail(0), _closed(false) { }
+
+	bool push(T &item) {
+		size_t tail = _tail.load(std::memory_order_relaxed);
+		if (tail - _head.load(std::memory_order_acquire) > _mask) return false;
+		_slots[tail & _mask] = std::move(item);
+		_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T &item) {
+		size_t head = _head.load(std::memory_order_relaxed);
+		if (head == _tail.load(std::memory_order_acquire)) return false;
+		item = std::move(_slots[head & _mask]);
+		_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// The producer will push nothing more; anything already pushed can still be popped
+	void close() {
+		_closed.store(true, std::memory_order_release);
+	}
+	bool closed() const {
+		return _closed.load(std::memory_order_acquire);
+	}
+};
+
+// Bounded multi-producer, single-consumer queue (Vyukov's sequenced cells). Each
+// cell's sequence number says whether it is free for the producer that claimed its
+// position or holds a value for the consumer, so producers only contend on one counter.
+template<class T>
+class MpscRing {
+private:
+	typedef struct {
+		std::atomic<size_t> sequence;
+		T value;
+	} cell;
+
+	cell* _cells;
+	size_t _mask;
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> _tail;
+	alignas(CACHE_LINE_SIZE) size_t _head;
+public:
+	MpscRing(size_t capacity) {
+		size_t size = ring_capacity(capacity);
+		_cells = new cell[size];
+		_mask = size - 1;
+		for (size_t i = 0; i < size; i++) _cells[i].sequence.store(i, std::memory_order_relaxed);
+		_tail = 0;
+		_head = 0;
+	}
+	~MpscRing() {
+		delete[] _cells;
+	}
+	MpscRing(const MpscRing&) = delete;
+	MpscRing& operator=(const MpscRing&) = delete;
+
+	bool push(T &item) {
+		size_t pos = _tail.load(std::memory_order_relaxed);
+		cell* target;
+		while (true) {
+			target = &_cells[pos & _mask];
+			size_t sequence = target->sequence.load(std::memory_order_acquire);
+			if (sequence == pos) {
+				if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+			}
+			else if (sequence < pos) return false;
+			else pos = _tail.load(std::memory_order_relaxed);
+		}
+		target->value = std::move(item);
+		target->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T &item) {
+		cell &target = _cells[_head & _mask];
+		if (target.sequence.load(std::memory_order_acquire) != _head + 1) return false;
+		item = std::move(target.value);
+		target.sequence.store(_head + _mask + 1, std::memory_order_release);
+		_head++;
+		return true;
+	}
+};
+
+#endif // !__RND_GEN_CORE_RING_H__
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef __RND_GEN_CORE_SCHEDULER_H__
+#define __RND_GEN_CORE_SCHEDULER_H__
+
+#include "core.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+using namespace rnd_gen;
+
+typedef std::function<void()> task;
+typedef std::function<void(unsigned long long, unsigned long long)> range_task;
+
+// Tasks spawned together and waited on together. The first exception thrown by any
+// of them is kept and rethrown by Scheduler::wait().
+class TaskGroup {
+	friend class Scheduler;
+private:
+	std::atomic<unsigned int> _pending;
+	std::mutex _lock;
+	std::condition_variable _done;
+	std::exception_ptr _error;
+public:
+	TaskGroup();
+	~TaskGroup();
+
+	bool finished() const;
+};
+
+// Work-stealing pool. Each worker pushes and pops tasks at the back of its own deque,
+// so it keeps working on what it just split off while that is still in cache; idle
+// workers steal from the front of the others, where the biggest pieces are. Threads
+// outside the pool queue into a shared inbox. wait() runs tasks itself instead of
+// blocking, so tasks can spawn and wait on subtasks without tying up a worker.
+class Scheduler {
+private:
+	typedef struct {
+		task run;
+		TaskGroup* group;
+	} job;
+
+	typedef struct {
+		std::mutex lock;
+		std::deque<job> jobs;
+	} queue;
+
+	static const unsigned int NO_WORKER = ~0u;
+	static thread_local Scheduler* _current;
+	static thread_local unsigned int _self;
+
+	unsigned int _workers;
+	vector<queue*> _queues;				// One per worker, then the inbox
+	vector<std::thread> _threads;
+	std::atomic<unsigned int> _queued;
+	std::mutex _sleep_lock;
+	std::condition_variable _wake;
+	bool _stopping;
+
+	unsigned int self() const;
+	bool take(unsigned int self, job &next);
+	void execute(job &next);
+	void worker(unsigned int index);
+	void split(TaskGroup &group, unsigned long long first, unsigned long long last, unsigned long long grain, const range_task &body);
+public:
+	Scheduler(unsigned int threads);
+	~Scheduler();
+
+	unsigned int threads() const;
+
+	void spawn(TaskGroup &group, const task &run);
+	void wait(TaskGroup &group);
+	void parallel_for(unsigned long long first, unsigned long long last, unsigned long long grain, const range_task &body);
+};
+
+#endif // !__RND_GEN_CORE_SCHEDULER_H__
\ No newline at end of file
@@ -0,0 +1,139 @@
+#ifndef __RND_GEN_CORE_SERVER_H__
+#define __RND_GEN_CORE_SERVER_H__
+
+#include "core.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace rnd_gen;
+
+/*
+ * Framed protocol, all integers in host byte order:
+ *   request:  u32 length | u64 seed | u32 count | u16 path_length | path
+ *   response: u32 length | u32 status | u32 count | count * (u32 length | bytes)
+ * The leading length never counts itself.
+ */
+const unsigned int FRAME_HEADER_SIZE = 4;
+const unsigned int REQUEST_FIXED_SIZE = 8 + 4 + 2;
+const unsigned int MAX_REQUEST_SIZE = 64 * 1024;
+
+enum server_status {
+	REQUEST_OK,
+	BAD_REQUEST,
+	UNKNOWN_GENERATOR,
+	COUNT_TOO_LARGE,
+	GENERATION_FAILED,
+	BUDGET_EXCEEDED
+};
+
+typedef struct {
+	string socket_path;
+	unsigned int workers;
+	unsigned int max_connections;
+	unsigned int max_count;			// Largest batch one request may ask for
+	unsigned int buffer_size;		// Starting capacity of each pooled buffer
+	unsigned int coalesce_window;	// Microseconds a worker waits for more requests to the same generator
+	unsigned int max_batch;			// Most requests a worker answers together
+	string metrics_path;			// File the metrics are rewritten to; empty for none
+	unsigned int metrics_interval;	// Seconds between rewrites, at least 1
+} server_config;
+
+server_config default_server_config(const string &socket_path);
+
+class BufferPool {
+private:
+	vector<vector<char>*> _free;
+	std::mutex _lock;
+	unsigned int _capacity;
+public:
+	BufferPool(unsigned int count, unsigned int capacity);
+	~BufferPool();
+
+	vector<char>* acquire();
+	void release(vector<char>* buffer);
+};
+
+class Server {
+private:
+	typedef struct {
+		int fd;
+		vector<char>* in;
+		vector<char>* out;
+		size_t in_used;
+		size_t out_sent;
+		size_t request_size;		// Bytes of `in` taken by the request a worker holds
+		bool busy;
+		bool closing;
+		unsigned long long queued_at;	// When the request a worker holds was dispatched
+		unsigned int status;			// Its server_status while a worker answers it
+	} connection;
+
+	const Generator &_generator;
+	server_config _config;
+	BufferPool _buffers;
+	vector<connection> _connections;
+	vector<connection*> _idle;
+
+	int _listen_fd;
+	int _epoll_fd;
+	int _wake_fd;
+	std::atomic<bool> _running;
+	vector<std::thread> _workers;
+	std::condition_variable _stopped;
+
+	Metrics _metrics;
+	vector<Counter*> _requests;			// Indexed by server_status
+	Counter* _results;
+	Counter* _result_bytes;
+	Histogram* _request_time;
+	Histogram* _evaluate_time;
+	Histogram* _batch_size;
+	Gauge* _open_connections;
+
+	// Fixed-capacity rings, so queueing work never allocates
+	std::mutex _jobs_lock;
+	std::condition_variable _jobs_ready;
+	std::condition_variable _jobs_added;	// Wakes workers gathering a batch
+	unsigned int _gathering;
+	unsigned int _waiting;					// Workers with nothing to do
+	vector<connection*> _jobs;
+	size_t _jobs_head;
+	size_t _jobs_count;
+	std::mutex _done_lock;
+	vector<connection*> _done;
+	size_t _done_head;
+	size_t _done_count;
+
+	void listen();
+	void accept_all();
+	void read_from(connection* conn);
+	void write_to(connection* conn);
+	void dispatch(connection* conn);
+	void finish_all();
+	void close(connection* conn);
+	void watch(connection* conn, unsigned int events);
+
+	void work();
+	void export_metrics();
+	bool request_path(const connection* conn, string &path) const;
+	void gather(std::unique_lock<std::mutex> &guard, const string &path, string &path_scratch, vector<connection*> &batch);
+	void take(const string &path, string &path_scratch, vector<connection*> &batch);
+	void handle(vector<connection*> &batch, string &path, string &result);
+	void check(connection* conn, unsigned int lookup);
+	void evaluate(connection* conn, const Item* item, string &result);
+	unsigned int finish(connection* conn, unsigned long long finished, size_t &bytes);
+	void push(vector<connection*> &ring, size_t &head, size_t &count, connection* conn);
+	connection* pop(vector<connection*> &ring, size_t &head, size_t &count);
+public:
+	Server(const Generator &gen, const server_config &config);
+	~Server();
+
+	void run();
+	void stop();
+	Metrics& metrics();
+};
+
+#endif // !__RND_GEN_CORE_SERVER_H__
\ No newline at end of file
@@ -0,0 +1,120 @@
+#ifndef __RND_GEN_CORE_SHM_RING_H__
+#define __RND_GEN_CORE_SHM_RING_H__
+
+#include "core.h"
+
+#include <atomic>
+
+using namespace rnd_gen;
+
+const unsigned int SHM_RING_MAGIC = 0x474e5252;			// "RRNG"
+const unsigned int SHM_RING_VERSION = 3;
+const unsigned int SHM_RECORD_ALIGN = 16;
+const unsigned int SHM_SPIN_LIMIT = 1024;				// Checks before sleeping on the futex, given a spare core
+const int SHM_WAIT_SLICE_MS = 100;						// A blocked producer looks for its consumer this often
+const int SHM_ATTACH_TIMEOUT_MS = 10000;				// and gives up on one that never attached after this long
+const char* const SHM_RING_DIR = "/dev/shm/";
+
+enum shm_full_policy {
+	SHM_BLOCK,				// The producer waits for the consumer to free space
+	SHM_DROP				// The result is dropped; the consumer sees the gap in sequence numbers
+};
+
+/*
+ * Layout of the mapped file: one shm_ring_header, then `capacity` bytes of records.
+ * Each record is a shm_record_header and its bytes, padded to SHM_RECORD_ALIGN; a
+ * record never wraps, so a padding record fills the end of the ring when one would.
+ * head and tail count bytes ever published and released, so they only grow.
+ */
+typedef struct {
+	unsigned int magic;
+	unsigned int version;
+	unsigned long long capacity;
+	alignas(CACHE_LINE_SIZE) std::atomic<unsigned long long> head;
+	std::atomic<unsigned int> data_signal;			// Futex word the consumer sleeps on
+	std::atomic<unsigned int> consumer_waiting;
+	alignas(CACHE_LINE_SIZE) std::atomic<unsigned long long> tail;
+	std::atomic<unsigned int> space_signal;			// Futex word the producer sleeps on
+	std::atomic<unsigned int> producer_waiting;
+	std::atomic<int> consumer_pid;					// 0 until a consumer attaches
+	std::atomic<unsigned int> detached;				// The consumer let go of the ring
+	alignas(CACHE_LINE_SIZE) std::atomic<unsigned int> closed;
+	std::atomic<unsigned long long> end_sequence;	// Sequence numbers used in all; set before closed
+} shm_ring_header;
+
+typedef struct {
+	unsigned long long sequence;
+	unsigned int length;
+	unsigned int padding;			// Nonzero for a record that only fills the end of the ring
+} shm_record_header;
+
+typedef struct {
+	unsigned long long sequence;
+	const char* data;				// Points into the ring; valid until ShmRing::release()
+	unsigned int length;
+} shm_result;
+
+// Single-producer, single-consumer ring of results in a memory-mapped file, for a
+// consumer process on the same host. A bare name puts the file in SHM_RING_DIR, so
+// the pages live in memory; a name with a slash is used as a path. The producer
+// copies each result into the ring once; the consumer reads it where it lies and
+// releases it when done, so nothing passes through the kernel. Either side spins
+// briefly and then sleeps on a process-shared futex, and is only woken when the
+// other side saw it waiting.
+class ShmRing {
+private:
+	string _path;
+	int _fd;
+	char* _base;
+	size_t _size;
+	shm_ring_header* _header;
+	char* _records;
+	unsigned long long _mask;
+	bool _producer;
+	shm_full_policy _policy;
+
+	unsigned long long _position;		// Producer: next byte to write. Consumer: next byte to read
+	unsigned long long _reserved;		// Producer: bytes taken by the record being written
+	unsigned long long _sequence;		// Producer: next sequence number. Consumer: the one expected next
+	unsigned long long _lost;
+	bool _abandoned;
+
+	bool consumer_gone(int waited_ms) const;
+	void map(size_t size, bool create);
+	bool wait_for_space(unsigned long long needed);
+	bool wait_for_data(int timeout_ms);
+public:
+	// Creates the ring at `path` with room for `capacity` bytes of records (rounded up
+	// to a power of two). Any ring there is unlinked, not overwritten, so a consumer
+	// still attached to it keeps its own pages.
+	ShmRing(const string &path, size_t capacity, shm_full_policy policy);
+	// Attaches to a ring another process created
+	ShmRing(const string &path);
+	~ShmRing();
+	ShmRing(const ShmRing&) = delete;
+	ShmRing& operator=(const ShmRing&) = delete;
+
+	// Producer. reserve() returns where to put `length` bytes, or 0 if the result was
+	// dropped, is too large for the ring, or the ring is closed; commit() publishes it.
+	// A blocking producer stops waiting once its consumer detaches or dies, or none has
+	// attached within SHM_ATTACH_TIMEOUT_MS: it is abandoned, and reserves nothing more.
+	char* reserve(unsigned int length);
+	void commit();
+	bool write(const char* data, unsigned int length);
+	void close();
+	bool abandoned() const;
+
+	// Consumer. read() fails on timeout, or once the ring is closed and drained;
+	// a negative timeout waits for as long as it takes. Release before a read that
+	// may wait: the producer may be waiting for that very space.
+	bool read(shm_result &result, int timeout_ms = -1);
+	void release();						// Frees everything read so far
+	unsigned long long lost() const;	// Results the producer dropped, from sequence gaps and, once closed, the end
+	bool closed() const;
+	size_t max_length() const;
+
+	static string path_of(const string &name);
+	static bool remove(const string &name);
+};
+
+#endif // !__RND_GEN_CORE_SHM_RING_H__
\ No newline at end of file
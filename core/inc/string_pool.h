@@ -0,0 +1,54 @@
+#ifndef __RND_GEN_CORE_STRING_POOL_H__
+#define __RND_GEN_CORE_STRING_POOL_H__
+
+#include "typedefs.h"
+
+using namespace rnd_gen;
+
+// Every Option literal in a Generator, each distinct text stored once. Texts are kept
+// as a byte stream: bytes below WORD_PREFIX are text as-is, a prefix byte and the one
+// after it name a word from a dictionary built from the texts themselves by freeze(),
+// and ESCAPE stands before a text byte that would read as a prefix. Those bytes never
+// occur in UTF-8, so encoded text is never longer than the original. Options only hold
+// an id, and append() decodes straight into the caller's output.
+// Texts are never removed; changing an Option's text just adds the new one. Reads are
+// safe from any number of threads, but add() and freeze() are not, and must not run
+// alongside anything else.
+class StringPool {
+private:
+	static constexpr unsigned char WORD_PREFIX = 0xF5;
+	static constexpr unsigned char ESCAPE = 0xFF;
+	static constexpr unsigned int MAX_WORDS = (ESCAPE - WORD_PREFIX) * 256;
+	static constexpr unsigned int NO_ID = ~0u;
+
+	vector<unsigned char> _data;
+	vector<unsigned int> _offsets;			// Entry i is _data[_offsets[i].._offsets[i + 1]]
+	vector<string> _words;
+	hashmap<string, unsigned int> _codes;	// Word to code, for encoding
+	vector<unsigned int> _index;			// Dedup table of ids, open-addressed by the hash of their bytes
+	bool _frozen;
+
+	void encode(const string &text, vector<unsigned char> &out) const;
+	const string* next(const unsigned char* &at, char &literal) const;
+	void train(const vector<string> &texts);
+	size_t hash(unsigned int id) const;
+	void rehash(size_t capacity);
+public:
+	static constexpr unsigned int EMPTY = 0;	// Id of "", which is always present
+
+	StringPool();
+	~StringPool();
+
+	unsigned int add(const string &text);
+	string get(unsigned int id) const;
+	void append(unsigned int id, string &out) const;
+	size_t length(unsigned int id) const;
+
+	void freeze();
+	bool frozen() const;
+
+	unsigned int size() const;
+	size_t bytes() const;					// Encoded size of all entries and the dictionary
+};
+
+#endif // !__RND_GEN_CORE_STRING_POOL_H__
\ No newline at end of file
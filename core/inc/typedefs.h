@@ -2,8 +2,10 @@
 #define __RND_GEN_CORE_TYPES_H__
 
 #include "core.h"
+#include "counter_engine.h"
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <unordered_map>
@@ -23,10 +25,46 @@ namespace rnd_gen {
 	template<class K, class I>
 	using hashmap = std::unordered_map<K, I>;
 
+	// Hashes strings and string_views alike, so a map keyed by name can be searched
+	// with a slice of a longer path without copying it out first
+	typedef struct {
+		typedef void is_transparent;
+		size_t operator()(std::string_view name) const {
+			return std::hash<std::string_view>()(name);
+		}
+	} name_hash;
+	template<class I>
+	using name_map = std::unordered_map<string, I, name_hash, std::equal_to<>>;
+
 	typedef struct {
 		string name;
 		string value;
 	} attribute;
+
+	typedef CounterEngine random_engine;
+	typedef unsigned int type_mask;
+
+	const char* const PATH_DELIMITER = "::";
+
+	enum gen_errno {
+		NO_OPTIONS,
+		OPTION_NOT_FOUND,
+		ITEM_NOT_FOUND,
+		CHILD_NOT_FOUND,
+		REFERENCE_CYCLE,
+		NODE_BUDGET_EXCEEDED,
+		OUTPUT_BUDGET_EXCEEDED,
+		DEPTH_BUDGET_EXCEEDED,
+		FILE_NOT_READABLE,
+		PARSE_ERROR,
+		UNKNOWN_ELEMENT,
+		NAME_COLLISION,
+		BAD_REFERENCE,
+		ITEM_SHARED,
+		UNREACHABLE_ITEM,
+
+		GEN_OTHER_ERROR
+	};
 }
 
 #endif // !__RND_GEN_CORE_TYPES_H__
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef __RND_GEN_CORE_VALIDATOR_H__
+#define __RND_GEN_CORE_VALIDATOR_H__
+
+#include "core.h"
+
+using namespace rnd_gen;
+
+typedef struct {
+	gen_errno code;
+	string document;
+	string path;					// Of the element, as Generator::find takes it
+} load_problem;
+
+// Checks a set of documents by the rules Generator::load(files, pool) applies, without
+// building any Items, and reports every problem at once instead of the first. Documents
+// are parsed and checked on a Scheduler; references are then bound across all of them
+// in the order load() binds them, and one SCC pass over containment and reference
+// edges finds the cycles evaluate() would never finish. With entry paths given, top
+// level items none of them can reach are reported as well.
+class Validator {
+private:
+	static constexpr unsigned int NO_NODE = ~0u;
+	static constexpr unsigned int ROOT = ~0u - 1;	// The Generator, as a reference's base
+
+	typedef struct {
+		string name;				// The id; empty until merge() numbers it as Item::add_child would
+		string ref;					// References only, as written
+		type_mask types;
+		unsigned int parent;		// NO_NODE at the top
+		unsigned int position;		// Among the siblings added before it
+	} entry;
+
+	// Against the local parent, since paths are only known after merge(); a position of
+	// NO_NODE is about the whole document
+	typedef struct {
+		gen_errno code;
+		unsigned int parent;
+		unsigned int position;
+		string name;
+	} local_problem;
+
+	typedef struct {
+		vector<entry> entries;		// A parent always comes before its children
+		vector<local_problem> problems;
+	} doc_result;
+
+	const Generator &_generator;
+	unsigned int _threads;
+	vector<string> _files;
+	vector<string> _entries;
+
+	vector<entry> _nodes;
+	vector<unsigned int> _doc_of;
+	hashmap<string, unsigned int> _by_name;		// Parent and name to node
+	vector<unsigned int> _child_start;			// Children of node i are _children[_child_start[i]..]
+	vector<unsigned int> _children;
+	vector<unsigned int> _top;					// Children of the Generator, in order
+	vector<unsigned int> _targets;				// Bound base of each reference, NO_NODE otherwise
+	vector<load_problem> _problems;
+
+	void check_doc(const string &xml_file, doc_result &result) const;
+	void merge(vector<doc_result> &docs);
+	string path_of(unsigned int parent, const string &name) const;
+	bool find(const string &path, unsigned int &found) const;
+	void bind_refs();
+	unsigned int edge_target(unsigned int v, unsigned int edge) const;
+	void find_cycles();
+	void find_unreachable();
+	void report(gen_errno code, unsigned int node);
+public:
+	Validator(const Generator &gen, unsigned int threads);
+	~Validator();
+
+	void add_doc(const string &xml_file);
+	void add_entry(const string &path);
+
+	vector<load_problem> run();
+};
+
+#endif // !__RND_GEN_CORE_VALIDATOR_H__
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef __RND_GEN_CORE_WEIGHT_TREE_H__
+#define __RND_GEN_CORE_WEIGHT_TREE_H__
+
+#include "typedefs.h"
+
+using namespace rnd_gen;
+
+// Weight taken off tree nodes, keyed by node index: lets one caller read the tree
+// with some slots zeroed without writing to it
+typedef hashmap<unsigned int, unsigned long long> weight_overlay;
+
+// Fenwick (binary indexed) tree over option weights: O(log n) updates and draws
+class WeightTree {
+private:
+	vector<unsigned long long> _sums;	// 1-based partial sums, _sums[0] unused
+	vector<unsigned int> _weights;
+	unsigned long long _total;
+	unsigned int _top;					// Highest power of two <= size()
+
+	unsigned long long prefix(unsigned int count) const;
+public:
+	WeightTree();
+	WeightTree(const vector<unsigned int> &weights);
+	~WeightTree();
+
+	unsigned int size() const;
+	bool empty() const;
+	unsigned long long total() const;
+
+	unsigned int weight(unsigned int index) const;
+	void weight(unsigned int index, unsigned int new_weight);
+
+	unsigned int push_back(unsigned int new_weight);
+	void pop_back();
+	void clear();
+
+	unsigned int find(unsigned long long target) const;
+	void exclude(unsigned int index, weight_overlay &overlay) const;
+	unsigned int find(unsigned long long target, const weight_overlay &overlay) const;
+	unsigned int sample(random_engine &rng) const;
+};
+
+#endif // !__RND_GEN_CORE_WEIGHT_TREE_H__
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define __RND_GEN_CORE_XML_WRAPPER_H__
 
 #include "core.h"
+#include "rapidxml.hpp"
 
 using namespace rnd_gen;
 
@@ -9,10 +10,51 @@ class XMLDoc;
 class XMLNode;
 class XMLAttr;
 
+// Read-only views over a parsed document; they point into the XMLDoc's buffer and
+// are only valid while it lives
+class XMLAttr {
+private:
+	const rapidxml::xml_attribute<>* _attr;
+public:
+	XMLAttr(const rapidxml::xml_attribute<>* base_attr);
+	~XMLAttr();
+
+	string name() const;
+	string value() const;
+};
+
 class XMLNode {
+private:
+	const rapidxml::xml_node<>* _node;
 public:
 	XMLNode();
+	XMLNode(const rapidxml::xml_node<>* base_node);
 	~XMLNode();
-}
+
+	bool valid() const;
+	const char* tag() const;
+	size_t tag_length() const;
+	string value() const;					// Text before the first child element
+
+	vector<XMLAttr> attributes() const;
+	bool has_attr(const string &attr_name) const;
+	string attr(const string &attr_name) const;
+
+	vector<XMLNode> children() const;		// Elements only, in document order
+};
+
+class XMLDoc {
+private:
+	vector<char> _text;						// rapidxml parses in place, so the buffer outlives the nodes
+	rapidxml::xml_document<> _doc;
+
+	void parse();
+public:
+	XMLDoc(const string &xml_file);
+	XMLDoc(const char* text, size_t length);
+	~XMLDoc();
+
+	XMLNode root() const;
+};
 
 #endif // !__RND_GEN_CORE_XML_WRAPPER_H__
\ No newline at end of file
@@ -0,0 +1,161 @@
+#include "core.h"
+
+Analysis::Analysis(const Item* root) {
+	_root = root;
+	walk();
+}
+
+Analysis::~Analysis() { }
+
+const Item* Analysis::root() const {
+	return _root;
+}
+
+unsigned int Analysis::size() const {
+	return _order.size();
+}
+
+bool Analysis::reaches(const Item* item) const {
+	return _index.find(item) != _index.end();
+}
+
+unsigned int Analysis::index_of(const Item* item) const {
+	hashmap<const Item*, unsigned int>::const_iterator it = _index.find(item);
+	if (it == _index.end()) throw(ITEM_NOT_FOUND);
+	return it->second;
+}
+
+// Mirrors evaluate(rng): a reference evaluates its base, a Group with options
+// evaluates one of them by weight, and anything else evaluates all its children.
+// Like evaluate, a Group whose options all weigh nothing cannot be analysed.
+void Analysis::out_edges(const Item* item, vector<const Item*> &targets, vector<Rational> &shares) const {
+	targets.clear();
+	shares.clear();
+	const ItemRef* ref = item_cast<ItemRef>(item);
+	if (ref != 0) {
+		if (ref->base() != 0) {
+			targets.push_back(ref->base());
+			shares.push_back(1);
+		}
+		return;
+	}
+	const Group* group = item_cast<Group>(item);
+	if (group != 0 && !group->options().empty()) {
+		if (group->total_weight() == 0) throw(NO_OPTIONS);
+		vector<const Option*> options = group->options();
+		for (vector<const Option*>::const_iterator it = options.begin(); it != options.end(); ++it) {
+			if ((*it)->weight() == 0) continue;
+			targets.push_back(*it);
+			shares.push_back(Rational((*it)->weight(), group->total_weight()));
+		}
+		return;
+	}
+	vector<const Item*> kids = item->children();
+	for (vector<const Item*>::const_iterator it = kids.begin(); it != kids.end(); ++it) {
+		targets.push_back(*it);
+		shares.push_back(1);
+	}
+}
+
+void Analysis::walk() {
+	// Iterative DFS so deep libraries cannot overflow the stack; a node still on
+	// the path when it is reached again means a reference cycle
+	typedef struct {
+		const Item* item;
+		unsigned int next;
+	} frame;
+	hashmap<const Item*, bool> on_path;
+	hashmap<const Item*, vector<const Item*>> targets;
+	hashmap<const Item*, vector<Rational>> shares;
+	vector<const Item*> postorder;
+	vector<frame> stack;
+
+	stack.push_back({ _root, 0 });
+	on_path[_root] = true;
+	out_edges(_root, targets[_root], shares[_root]);
+	while (!stack.empty()) {
+		frame &top = stack.back();
+		const vector<const Item*> &next = targets[top.item];
+		if (top.next == next.size()) {
+			on_path[top.item] = false;
+			postorder.push_back(top.item);
+			stack.pop_back();
+			continue;
+		}
+		const Item* child = next[top.next++];
+		hashmap<const Item*, bool>::const_iterator seen = on_path.find(child);
+		if (seen != on_path.end()) {
+			if (seen->second) throw(REFERENCE_CYCLE);
+			continue;
+		}
+		on_path[child] = true;
+		out_edges(child, targets[child], shares[child]);
+		stack.push_back({ child, 0 });
+	}
+
+	_order.assign(postorder.rbegin(), postorder.rend());
+	for (unsigned int i = 0; i < _order.size(); i++) _index[_order[i]] = i;
+	_edges.resize(_order.size());
+	_choice.resize(_order.size());
+	_expected.assign(_order.size(), Rational());
+	for (unsigned int i = 0; i < _order.size(); i++) {
+		const vector<const Item*> &to = targets[_order[i]];
+		const vector<Rational> &share = shares[_order[i]];
+		for (unsigned int j = 0; j < to.size(); j++) {
+			_edges[i].push_back({ _index[to[j]], share[j] });
+		}
+		if (!_order[i]->instanceof(ItemRef::typemask)) {
+			const Group* group = item_cast<Group>(_order[i]);
+			if (group != 0 && !group->options().empty()) _choice[i] = true;
+		}
+	}
+
+	// Push expected visit counts down the DAG in topological order
+	_expected[0] = Rational(1);
+	for (unsigned int i = 0; i < _order.size(); i++) {
+		for (vector<edge>::const_iterator it = _edges[i].begin(); it != _edges[i].end(); ++it) {
+			_expected[it->to] += _expected[i] * it->share;
+		}
+	}
+}
+
+// Expected number of times `item` is evaluated per result. For an item that can be
+// reached at most once per result, this is the probability that it is.
+Rational Analysis::expected(const Item* item) const {
+	if (!reaches(item)) return Rational();
+	return _expected[index_of(item)];
+}
+
+// Probability that `item` is evaluated at least once per result. Every evaluation
+// draws independently, so a Group's chance is the share-weighted average of its
+// options', and anything else misses only if every child misses. Hits are summed as
+// p + (1 - p) * q, which keeps each partial sum in lowest terms as it goes.
+Rational Analysis::probability(const Item* item) const {
+	if (!reaches(item)) return Rational();
+	unsigned int target = index_of(item);
+	vector<Rational> hit(_order.size());
+	for (unsigned int i = _order.size(); i-- > 0;) {
+		if (i == target) {
+			hit[i] = Rational(1);
+			continue;
+		}
+		Rational chance;
+		for (vector<edge>::const_iterator it = _edges[i].begin(); it != _edges[i].end(); ++it) {
+			if (hit[it->to].zero()) continue;
+			if (_choice[i]) chance += it->share * hit[it->to];
+			else chance += (Rational(1) - chance) * hit[it->to];
+		}
+		hit[i] = chance;
+	}
+	return hit[0];
+}
+
+vector<const Option*> Analysis::leaves() const {
+	vector<const Option*> ret;
+	for (unsigned int i = 0; i < _order.size(); i++) {
+		if (!_edges[i].empty()) continue;
+		const Option* option = item_cast<Option>(_order[i]);
+		if (option != 0) ret.push_back(option);
+	}
+	return ret;
+}
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include "core.h"
+
+static const unsigned int POOL_LINE_LENGTH = 64;
+static const unsigned int SMALL_DRAW_OPTIONS = 4;
+
+static const unsigned char UNSEEN = 0;
+static const unsigned char ON_PATH = 1;
+static const unsigned char DONE = 2;
+
+AotCompiler::AotCompiler(const Generator &gen) : _generator(gen) { }
+
+AotCompiler::~AotCompiler() { }
+
+// The Item that actually runs when `item` is evaluated
+const Item* AotCompiler::target(const Item* item) {
+	const ItemRef* ref = item_cast<ItemRef>(item);
+	while (ref != 0) {
+		item = ref->base();
+		if (item == 0) throw(ITEM_NOT_FOUND);
+		ref = item_cast<ItemRef>(item);
+	}
+	return item;
+}
+
+// What evaluate() visits from `item`: one option of a Group that has any, otherwise
+// every child in order. References are followed by the caller.
+vector<const Item*> AotCompiler::out_edges(const Item* item) {
+	const Group* group = item_cast<Group>(item);
+	if (group == 0 || group->options().empty()) return item->children();
+	vector<const Option*> options = group->options();
+	return vector<const Item*>(options.begin(), options.end());
+}
+
+// A table cannot express a tree that reaches itself, so a back edge on the walk is
+// rejected before anything is built
+void AotCompiler::check_cycles(const Item* root) {
+	hashmap<const Item*, unsigned char> state;
+	vector<std::pair<vector<const Item*>, unsigned int>> path;
+	root = target(root);
+	state[root] = ON_PATH;
+	path.push_back(std::make_pair(out_edges(root), 0u));
+	vector<const Item*> items(1, root);
+	while (!path.empty()) {
+		std::pair<vector<const Item*>, unsigned int> &top = path.back();
+		if (top.second == top.first.size()) {
+			state[items.back()] = DONE;
+			items.pop_back();
+			path.pop_back();
+			continue;
+		}
+		const Item* next = target(top.first[top.second++]);
+		unsigned char &seen = state[next];
+		if (seen == ON_PATH) throw(REFERENCE_CYCLE);
+		if (seen == DONE) continue;
+		seen = ON_PATH;
+		items.push_back(next);
+		path.push_back(std::make_pair(out_edges(next), 0u));
+	}
+}
+
+unsigned int AotCompiler::literal(const string &text) {
+	if (text.empty()) return 0;
+	hashmap<string, unsigned int>::const_iterator it = _literals.find(text);
+	if (it != _literals.end()) return it->second;
+	unsigned int offset = _pool.size();
+	_pool += text;
+	_literals[text] = offset;
+	return offset;
+}
+
+unsigned int AotCompiler::node_for(const Item* item, vector<const Item*> &pending) {
+	item = target(item);
+	hashmap<const Item*, unsigned int>::const_iterator it = _index.find(item);
+	if (it != _index.end()) return it->second;
+	unsigned int index = _nodes.size();
+	_index[item] = index;
+	_nodes.push_back(aot_node());
+	pending.push_back(item);
+	return index;
+}
+
+void AotCompiler::build(const Item* root) {
+	vector<const Item*> pending;
+	node_for(root, pending);
+	while (!pending.empty()) {
+		const Item* item = pending.back();
+		pending.pop_back();
+		unsigned int index = _index[item];
+
+		aot_node node = { 0, 0, (unsigned int)_edges.size(), 0, AOT_SEQUENCE };
+		const Option* option = item_cast<Option>(item);
+		if (option != 0) {
+			node.text = literal(option->text());
+			node.text_length = option->text().size();
+		}
+		const Group* group = item_cast<Group>(item);
+		vector<const Item*> targets = out_edges(item);
+		if (group != 0 && !group->options().empty()) {
+			// A draw that can never succeed would fail every result that reaches it
+			if (group->total_weight() == 0) throw(NO_OPTIONS);
+			node.kind = targets.size() <= SMALL_DRAW_OPTIONS ? AOT_SMALL_DRAW : AOT_DRAW;
+			unsigned long long sum = 0;
+			for (vector<const Item*>::const_iterator it = targets.begin(); it != targets.end(); ++it) {
+				sum += item_cast<Option>(*it)->weight();
+				_sums.push_back(sum);
+			}
+		}
+		else _sums.insert(_sums.end(), targets.size(), 0);
+		node.count = targets.size();
+		for (vector<const Item*>::const_iterator it = targets.begin(); it != targets.end(); ++it) {
+			_edges.push_back(node_for(*it, pending));
+		}
+		_nodes[index] = node;
+	}
+}
+
+// Throws REFERENCE_CYCLE if the path can reach itself
+void AotCompiler::add_entry(const string &path) {
+	const Item* root = _generator.find(path);
+	if (root == 0) throw(ITEM_NOT_FOUND);
+	check_cycles(root);
+	build(root);
+	_entries.push_back(std::make_pair(path, _index[target(root)]));
+}
+
+unsigned int AotCompiler::size() const {
+	return _nodes.size();
+}
+
+aot_table AotCompiler::table(vector<aot_entry> &entries) const {
+	entries.clear();
+	for (vector<std::pair<string, unsigned int>>::const_iterator it = _entries.begin(); it != _entries.end(); ++it) {
+		entries.push_back({ it->first.c_str(), it->second });
+	}
+	return { _nodes.data(), _edges.data(), _sums.data(), _pool.c_str(), entries.data(), (unsigned int)entries.size() };
+}
+
+void AotCompiler::write_literal(FILE* out, const string &text) {
+	fputc('"', out);
+	for (string::const_iterator it = text.begin(); it != text.end(); ++it) {
+		unsigned char c = *it;
+		if (c == '"' || c == '\\') fprintf(out, "\\%c", c);
+		else if (c < 0x20 || c >= 0x7F || c == '?') fprintf(out, "\\%03o", c);
+		else fputc(c, out);
+	}
+	fputc('"', out);
+}
+
+static const char* kind_name(unsigned int kind) {
+	if (kind == AOT_SMALL_DRAW) return "AOT_SMALL_DRAW";
+	if (kind == AOT_DRAW) return "AOT_DRAW";
+	return "AOT_SEQUENCE";
+}
+
+// Every array gets a trailing zero so none of them is ever empty
+void AotCompiler::write(FILE* out, const string &table_name) const {
+	const char* name = table_name.c_str();
+	fprintf(out, "// Generated by `core compile`; do not edit\n");
+	fprintf(out, "#include \"aot_runtime.h\"\n\n");
+
+	fprintf(out, "static constexpr aot_node %s_nodes[] = {\n", name);
+	for (vector<aot_node>::const_iterator it = _nodes.begin(); it != _nodes.end(); ++it) {
+		fprintf(out, "\t{ %u, %u, %u, %u, %s },\n", it->text, it->text_length, it->first, it->count, kind_name(it->kind));
+	}
+	fprintf(out, "\t{ 0, 0, 0, 0, AOT_SEQUENCE }\n};\n\n");
+
+	fprintf(out, "static constexpr unsigned int %s_edges[] = {", name);
+	for (unsigned int i = 0; i < _edges.size(); i++) fprintf(out, "%s%u,", i % 16 == 0 ? "\n\t" : " ", _edges[i]);
+	fprintf(out, "\n\t0\n};\n\n");
+
+	fprintf(out, "static constexpr unsigned long long %s_sums[] = {", name);
+	for (unsigned int i = 0; i < _sums.size(); i++) fprintf(out, "%s%lluULL,", i % 8 == 0 ? "\n\t" : " ", _sums[i]);
+	fprintf(out, "\n\t0\n};\n\n");
+
+	fprintf(out, "static constexpr char %s_pool[] =", name);
+	for (size_t i = 0; i < _pool.size(); i += POOL_LINE_LENGTH) {
+		fprintf(out, "\n\t");
+		write_literal(out, _pool.substr(i, POOL_LINE_LENGTH));
+	}
+	fprintf(out, "%s;\n\n", _pool.empty() ? " \"\"" : "");
+
+	fprintf(out, "static constexpr aot_entry %s_entries[] = {\n", name);
+	for (vector<std::pair<string, unsigned int>>::const_iterator it = _entries.begin(); it != _entries.end(); ++it) {
+		fprintf(out, "\t{ ");
+		write_literal(out, it->first);
+		fprintf(out, ", %u },\n", it->second);
+	}
+	fprintf(out, "\t{ \"\", 0 }\n};\n\n");
+
+	fprintf(out, "extern const aot_table %s = { %s_nodes, %s_edges, %s_sums, %s_pool, %s_entries, %u };\n",
+		name, name, name, name, name, name, (unsigned int)_entries.size());
+}
\ No newline at end of file
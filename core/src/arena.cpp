@@ -0,0 +1,55 @@
+#include "core.h"
+
+#include <stdint.h>
+
+Arena::Arena() {
+	_current = 0;
+	_used = 0;
+	_total = 0;
+}
+
+Arena::~Arena() {
+	for (vector<chunk>::iterator it = _chunks.begin(); it != _chunks.end(); ++it) delete[] it->data;
+}
+
+// Moves on to the next chunk when the current one is full, adding one twice the
+// size of the last (or big enough for the request) only when none is left
+void* Arena::allocate(size_t size, size_t align) {
+	while (true) {
+		if (_current < _chunks.size()) {
+			chunk &curr = _chunks[_current];
+			size_t start = (size_t)(((uintptr_t)curr.data + _used + align - 1) & ~(uintptr_t)(align - 1)) - (size_t)(uintptr_t)curr.data;
+			if (start + size <= curr.size) {
+				_total += start + size - _used;
+				_used = start + size;
+				return curr.data + start;
+			}
+			if (_current + 1 < _chunks.size()) {
+				_current++;
+				_used = 0;
+				continue;
+			}
+		}
+		size_t next = _chunks.empty() ? FIRST_CHUNK_SIZE : _chunks.back().size * 2;
+		if (next < size + align) next = size + align;
+		_chunks.push_back({ new char[next], next });
+		_current = _chunks.size() - 1;
+		_used = 0;
+	}
+}
+
+void Arena::reset() {
+	_current = 0;
+	_used = 0;
+	_total = 0;
+}
+
+size_t Arena::used() const {
+	return _total;
+}
+
+size_t Arena::capacity() const {
+	size_t ret = 0;
+	for (vector<chunk>::const_iterator it = _chunks.begin(); it != _chunks.end(); ++it) ret += it->size;
+	return ret;
+}
\ No newline at end of file
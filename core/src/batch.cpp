@@ -0,0 +1,325 @@
+#include "core.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+static void append(vector<char> &out, const char* data, size_t size) {
+	out.insert(out.end(), data, data + size);
+}
+
+static void append_number(vector<char> &out, unsigned long long value) {
+	char digits[20];
+	int used = 0;
+	do {
+		digits[used++] = '0' + value % 10;
+		value /= 10;
+	} while (value != 0);
+	while (used > 0) out.push_back(digits[--used]);
+}
+
+static void append_json(vector<char> &out, const string &text) {
+	static const char hex[] = "0123456789abcdef";
+	for (string::const_iterator it = text.begin(); it != text.end(); ++it) {
+		unsigned char c = *it;
+		if (c == '"' || c == '\\') {
+			out.push_back('\\');
+			out.push_back(c);
+		}
+		else if (c == '\n') append(out, "\\n", 2);
+		else if (c == '\t') append(out, "\\t", 2);
+		else if (c == '\r') append(out, "\\r", 2);
+		else if (c < 0x20) {
+			append(out, "\\u00", 4);
+			out.push_back(hex[c >> 4]);
+			out.push_back(hex[c & 0xf]);
+		}
+		else out.push_back(c);
+	}
+}
+
+static void append_tsv(vector<char> &out, const string &text) {
+	for (string::const_iterator it = text.begin(); it != text.end(); ++it) {
+		if (*it == '\t') append(out, "\\t", 2);
+		else if (*it == '\n') append(out, "\\n", 2);
+		else if (*it == '\r') append(out, "\\r", 2);
+		else if (*it == '\\') append(out, "\\\\", 2);
+		else out.push_back(*it);
+	}
+}
+
+batch_config default_batch_config() {
+	batch_config ret;
+	ret.count = 1;
+	ret.seed = 0;
+	ret.threads = std::thread::hardware_concurrency();
+	if (ret.threads == 0) ret.threads = 1;
+	ret.format = FORMAT_TEXT;
+	ret.formatters = 0;
+	ret.stats = false;
+	return ret;
+}
+
+// Whole decimal numbers only: no sign, no trailing text, nothing above `max`
+bool parse_number(const char* text, unsigned long long max, unsigned long long &out) {
+	if (*text < '0' || *text > '9') return false;
+	char* end;
+	errno = 0;
+	unsigned long long value = strtoull(text, &end, 10);
+	if (errno == ERANGE || *end != 0 || value > max) return false;
+	out = value;
+	return true;
+}
+
+bool parse_number(const char* text, unsigned long long max, unsigned int &out) {
+	unsigned long long value;
+	if (!parse_number(text, max, value)) return false;
+	out = (unsigned int)value;
+	return true;
+}
+
+bool parse_format(const string &name, output_format &format) {
+	if (name == "text") format = FORMAT_TEXT;
+	else if (name == "jsonl") format = FORMAT_JSONL;
+	else if (name == "tsv") format = FORMAT_TSV;
+	else if (name == "binary") format = FORMAT_BINARY;
+	else return false;
+	return true;
+}
+
+// argv[0] is the document and is left to the caller. Every flag but --stats takes
+// a value, and one that is missing, malformed or unknown rejects the whole line.
+bool parse_batch_args(int argc, const char** argv, batch_config &config) {
+	for (int i = 1; i < argc; i++) {
+		string flag = argv[i];
+		if (flag == "--stats") {
+			config.stats = true;
+			continue;
+		}
+		if (i + 1 >= argc) return false;
+		const char* value = argv[++i];
+		if (flag == "--generator") config.generator = value;
+		else if (flag == "--count") {
+			if (!parse_number(value, ULLONG_MAX, config.count)) return false;
+		}
+		else if (flag == "--seed") {
+			if (!parse_number(value, ULLONG_MAX, config.seed)) return false;
+		}
+		else if (flag == "--threads") {
+			if (!parse_number(value, MAX_THREADS, config.threads)) return false;
+		}
+		else if (flag == "--formatters") {
+			if (!parse_number(value, MAX_THREADS, config.formatters)) return false;
+		}
+		else if (flag == "--format") {
+			if (!parse_format(value, config.format)) return false;
+		}
+		else return false;
+	}
+	return !config.generator.empty() && config.threads != 0;
+}
+
+void format_result(vector<char> &out, output_format format, unsigned long long index, const string &result) {
+	switch (format) {
+	case FORMAT_TEXT:
+		append(out, result.data(), result.size());
+		out.push_back('\n');
+		break;
+	case FORMAT_JSONL:
+		append(out, "{\"index\":", 9);
+		append_number(out, index);
+		append(out, ",\"result\":\"", 11);
+		append_json(out, result);
+		append(out, "\"}\n", 3);
+		break;
+	case FORMAT_TSV:
+		append_number(out, index);
+		out.push_back('\t');
+		append_tsv(out, result);
+		out.push_back('\n');
+		break;
+	case FORMAT_BINARY: {
+		unsigned int length = result.size();
+		append(out, (const char*)&length, sizeof(length));
+		append(out, result.data(), result.size());
+		break;
+	}
+	}
+}
+
+
+
+OutputWriter::OutputWriter(int fd) {
+	_fd = fd;
+	_pending_size = 0;
+}
+
+// Never writes: callers flush() themselves so a write error surfaces where it
+// can be handled, and whatever is still queued is simply dropped
+OutputWriter::~OutputWriter() { }
+
+void OutputWriter::add(const vector<char>* buffer) {
+	if (buffer->empty()) return;
+	_pending.push_back(buffer);
+	_pending_size += buffer->size();
+}
+
+size_t OutputWriter::pending() const {
+	return _pending_size;
+}
+
+#ifdef _WIN32
+void OutputWriter::flush() {
+	// Taken out first, so a failed write leaves nothing queued behind it
+	vector<const vector<char>*> pending;
+	pending.swap(_pending);
+	_pending_size = 0;
+	for (vector<const vector<char>*>::const_iterator it = pending.begin(); it != pending.end(); ++it) {
+		size_t done = 0;
+		while (done < (*it)->size()) {
+			int wrote = _write(_fd, (*it)->data() + done, (unsigned int)((*it)->size() - done));
+			if (wrote <= 0) throw(GEN_OTHER_ERROR);
+			done += wrote;
+		}
+	}
+}
+#else
+void OutputWriter::flush() {
+	// Taken out first, so a failed write leaves nothing queued behind it
+	vector<const vector<char>*> pending;
+	pending.swap(_pending);
+	_pending_size = 0;
+	vector<iovec> iov(pending.size());
+	for (size_t i = 0; i < pending.size(); i++) {
+		iov[i].iov_base = (void*)pending[i]->data();
+		iov[i].iov_len = pending[i]->size();
+	}
+	size_t first = 0;
+	while (first < iov.size()) {
+		int batch = iov.size() - first < IOV_MAX ? iov.size() - first : IOV_MAX;
+		ssize_t wrote = writev(_fd, &iov[first], batch);
+		if (wrote < 0) {
+			if (errno == EINTR) continue;
+			throw(GEN_OTHER_ERROR);
+		}
+		// Skip fully written buffers and trim a partially written one
+		while (first < iov.size() && (size_t)wrote >= iov[first].iov_len) {
+			wrote -= iov[first].iov_len;
+			first++;
+		}
+		if (first < iov.size()) {
+			iov[first].iov_base = (char*)iov[first].iov_base + wrote;
+			iov[first].iov_len -= wrote;
+		}
+	}
+}
+#endif
+
+
+
+Batch::Batch(const Generator &gen, const batch_config &config) : _generator(gen), _config(config) {
+	if (_config.threads == 0) _config.threads = 1;
+	_item = _generator.find(_config.generator);
+	_block_count = (_config.count + BATCH_BLOCK_SIZE - 1) / BATCH_BLOCK_SIZE;
+	_blocks.resize(_config.threads * BATCH_BLOCKS_PER_THREAD);
+	_failed = false;
+}
+
+Batch::~Batch() { }
+
+void Batch::generate(unsigned long long first, unsigned long long last, vector<char> &out) const {
+	string result;
+	out.clear();
+	for (unsigned long long i = first; i < last && !_failed; i++) {
+		_item->evaluate_at(_config.seed, i, result);
+		format_result(out, _config.format, i, result);
+	}
+}
+
+// A block is cut into pieces that idle threads can steal, so one block of very
+// expensive results does not hold up the blocks written after it
+void Batch::fill(Scheduler &pool, unsigned long long block_index) {
+	block &slot = _blocks[block_index % _blocks.size()];
+	unsigned long long first = block_index * BATCH_BLOCK_SIZE;
+	unsigned long long last = first + BATCH_BLOCK_SIZE;
+	if (last > _config.count) last = _config.count;
+	slot.pieces.resize((last - first + BATCH_SPLIT_SIZE - 1) / BATCH_SPLIT_SIZE);
+	try {
+		pool.parallel_for(0, slot.pieces.size(), 1, [&](unsigned long long lo, unsigned long long hi) {
+			for (unsigned long long piece = lo; piece < hi; piece++) {
+				unsigned long long start = first + piece * BATCH_SPLIT_SIZE;
+				unsigned long long end = start + BATCH_SPLIT_SIZE < last ? start + BATCH_SPLIT_SIZE : last;
+				generate(start, end, slot.pieces[piece]);
+			}
+		});
+	}
+	catch (...) {
+		// Whatever went wrong, run() must stop waiting for this slot; the task group
+		// keeps the exception and pool.wait() rethrows it
+		{
+			std::lock_guard<std::mutex> guard(_lock);
+			_failed = true;
+			_changed.notify_all();
+		}
+		throw;
+	}
+	std::lock_guard<std::mutex> guard(_lock);
+	slot.ready = true;
+	_changed.notify_all();
+}
+
+// Blocks are queued as ring slots free up, and written strictly in order
+void Batch::run(int fd) {
+	Scheduler pool(_config.threads);
+	TaskGroup blocks;
+	unsigned long long queued = 0;
+	unsigned long long next = 0;
+	OutputWriter writer(fd);
+	try {
+		while (next < _block_count && !_failed) {
+			for (; queued < _block_count && queued < next + _blocks.size(); queued++) {
+				unsigned long long index = queued;
+				pool.spawn(blocks, [this, &pool, index] { fill(pool, index); });
+			}
+
+			unsigned long long end = next;
+			{
+				std::unique_lock<std::mutex> guard(_lock);
+				_changed.wait(guard, [&] { return _failed || _blocks[next % _blocks.size()].ready; });
+				while (end < queued && _blocks[end % _blocks.size()].ready) end++;
+			}
+			if (_failed) break;
+			for (unsigned long long i = next; i < end; i++) {
+				vector<vector<char>> &pieces = _blocks[i % _blocks.size()].pieces;
+				for (vector<vector<char>>::const_iterator it = pieces.begin(); it != pieces.end(); ++it) writer.add(&*it);
+			}
+			writer.flush();
+			{
+				std::lock_guard<std::mutex> guard(_lock);
+				for (unsigned long long i = next; i < end; i++) _blocks[i % _blocks.size()].ready = false;
+			}
+			next = end;
+		}
+	}
+	catch (...) {
+		// The fill tasks still use this frame's task group and blocks, so they are
+		// stopped and waited for before the error leaves run()
+		{
+			std::lock_guard<std::mutex> guard(_lock);
+			_failed = true;
+		}
+		try { pool.wait(blocks); }
+		catch (...) { }
+		throw;
+	}
+
+	pool.wait(blocks);
+	if (_failed) throw(GEN_OTHER_ERROR);
+}
\ No newline at end of file
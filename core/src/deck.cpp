@@ -0,0 +1,117 @@
+#include "core.h"
+
+Deck::Deck(const Group* group) : _remaining(group->_weights) {
+	_group = group;
+	_version = group->version();
+	_taken.assign(group->_options.size(), false);
+}
+
+Deck::~Deck() { }
+
+const Group* Deck::group() const {
+	return _group;
+}
+
+unsigned int Deck::drawn() {
+	sync();
+	return _drawn.size();
+}
+
+bool Deck::empty() {
+	sync();
+	return _remaining.total() == 0;
+}
+
+bool Deck::has(const Option* option) {
+	sync();
+	hashmap<const Option*, unsigned int>::const_iterator it = _group->_slots.find(option);
+	if (it == _group->_slots.end() || it->second >= _remaining.size()) return false;
+	return _remaining.weight(it->second) != 0;
+}
+
+// Reweights since the last sync keep every slot in place, so only those slots are
+// brought up to date. Slots move when options come and go, so then drawn options are
+// found again by handle; one that has since left the Group, or been deleted, is
+// simply gone from the deck.
+void Deck::sync() {
+	if (_version == _group->version()) return;
+	if (_version >= _group->_layout) {
+		for (size_t i = _version - _group->_layout; i < _group->_reweighted.size(); i++) {
+			unsigned int slot = _group->_reweighted[i];
+			if (!_taken[slot]) _remaining.weight(slot, _group->_weights.weight(slot));
+		}
+		_version = _group->version();
+		return;
+	}
+	deck_state drawn_items;
+	drawn_items.swap(_drawn_items);
+	_remaining = _group->_weights;
+	_drawn.clear();
+	_taken.assign(_group->_options.size(), false);
+	_version = _group->version();
+	take(drawn_items);
+}
+
+void Deck::take(unsigned int slot) {
+	_remaining.weight(slot, 0);
+	_drawn.push_back(slot);
+	_taken[slot] = true;
+	_drawn_items.push_back(_group->generator()->handle(_group->_options[slot]->id()));
+}
+
+void Deck::take(const deck_state &items) {
+	const Generator* gen = _group->generator();
+	for (deck_state::const_iterator it = items.begin(); it != items.end(); ++it) {
+		const Option* option = item_cast<Option>(gen->item(*it));
+		hashmap<const Option*, unsigned int>::const_iterator slot = _group->_slots.find(option);
+		if (slot != _group->_slots.end() && _remaining.weight(slot->second) != 0) take(slot->second);
+	}
+}
+
+const Option* Deck::draw(random_engine &rng) {
+	sync();
+	unsigned int slot = _remaining.sample(rng);
+	take(slot);
+	return _group->_options[slot];
+}
+
+vector<const Option*> Deck::draw(random_engine &rng, unsigned int count) {
+	vector<const Option*> ret;
+	while (ret.size() < count && !empty()) ret.push_back(draw(rng));
+	return ret;
+}
+
+void Deck::remove(const Option* option) {
+	if (!has(option)) return;
+	take(_group->_slots.find(option)->second);
+}
+
+// Only the drawn slots go back in, unless the options changed and there is a new
+// tree to copy anyway
+void Deck::reset() {
+	if (_version < _group->_layout) {
+		_remaining = _group->_weights;
+		_taken.assign(_group->_options.size(), false);
+		_version = _group->version();
+	}
+	else {
+		sync();
+		for (vector<unsigned int>::const_iterator it = _drawn.begin(); it != _drawn.end(); ++it) {
+			_remaining.weight(*it, _group->_weights.weight(*it));
+			_taken[*it] = false;
+		}
+	}
+	_drawn.clear();
+	_drawn_items.clear();
+}
+
+deck_state Deck::snapshot() {
+	sync();
+	return _drawn_items;
+}
+
+// Options that have left the Group since the snapshot are skipped, as in sync()
+void Deck::restore(const deck_state &state) {
+	reset();
+	take(state);
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include "core.h"
+
+eval_budget default_eval_budget() {
+	eval_budget budget;
+	budget.max_nodes = 1 << 20;
+	budget.max_bytes = 16 << 20;
+	budget.max_depth = 4096;
+	return budget;
+}
+
+Evaluator::Evaluator() {
+	_nodes = 0;
+}
+
+Evaluator::~Evaluator() { }
+
+void Evaluator::run(const Item* root, random_engine &rng, const eval_budget &budget, string &out) {
+	out.clear();
+	_stack.clear();
+	_arena.reset();
+	_nodes = 0;
+	if (root == 0) throw(ITEM_NOT_FOUND);
+	_stack.push_back({ root, 0 });
+	while (!_stack.empty()) {
+		frame curr = _stack.back();
+		_stack.pop_back();
+		_nodes++;
+		if (budget.max_nodes != 0 && _nodes > budget.max_nodes) throw(NODE_BUDGET_EXCEEDED);
+		if (budget.max_depth != 0 && curr.depth > budget.max_depth) throw(DEPTH_BUDGET_EXCEEDED);
+
+		const ItemRef* ref = item_cast<ItemRef>(curr.item);
+		if (ref != 0) {
+			if (ref->base() == 0) throw(ITEM_NOT_FOUND);
+			_stack.push_back({ ref->base(), curr.depth + 1 });
+			continue;
+		}
+		const Option* option = item_cast<Option>(curr.item);
+		if (option != 0) {
+			option->append_text(out);
+			if (budget.max_bytes != 0 && out.size() > budget.max_bytes) throw(OUTPUT_BUDGET_EXCEEDED);
+		}
+		const Group* group = item_cast<Group>(curr.item);
+		if (group != 0 && !group->_options.empty()) {
+			_stack.push_back({ group->draw(rng), curr.depth + 1 });
+			continue;
+		}
+
+		// Pushed last to first so the first child is evaluated first
+		arena_vector<const Item*> kids((ArenaAllocator<const Item*>(_arena)));
+		curr.item->children(kids);
+		for (arena_vector<const Item*>::const_reverse_iterator it = kids.rbegin(); it != kids.rend(); ++it) {
+			_stack.push_back({ *it, curr.depth + 1 });
+		}
+	}
+}
+
+string Evaluator::run(const Item* root, random_engine &rng, const eval_budget &budget) {
+	string ret;
+	run(root, rng, budget, ret);
+	return ret;
+}
+
+unsigned long long Evaluator::nodes() const {
+	return _nodes;
+}
\ No newline at end of file
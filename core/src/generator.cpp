@@ -0,0 +1,393 @@
+#include "core.h"
+
+Generator::Generator() : Item(*this) {
+	allocate(this);
+	register_<Item>();
+	register_<ItemRef>();
+	register_<Group>();
+	register_<GroupRef>();
+	register_<Option>();
+	register_<OptionRef>();
+	register_<GroupOption>();
+	register_<GroupOptionRef>();
+	freeze_factories();
+}
+
+// Delegating, so that a document that fails to load is cleaned up by ~Generator
+Generator::Generator(const string &xml_file) : Generator() {
+	load(xml_file);
+}
+
+// Children go first: their destructors still need the string pool and item table
+Generator::~Generator() {
+	while (!_order.empty()) {
+		Item* old_child = _order.back();
+		remove_child(old_child);
+		delete old_child;
+	}
+	release(_id);
+}
+
+type_mask Generator::types() const {
+	return Generator::typemask;
+}
+
+// The root element only groups a document's items: its children are added straight
+// to the Generator, so documents loaded one after another share a single namespace.
+// References are bound once the whole document is in, so they may point forward.
+void Generator::load(const string &xml_file) {
+	XMLDoc doc(xml_file);
+	build(vector<XMLDoc*>(1, &doc));
+}
+
+// Files are read and parsed on the pool; building items changes the Generator, so
+// that part runs here, one document after another in the order given
+void Generator::load(const vector<string> &xml_files, Scheduler &pool) {
+	load(xml_files.size(), [&xml_files](size_t i) { return new XMLDoc(xml_files[i]); }, pool);
+}
+
+// Every entry, in the bundle's name order, parsed on the pool like files are
+void Generator::load(xml::bundle &source, Scheduler &pool) {
+	vector<string> names = source.names();
+	load(names.size(), [&source, &names](size_t i) { return open_entry(source, names[i]); }, pool);
+}
+
+void Generator::load(xml::bundle &source, const string &entry_name) {
+	XMLDoc* doc = open_entry(source, entry_name);
+	try {
+		build(vector<XMLDoc*>(1, doc));
+	}
+	catch (...) {
+		delete doc;
+		throw;
+	}
+	delete doc;
+}
+
+// The bundle's own errors are reported as the same errors a missing or broken file gets
+XMLDoc* Generator::open_entry(xml::bundle &source, const string &entry_name) {
+	size_t length;
+	const char* text;
+	try {
+		text = source.data(entry_name, length);
+	}
+	catch (xml::bundle_errno err) {
+		throw(err == xml::BUNDLE_CORRUPT ? PARSE_ERROR : FILE_NOT_READABLE);
+	}
+	return new XMLDoc(text, length);
+}
+
+void Generator::load(size_t count, const std::function<XMLDoc*(size_t)> &open, Scheduler &pool) {
+	vector<XMLDoc*> docs(count, 0);
+	TaskGroup parsing;
+	for (size_t i = 0; i < count; i++) {
+		pool.spawn(parsing, [&docs, &open, i] { docs[i] = open(i); });
+	}
+	try {
+		pool.wait(parsing);
+		build(docs);
+	}
+	catch (...) {
+		for (vector<XMLDoc*>::iterator doc = docs.begin(); doc != docs.end(); ++doc) delete *doc;
+		throw;
+	}
+	for (vector<XMLDoc*>::iterator doc = docs.begin(); doc != docs.end(); ++doc) delete *doc;
+}
+
+// Every load ends here, so the size bounds evaluation reserves by are always fresh
+void Generator::build(const vector<XMLDoc*> &docs) {
+	for (vector<XMLDoc*>::const_iterator doc = docs.begin(); doc != docs.end(); ++doc) {
+		vector<XMLNode> nodes = (*doc)->root().children();
+		for (vector<XMLNode>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) add_child(*it);
+	}
+	bind_refs();
+	_documents += docs.size();
+	measure();
+}
+
+// Opt-in, as everything merged is read-only afterwards: call it once loading and
+// editing are done. Returns how many copies were replaced by references.
+unsigned int Generator::intern() {
+	unsigned int ret = Interner().intern(*this);
+	measure();
+	return ret;
+}
+
+unsigned int Generator::documents() const {
+	return _documents;
+}
+
+// The element's tag picks the class; its children are built and added in order
+Item* Generator::create(const XMLNode &node) {
+	item_factory make = factory(node.tag(), node.tag_length());
+	if (make == 0) throw(UNKNOWN_ELEMENT);
+	XMLNode base_node = node;
+	Item* ret = make(*this, base_node);
+	try {
+		vector<XMLNode> nodes = node.children();
+		for (vector<XMLNode>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) ret->add_child(*it);
+	}
+	catch (...) {
+		delete ret;
+		throw;
+	}
+	return ret;
+}
+
+// A `ref` is a path from the Generator, and must name something of the kind the
+// reference stands in for: a group_ref a Group, an option_ref an Option, and so on
+void Generator::bind_refs() {
+	const type_mask REF_BITS = ITEM_REF_BIT | GROUP_REF_BIT | OPTION_REF_BIT | GROUP_OPTION_REF_BIT;
+	vector<Item*> stack;
+	stack.push_back(this);
+	while (!stack.empty()) {
+		Item* curr = stack.back();
+		stack.pop_back();
+		ItemRef* ref = item_cast<ItemRef>(curr);
+		if (ref != 0) {
+			if (ref->base() != 0) continue;
+			if (ref->base_path().empty()) throw(BAD_REFERENCE);
+			Item* base;
+			try {
+				base = find(ref->base_path());
+			}
+			catch (gen_errno) {
+				throw(BAD_REFERENCE);
+			}
+			if (!base->instanceof(ref->types() & ~REF_BITS)) throw(BAD_REFERENCE);
+			ref->base(base);
+			continue;
+		}
+		vector<Item*> kids = curr->children();
+		for (vector<Item*>::const_iterator it = kids.begin(); it != kids.end(); ++it) stack.push_back(*it);
+	}
+}
+
+void Generator::freeze_factories() {
+	_factories.freeze();
+	_kinds.freeze();
+}
+
+item_factory Generator::factory(const char* name, size_t length) const {
+	if (!_factories.frozen()) throw(GEN_OTHER_ERROR);
+	const item_factory* found = _factories.find(name, length);
+	return found == 0 ? 0 : *found;
+}
+
+// The typemask of what factory() would build for the element, or 0 for none
+type_mask Generator::kind(const char* name, size_t length) const {
+	if (!_kinds.frozen()) throw(GEN_OTHER_ERROR);
+	const type_mask* found = _kinds.find(name, length);
+	return found == 0 ? 0 : *found;
+}
+
+// Ids are dense slot indices; freed ids are handed out again, with a bumped
+// generation so that handles taken before the reuse can tell. Items call these
+// themselves when they are made and destroyed, detached or not.
+unsigned int Generator::allocate(Item* new_item) {
+	unsigned int new_id;
+	if (!_free_ids.empty()) {
+		new_id = _free_ids.back();
+		_free_ids.pop_back();
+	}
+	else {
+		new_id = _items.size();
+		_items.push_back({ 0, 0 });
+	}
+	_items[new_id].item = new_item;
+	new_item->id(new_id);
+	return new_id;
+}
+
+void Generator::release(unsigned int old_id) {
+	if (!has_item(old_id)) return;
+	_items[old_id].item = 0;
+	_items[old_id].generation++;
+	_free_ids.push_back(old_id);
+}
+
+bool Generator::has_item(unsigned int item_id) const {
+	return item_id < _items.size() && _items[item_id].item != 0;
+}
+
+const Item* Generator::item(unsigned int item_id) const {
+	if (!has_item(item_id)) throw(ITEM_NOT_FOUND);
+	return _items[item_id].item;
+}
+Item* Generator::item(unsigned int item_id) {
+	return const_cast<Item*>(static_cast<const Generator*>(this)->item(item_id));
+}
+
+item_handle Generator::handle(unsigned int item_id) const {
+	if (!has_item(item_id)) throw(ITEM_NOT_FOUND);
+	item_handle ret = { item_id, _items[item_id].generation };
+	return ret;
+}
+
+const Item* Generator::item(const item_handle &handle) const {
+	if (handle.id >= _items.size() || _items[handle.id].generation != handle.generation) return 0;
+	return _items[handle.id].item;
+}
+Item* Generator::item(const item_handle &handle) {
+	return const_cast<Item*>(static_cast<const Generator*>(this)->item(handle));
+}
+
+unsigned int Generator::item_count() const {
+	return _items.size() - _free_ids.size();
+}
+
+ItemPath Generator::compile(const Item* root, const vector<unsigned int> &path) const {
+	ItemPath ret(root, path);
+	resolve(ret);
+	return ret;
+}
+
+// O(1) while nothing below the root has changed; otherwise the path is walked once
+// more and the new target cached. The root's epoch is read before the walk, so an
+// edit that lands during it leaves the cache stale rather than wrong. Threads that
+// refresh the same path at once all store the same values.
+const Item* Generator::resolve(const ItemPath &path) const {
+	unsigned long long epoch = path._root->epoch();
+	if (path._epoch.load(std::memory_order_acquire) == epoch) {
+		unsigned long long target = path._target.load(std::memory_order_relaxed);
+		const Item* found = item(item_handle{ (unsigned int)(target >> 32), (unsigned int)target });
+		if (found != 0) return found;
+	}
+
+	const Item* found = path._root;
+	bool through_ref = false;
+	for (vector<unsigned int>::const_iterator it = path._ids.begin(); it != path._ids.end(); ++it) {
+		if (found->instanceof(ItemRef::typemask)) through_ref = true;
+		found = found->child(*it);
+	}
+	item_handle target = handle(found->id());
+	path._target.store(((unsigned long long)target.id << 32) | target.generation, std::memory_order_relaxed);
+	path._epoch.store(through_ref ? ItemPath::UNCACHED : epoch, std::memory_order_release);
+	return found;
+}
+Item* Generator::resolve(const ItemPath &path) {
+	return const_cast<Item*>(static_cast<const Generator*>(this)->resolve(path));
+}
+
+// Segments are looked up where they lie in `path`, so a find allocates nothing.
+// A reference on the way stands for its base, as ItemRef::child() does.
+const Item* Generator::find(const string &path) const {
+	const Item* curr = this;
+	std::string_view rest = path;
+	const std::string_view delim = PATH_DELIMITER;
+	while (true) {
+		std::string_view::size_type end = rest.find(delim);
+		std::string_view name = rest.substr(0, end);
+		if (!name.empty()) {
+			for (const ItemRef* ref = item_cast<ItemRef>(curr); ref != 0; ref = item_cast<ItemRef>(curr)) {
+				if (ref->base() == 0) throw(ITEM_NOT_FOUND);
+				curr = ref->base();
+			}
+			curr = curr->find_child(name);
+			if (curr == 0) throw(ITEM_NOT_FOUND);
+		}
+		if (end == std::string_view::npos) break;
+		rest.remove_prefix(end + delim.size());
+	}
+	return curr;
+}
+Item* Generator::find(const string &path) {
+	return const_cast<Item*>(static_cast<const Generator*>(this)->find(path));
+}
+
+const StringPool& Generator::strings() const {
+	return _strings;
+}
+
+StringPool& Generator::strings() {
+	return _strings;
+}
+
+static unsigned long long saturating_add(unsigned long long a, unsigned long long b) {
+	return a > OUTPUT_UNBOUNDED - b ? OUTPUT_UNBOUNDED : a + b;
+}
+
+// Records size_bounds on every Item, children before parents. Mirrors evaluate(rng):
+// a reference takes its base's bounds, a Group with options one option by weight,
+// and anything else all its children, each after its own text if it is an Option.
+// Results only hold until the tree or any text or weight is next changed: loading
+// measures again, but a change by hand needs another call.
+void Generator::measure() {
+	hashmap<const Item*, bool> finished;		// False while the item is being measured
+	vector<std::pair<Item*, bool>> stack;
+	stack.push_back(std::make_pair(this, false));
+	for (vector<item_slot>::const_iterator it = _items.begin(); it != _items.end(); ++it) {
+		if (it->item != 0) stack.push_back(std::make_pair(it->item, false));
+	}
+
+	vector<Item*> targets;
+	vector<unsigned int> weights;
+	while (!stack.empty()) {
+		Item* item = stack.back().first;
+		bool ready = stack.back().second;
+		stack.pop_back();
+		if (!ready && finished.find(item) != finished.end()) continue;
+
+		targets.clear();
+		weights.clear();
+		ItemRef* ref = item_cast<ItemRef>(item);
+		Group* group = item_cast<Group>(item);
+		if (ref != 0) {
+			if (ref->base() != 0) targets.push_back(ref->base());
+		}
+		else if (group != 0 && !group->options().empty()) {
+			vector<Option*> options = group->options();
+			for (vector<Option*>::const_iterator it = options.begin(); it != options.end(); ++it) {
+				if ((*it)->weight() == 0) continue;
+				targets.push_back(*it);
+				weights.push_back((*it)->weight());
+			}
+		}
+		else targets = item->children();
+
+		if (!ready) {
+			finished[item] = false;
+			stack.push_back(std::make_pair(item, true));
+			for (vector<Item*>::const_iterator it = targets.begin(); it != targets.end(); ++it) {
+				if (finished.find(*it) == finished.end()) stack.push_back(std::make_pair(*it, false));
+			}
+			continue;
+		}
+
+		size_bounds bounds = { 0, 0, 0 };
+		Option* option = item_cast<Option>(item);
+		unsigned long long text = option != 0 && ref == 0 ? _strings.length(option->text_id()) : 0;
+		if (weights.empty()) {
+			for (vector<Item*>::const_iterator it = targets.begin(); it != targets.end(); ++it) {
+				// Still unfinished means it is on the current path: a cycle
+				size_bounds part = finished[*it] ? (*it)->bounds() : size_bounds{ 0, OUTPUT_UNBOUNDED, 0 };
+				bounds.min = saturating_add(bounds.min, part.min);
+				bounds.max = saturating_add(bounds.max, part.max);
+				bounds.expected += part.expected;
+			}
+		}
+		else {
+			unsigned long long total = group->total_weight();
+			bounds.min = OUTPUT_UNBOUNDED;
+			for (unsigned int i = 0; i < targets.size(); i++) {
+				size_bounds part = finished[targets[i]] ? targets[i]->bounds() : size_bounds{ 0, OUTPUT_UNBOUNDED, 0 };
+				if (part.min < bounds.min) bounds.min = part.min;
+				if (part.max > bounds.max) bounds.max = part.max;
+				bounds.expected += part.expected * weights[i] / total;
+			}
+		}
+		bounds.min = saturating_add(bounds.min, text);
+		bounds.max = saturating_add(bounds.max, text);
+		bounds.expected += text;
+		item->bounds(bounds);
+		finished[item] = true;
+	}
+}
+
+const eval_budget& Generator::budget() const {
+	return _budget;
+}
+
+void Generator::budget(const eval_budget &new_budget) {
+	_budget = new_budget;
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "core.h"
+
+const string Group::classname = "group";
+const string GroupOption::classname = "group_option";
+
+Group::Group(Generator& gen) : Item(gen) { }
+Group::Group(Generator& gen, const XMLNode &node) : Item(gen, node) { }
+Group::~Group() { }
+
+GroupOption::GroupOption(Generator& gen) : Item(gen), Option(gen), Group(gen) { }
+GroupOption::GroupOption(Generator& gen, const XMLNode &node) : Item(gen, node), Option(gen, node), Group(gen, node) { }
+GroupOption::~GroupOption() { }
+
+type_mask Group::types() const {
+	return Group::typemask;
+}
+type_mask GroupOption::types() const {
+	return GroupOption::typemask;
+}
+
+void Group::add_child(Item* new_child) {
+	Item::add_child(new_child);
+	Option* new_option = item_cast<Option>(new_child);
+	if (new_option != 0 && !has_option(new_option)) push_option(new_option);
+}
+
+void Group::remove_child(Item* old_child) {
+	Option* old_option = item_cast<Option>(old_child);
+	if (old_option != 0 && has_option(old_option)) {
+		check_writable(old_child);
+		drop_option(old_option);
+	}
+	Item::remove_child(old_child);
+}
+
+// The child always keeps its place among the others, so a Group without options
+// still reads out its children in the same order. An option replaced by an option
+// also keeps its slot, so the same draws still pick the same position.
+void Group::replace_child(Item* old_child, Item* new_child) {
+	if (old_child == new_child) return;
+	Option* old_option = item_cast<Option>(old_child);
+	Option* new_option = item_cast<Option>(new_child);
+	bool old_slot = old_option != 0 && has_option(old_option);
+	Item::replace_child(old_child, new_child);
+	// Checked afterwards: a sibling moving into the old place has just left its slot
+	bool new_slot = new_option != 0 && !has_option(new_option);
+	if (old_slot && new_slot) {
+		unsigned int slot = _slots[old_option];
+		_slots.erase(old_option);
+		_slots[new_option] = slot;
+		_options[slot] = new_option;
+		_weights.weight(slot, new_option->weight());
+		relayout();
+		return;
+	}
+	if (old_slot) drop_option(old_option);
+	if (new_slot) push_option(new_option);
+}
+
+void Group::push_option(Option* new_option) {
+	_slots[new_option] = _weights.push_back(new_option->weight());
+	_options.push_back(new_option);
+	relayout();
+}
+
+// Swap the last option into the freed slot so the tree stays dense
+void Group::drop_option(Option* old_option) {
+	unsigned int slot = _slots[old_option];
+	Option* last = _options.back();
+	_weights.weight(slot, _weights.weight(_options.size() - 1));
+	_weights.pop_back();
+	_options[slot] = last;
+	_slots[last] = slot;
+	_options.pop_back();
+	_slots.erase(old_option);
+	relayout();
+}
+
+// Decks rebuild from scratch after this; plain reweights they replay slot by slot
+void Group::relayout() {
+	_version++;
+	_layout = _version;
+	_reweighted.clear();
+}
+
+vector<const Option*> Group::options() const {
+	return vector<const Option*>(_options.begin(), _options.end());
+}
+vector<Option*> Group::options() {
+	return _options;
+}
+
+bool Group::has_option(const Option* option) const {
+	return _slots.find(option) != _slots.end();
+}
+
+unsigned long long Group::total_weight() const {
+	return _weights.total();
+}
+
+void Group::reweight(const Option* option) {
+	hashmap<const Option*, unsigned int>::const_iterator it = _slots.find(option);
+	if (it == _slots.end()) throw(OPTION_NOT_FOUND);
+	_weights.weight(it->second, option->weight());
+	// Once the log is as long as the options, a rebuild costs no more than replaying it
+	if (_reweighted.size() >= _options.size()) {
+		relayout();
+		return;
+	}
+	_reweighted.push_back(it->second);
+	_version++;
+}
+
+unsigned long long Group::version() const {
+	return _version;
+}
+
+const Option* Group::draw(random_engine &rng) const {
+	if (_options.empty()) throw(NO_OPTIONS);
+	return _options[_weights.sample(rng)];
+}
+Option* Group::draw(random_engine &rng) {
+	return const_cast<Option*>(static_cast<const Group*>(this)->draw(rng));
+}
+
+// Picks are taken off a per-call overlay of tree nodes that find() reads through, so
+// the Group's own tree is never written and other threads may draw from it meanwhile.
+// Each pick is O(log n). Options of weight zero are never drawn, so once every other
+// option has been picked the result stops short of count.
+vector<const Option*> Group::draw(random_engine &rng, unsigned int count) const {
+	vector<const Option*> ret;
+	weight_overlay picked;
+	unsigned long long remaining = _weights.total();
+	while (ret.size() < count && remaining > 0) {
+		unsigned int slot = _weights.find(rng.below(remaining), picked);
+		ret.push_back(_options[slot]);
+		_weights.exclude(slot, picked);
+		remaining -= _weights.weight(slot);
+	}
+	return ret;
+}
+vector<Option*> Group::draw(random_engine &rng, unsigned int count) {
+	vector<const Option*> picked = static_cast<const Group*>(this)->draw(rng, count);
+	vector<Option*> ret;
+	ret.reserve(picked.size());
+	for (vector<const Option*>::const_iterator it = picked.begin(); it != picked.end(); ++it) ret.push_back(const_cast<Option*>(*it));
+	return ret;
+}
\ No newline at end of file
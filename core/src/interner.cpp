@@ -0,0 +1,237 @@
+#include "core.h"
+
+#include <algorithm>
+
+static const char* IDENTITY_ATTRS[] = { "id", "name", "ref" };
+
+static void put(string &out, const string &field) {
+	unsigned int length = field.size();
+	out.append((const char*)&length, sizeof(length));
+	out += field;
+}
+
+static void put(string &out, unsigned long long value) {
+	out.append((const char*)&value, sizeof(value));
+}
+
+static bool attr_less(const attribute &a, const attribute &b) {
+	return a.name < b.name;
+}
+
+Interner::Interner() { }
+
+Interner::~Interner() { }
+
+unsigned int Interner::classes() const {
+	return _classes.size();
+}
+
+// References are never collapsed: they are already as small as an Item gets, and a
+// reference to a reference is not allowed. GroupOption has no reference type to stand in.
+bool Interner::internable(const Item* item) {
+	if (item->instanceof(ItemRef::typemask)) return false;
+	if (item->instanceof(GroupOption::typemask)) return false;
+	return true;
+}
+
+string Interner::key(Item* item) {
+	string ret;
+	ItemRef* ref = item_cast<ItemRef>(item);
+	if (ref != 0) {
+		// References match when they share a base
+		ret = "@";
+		put(ret, (unsigned long long)ref->base());
+		return ret;
+	}
+	if (!internable(item)) {
+		// Unique per instance, which also keeps every ancestor from matching
+		ret = "!";
+		put(ret, (unsigned long long)item);
+		return ret;
+	}
+
+	put(ret, item->types());
+	Option* option = item_cast<Option>(item);
+	if (option != 0) {
+		put(ret, option->weight());
+		put(ret, option->text_id());
+	}
+
+	vector<attribute> attrs = item->attributes();
+	std::sort(attrs.begin(), attrs.end(), attr_less);
+	for (vector<attribute>::const_iterator it = attrs.begin(); it != attrs.end(); ++it) {
+		bool identity = false;
+		for (unsigned int i = 0; i < sizeof(IDENTITY_ATTRS) / sizeof(IDENTITY_ATTRS[0]); i++) {
+			if (it->name == IDENTITY_ATTRS[i]) identity = true;
+		}
+		if (identity) continue;
+		put(ret, it->name);
+		put(ret, it->value);
+	}
+
+	// Child names are part of the structure, as paths are resolved through them, and
+	// so is their order: a sequence evaluates its children in order
+	vector<Item*> children = item->children();
+	put(ret, children.size());
+	for (vector<Item*>::const_iterator it = children.begin(); it != children.end(); ++it) {
+		put(ret, (*it)->name());
+		put(ret, _class_of[*it]);
+	}
+	// A draw maps the same number to the same slot, and slots need not follow child
+	// order once options have been removed
+	Group* group = item_cast<Group>(item);
+	if (group != 0) {
+		vector<Option*> options = group->options();
+		put(ret, options.size());
+		for (vector<Option*>::const_iterator it = options.begin(); it != options.end(); ++it) put(ret, _class_of[*it]);
+	}
+	return ret;
+}
+
+// Pass 1, bottom-up: number every structurally distinct subtree and count its copies
+void Interner::classify(Item* root) {
+	typedef struct {
+		Item* item;
+		bool expanded;
+	} frame;
+	vector<frame> stack;
+	stack.push_back({ root, false });
+	while (!stack.empty()) {
+		frame top = stack.back();
+		stack.pop_back();
+		if (!top.expanded && internable(top.item)) {
+			stack.push_back({ top.item, true });
+			vector<Item*> children = top.item->children();
+			for (vector<Item*>::const_iterator it = children.begin(); it != children.end(); ++it) {
+				stack.push_back({ *it, false });
+			}
+			continue;
+		}
+		string item_key = key(top.item);
+		hashmap<string, unsigned int>::const_iterator found = _classes.find(item_key);
+		unsigned int id;
+		if (found != _classes.end()) id = found->second;
+		else {
+			id = _counts.size();
+			_classes[item_key] = id;
+			_counts.push_back(0);
+			_canonical.push_back(0);
+			_merged.push_back(false);
+		}
+		_counts[id]++;
+		_class_of[top.item] = id;
+	}
+}
+
+// Pass 2, top-down: the first copy met keeps its place, later copies are swapped
+// for references in the same position. Going top-down means a removed copy's
+// descendants are never visited, so no canonical instance can live inside a
+// removed subtree.
+void Interner::share(Item* root) {
+	vector<Item*> stack;
+	stack.push_back(root);
+	while (!stack.empty()) {
+		Item* curr = stack.back();
+		stack.pop_back();
+		if (!internable(curr)) continue;
+		unsigned int id = _class_of[curr];
+		if (curr != root && _counts[id] > 1 && _canonical[id] != 0) {
+			Item* canonical = _canonical[id];
+			Item* parent = curr->parent();
+			ItemRef* ref;
+			if (canonical->instanceof(Group::typemask)) ref = new GroupRef(item_cast<Group>(canonical));
+			else if (canonical->instanceof(Option::typemask)) ref = new OptionRef(item_cast<Option>(canonical));
+			else ref = new ItemRef(canonical);
+			// The parent may itself be shared from an earlier pass; swapping a copy for
+			// a reference to the same structure leaves its output as it was
+			bool parent_shared = parent->shared();
+			parent->shared(false);
+			parent->replace_child(curr, ref);
+			parent->shared(parent_shared);
+			_removed.push_back(curr);
+			_merged[id] = true;
+			continue;
+		}
+		if (_canonical[id] == 0) _canonical[id] = curr;
+		// Reversed, so children are met in order and the first copy is the one kept
+		vector<Item*> children = curr->children();
+		for (vector<Item*>::const_reverse_iterator it = children.rbegin(); it != children.rend(); ++it) {
+			stack.push_back(*it);
+		}
+	}
+}
+
+// Anything inside a removed copy matches the same position inside the canonical copy,
+// so it has a canonical instance of its own for references to move to
+void Interner::forward(Item* removed) {
+	vector<Item*> stack;
+	stack.push_back(removed);
+	while (!stack.empty()) {
+		Item* curr = stack.back();
+		stack.pop_back();
+		if (!internable(curr)) continue;
+		Item* canonical = _canonical[_class_of[curr]];
+		if (canonical != 0 && canonical != curr) _replaced[curr] = canonical;
+		vector<Item*> children = curr->children();
+		for (vector<Item*>::const_iterator it = children.begin(); it != children.end(); ++it) {
+			stack.push_back(*it);
+		}
+	}
+}
+
+// What the references now point at, and everything under it, stands for every
+// merged copy, so none of it may change on its own any more
+void Interner::mark_shared() {
+	vector<Item*> stack;
+	for (unsigned int id = 0; id < _canonical.size(); id++) {
+		if (_merged[id]) stack.push_back(_canonical[id]);
+	}
+	while (!stack.empty()) {
+		Item* curr = stack.back();
+		stack.pop_back();
+		if (curr->shared()) continue;
+		curr->shared(true);
+		ItemRef* ref = item_cast<ItemRef>(curr);
+		if (ref != 0) continue;
+		vector<Item*> children = curr->children();
+		stack.insert(stack.end(), children.begin(), children.end());
+	}
+}
+
+Item* Interner::stand_in(Item* original) const {
+	hashmap<const Item*, Item*>::const_iterator it = _replaced.find(original);
+	if (it == _replaced.end()) return original;
+	return it->second;
+}
+
+// Goes through the Generator's item table rather than the tree, so references held
+// outside it, in another document or not attached at all, are moved too
+void Interner::rebind(Generator &gen) {
+	unsigned int live = gen.item_count();
+	for (unsigned int id = 0, seen = 0; seen < live; id++) {
+		if (!gen.has_item(id)) continue;
+		seen++;
+		ItemRef* ref = item_cast<ItemRef>(gen.item(id));
+		if (ref != 0 && ref->base() != stand_in(ref->base())) ref->base(stand_in(ref->base()));
+	}
+}
+
+// Every reference is moved off the removed copies before any of them is deleted, and
+// deleting them gives their ids back to the Generator
+unsigned int Interner::intern(Generator &gen) {
+	_classes.clear();
+	_class_of.clear();
+	_counts.clear();
+	_canonical.clear();
+	_merged.clear();
+	_replaced.clear();
+	_removed.clear();
+
+	classify(&gen);
+	share(&gen);
+	for (vector<Item*>::const_iterator it = _removed.begin(); it != _removed.end(); ++it) forward(*it);
+	rebind(gen);
+	for (vector<Item*>::const_iterator it = _removed.begin(); it != _removed.end(); ++it) delete *it;
+	mark_shared();
+	return _removed.size();
+}
\ No newline at end of file
@@ -0,0 +1,411 @@
+#include "core.h"
+
+#include <random>
+
+const string Item::classname = "item";
+
+static const unsigned long long RESERVE_EXACT_LIMIT = 64 * 1024;
+const char* const Item::id_attr = "id";
+
+// Every Item takes a slot in its Generator's table for its whole life. The
+// Generator itself is not built yet at this point, so it takes its own slot later.
+Item::Item(Generator& gen) : _generator(gen) {
+	_id = 0;
+	_parent = 0;
+	if (&_generator != this) _generator.allocate(this);
+}
+
+// Every attribute is kept as written, and the element's id names the Item
+Item::Item(Generator& gen, const XMLNode &node) : Item(gen) {
+	vector<XMLAttr> attrs = node.attributes();
+	for (vector<XMLAttr>::const_iterator it = attrs.begin(); it != attrs.end(); ++it) {
+		_attrs[it->name()] = { it->name(), it->value() };
+	}
+	if (node.has_attr(id_attr)) _name = node.attr(id_attr);
+}
+
+// An Item owns its children. Their parent link is cut first so that they do not
+// try to detach from an Item that is already half destroyed.
+Item::~Item() {
+	_dying = true;
+	for (vector<Item*>::iterator it = _order.begin(); it != _order.end(); ++it) {
+		if (*it == 0) continue;
+		(*it)->_parent = 0;
+		delete *it;
+	}
+	_children.clear();
+	_order.clear();
+	if (_parent != 0) _parent->remove_child(this);
+	if (&_generator != this) _generator.release(_id);
+}
+
+bool Item::is(const Item* item) {
+	return item != 0;
+}
+
+type_mask Item::types() const {
+	return Item::typemask;
+}
+
+unsigned int Item::id() const {
+	return _id;
+}
+
+void Item::id(unsigned int new_id) {
+	_id = new_id;
+}
+
+string Item::name() const {
+	return _name;
+}
+
+void Item::name(const string& new_name) {
+	if (new_name == _name) return;
+	if (_parent != 0) _parent->check_writable();
+	if (_parent != 0 && _parent->has_child(new_name)) throw(NAME_COLLISION);
+	Item* old_parent = _parent;
+	if (old_parent != 0) old_parent->remove_child(this);
+	_name = new_name;
+	if (old_parent != 0) old_parent->add_child(this);
+}
+
+const Generator* Item::generator() const {
+	return &_generator;
+}
+Generator* Item::generator() {
+	return &_generator;
+}
+
+// Children come back in the order they were added, which for a loaded document is
+// document order, so that sequences evaluate the way they are written
+vector<const Item*> Item::children() const {
+	vector<const Item*> out;
+	out.reserve(_order.size() - _holes);
+	for (Item* child : _order) if (child != 0) out.push_back(child);
+	return out;
+}
+vector<Item*> Item::children() {
+	vector<Item*> out;
+	out.reserve(_order.size() - _holes);
+	for (Item* child : _order) if (child != 0) out.push_back(child);
+	return out;
+}
+
+// Same order as children(), appended to a list the caller owns
+void Item::children(arena_vector<const Item*> &out) const {
+	for (Item* child : _order) if (child != 0) out.push_back(child);
+}
+
+const Item* Item::child(const string &child_name) const {
+	name_map<Item*>::const_iterator it = _children.find(child_name);
+	if (it == _children.end()) throw(CHILD_NOT_FOUND);
+	return it->second;
+}
+Item* Item::child(const string &child_name) {
+	return const_cast<Item*>(static_cast<const Item*>(this)->child(child_name));
+}
+
+const Item* Item::find_child(std::string_view child_name) const {
+	name_map<Item*>::const_iterator it = _children.find(child_name);
+	return it == _children.end() ? 0 : it->second;
+}
+
+// Ids index the Generator's item table directly, so a lookup is one array read
+// plus a check that the item really hangs off this one
+const Item* Item::child(unsigned int child_id) const {
+	if (!_generator.has_item(child_id)) throw(CHILD_NOT_FOUND);
+	const Item* found = _generator.item(child_id);
+	if (found->parent() != this) throw(CHILD_NOT_FOUND);
+	return found;
+}
+Item* Item::child(unsigned int child_id) {
+	return const_cast<Item*>(static_cast<const Item*>(this)->child(child_id));
+}
+
+const Item* Item::child(const vector<unsigned int> &child_path) const {
+	const Item* curr = this;
+	for (vector<unsigned int>::const_iterator it = child_path.begin(); it != child_path.end(); ++it) {
+		curr = curr->child(*it);
+	}
+	return curr;
+}
+Item* Item::child(const vector<unsigned int> &child_path) {
+	return const_cast<Item*>(static_cast<const Item*>(this)->child(child_path));
+}
+
+bool Item::has_child(const Item* child) const {
+	if (child == 0) return false;
+	name_map<Item*>::const_iterator it = _children.find(child->name());
+	return it != _children.end() && it->second == child;
+}
+
+bool Item::has_child(const string &child_name) const {
+	return _children.find(child_name) != _children.end();
+}
+
+bool Item::has_child(unsigned int child_id) const {
+	return _generator.has_item(child_id) && _generator.item(child_id)->parent() == this;
+}
+
+bool Item::has_child(const vector<unsigned int> &child_path) const {
+	const Item* curr = this;
+	for (vector<unsigned int>::const_iterator it = child_path.begin(); it != child_path.end(); ++it) {
+		if (!curr->has_child(*it)) return false;
+		curr = curr->child(*it);
+	}
+	return true;
+}
+
+// Names are unique among siblings: a child may not displace another of the same name
+void Item::add_child(Item* new_child) {
+	if (new_child->_parent == this && has_child(new_child)) return;
+	check_writable();
+	if (has_child(new_child->name())) throw(NAME_COLLISION);
+	if (new_child->has_parent()) new_child->_parent->remove_child(new_child);
+	_children[new_child->name()] = new_child;
+	new_child->_position = (unsigned int)_order.size();
+	_order.push_back(new_child);
+	new_child->_parent = this;
+	touch();
+}
+
+// Builds the element with its class's factory. Unnamed elements are named for their
+// position, so that siblings like the options of a Group need no ids.
+void Item::add_child(const XMLNode &child_node) {
+	Item* new_child = _generator.create(child_node);
+	if (new_child->name().empty()) new_child->_name = "#" + std::to_string(_children.size());
+	try {
+		add_child(new_child);
+	}
+	catch (...) {
+		delete new_child;
+		throw;
+	}
+}
+
+// The child is handed back to the caller, who now owns it
+void Item::remove_child(Item* old_child) {
+	if (!has_child(old_child)) return;
+	check_writable(old_child);
+	_children.erase(old_child->name());
+	unlink(old_child);
+	old_child->_parent = 0;
+	touch();
+}
+
+// Leaves a 0 in the child's place rather than shifting the rest down. Trailing
+// zeroes are dropped at once, so _order never ends in one, and the rest are
+// squeezed out when they reach half of it, which keeps removal O(1) amortised.
+void Item::unlink(Item* old_child) {
+	_order[old_child->_position] = 0;
+	_holes++;
+	while (!_order.empty() && _order.back() == 0) {
+		_order.pop_back();
+		_holes--;
+	}
+	if (_holes * 2 < _order.size()) return;
+	unsigned int kept = 0;
+	for (Item* child : _order) {
+		if (child == 0) continue;
+		child->_position = kept;
+		_order[kept++] = child;
+	}
+	_order.resize(kept);
+	_holes = 0;
+}
+
+// The new child takes the old one's name and position, which keeps a sequence's
+// output unchanged; the old one is detached and handed back to the caller
+void Item::replace_child(Item* old_child, Item* new_child) {
+	if (old_child == new_child) return;
+	if (!has_child(old_child)) throw(CHILD_NOT_FOUND);
+	check_writable();
+	if (new_child->has_parent()) new_child->_parent->remove_child(new_child);
+	new_child->_name = old_child->_name;
+	_children[old_child->_name] = new_child;
+	// Read after the removal above, which may have squeezed this Item's _order
+	new_child->_position = old_child->_position;
+	_order[new_child->_position] = new_child;
+	old_child->_parent = 0;
+	new_child->_parent = this;
+	touch();
+}
+
+void Item::remove_child(const string &child_name) {
+	remove_child(child(child_name));
+}
+
+void Item::remove_child(unsigned int child_id) {
+	remove_child(child(child_id));
+}
+
+// Detaches the item at the end of the path from its own parent
+void Item::remove_child(const vector<unsigned int> &child_path) {
+	Item* old_child = child(child_path);
+	if (old_child != this) old_child->_parent->remove_child(old_child);
+}
+
+bool Item::has_parent() const {
+	return _parent != 0;
+}
+
+const Item* Item::parent() const {
+	return _parent;
+}
+Item* Item::parent() {
+	return _parent;
+}
+
+void Item::parent(Item* new_parent) {
+	if (new_parent == _parent) return;
+	if (new_parent != 0) new_parent->add_child(this);
+	else _parent->remove_child(this);
+}
+
+unsigned long long Item::epoch() const {
+	return _epoch.load(std::memory_order_acquire);
+}
+
+bool Item::shared() const {
+	return _shared;
+}
+
+void Item::shared(bool is_shared) {
+	_shared = is_shared;
+}
+
+// A child being destroyed may always leave, as a destructor cannot fail
+void Item::check_writable(const Item* removed) const {
+	if (_shared && (removed == 0 || !removed->_dying)) throw(ITEM_SHARED);
+}
+
+// Paths are cached against their root's epoch, so every ancestor has to see the change
+void Item::touch() {
+	for (Item* curr = this; curr != 0; curr = curr->_parent) curr->_epoch.fetch_add(1, std::memory_order_release);
+}
+
+vector<attribute> Item::attributes() const {
+	vector<attribute> ret;
+	ret.reserve(_attrs.size());
+	for (hashmap<string, attribute>::const_iterator it = _attrs.begin(); it != _attrs.end(); ++it) ret.push_back(it->second);
+	return ret;
+}
+vector<attribute> Item::attributes() {
+	return static_cast<const Item*>(this)->attributes();
+}
+
+// A missing attribute reads as empty; has_attr() tells the two apart
+string Item::attr(const string &attr_name) const {
+	hashmap<string, attribute>::const_iterator it = _attrs.find(attr_name);
+	return it == _attrs.end() ? string() : it->second.value;
+}
+
+void Item::attr(const string &attr_name, const string &attr_value) {
+	add_attr(attr_name, attr_value);
+}
+
+bool Item::has_attr(const attribute attr) const {
+	hashmap<string, attribute>::const_iterator it = _attrs.find(attr.name);
+	return it != _attrs.end() && it->second.value == attr.value;
+}
+
+bool Item::has_attr(const string &attr_name) const {
+	return _attrs.find(attr_name) != _attrs.end();
+}
+
+void Item::add_attr(const attribute &attr) {
+	check_writable();
+	_attrs[attr.name] = attr;
+}
+
+void Item::add_attr(const string &attr_name) {
+	add_attr(attr_name, string());
+}
+
+void Item::add_attr(const string &attr_name, const string& attr_value) {
+	check_writable();
+	_attrs[attr_name] = { attr_name, attr_value };
+}
+
+void Item::remove_attr(const attribute attr) {
+	check_writable();
+	if (has_attr(attr)) _attrs.erase(attr.name);
+}
+
+void Item::remove_attr(const string &attr_name) {
+	check_writable();
+	_attrs.erase(attr_name);
+}
+
+const string& Item::operator[](const string &attr_name) const {
+	static const string missing;
+	hashmap<string, attribute>::const_iterator it = _attrs.find(attr_name);
+	return it == _attrs.end() ? missing : it->second.value;
+}
+
+string& Item::operator[](const string &attr_name) {
+	check_writable();
+	attribute &found = _attrs[attr_name];
+	found.name = attr_name;
+	return found.value;
+}
+
+// Exact when the longest result is cheap enough to always pay for; past that, the
+// expected length plus some slack, and the rare longer result grows as it must.
+// Never more than the budget would let the result reach.
+static size_t reservation(const size_bounds &bounds, const eval_budget &budget) {
+	unsigned long long ret = bounds.max;
+	if (ret > RESERVE_EXACT_LIMIT) ret = (unsigned long long)(bounds.expected * 1.25);
+	if (budget.max_bytes != 0 && ret > budget.max_bytes) ret = budget.max_bytes;
+	return (size_t)ret;
+}
+
+// Without a seed, each call draws a fresh one
+string Item::evaluate() const {
+	std::random_device device;
+	random_engine rng(((unsigned long long)device() << 32) | device(), 0);
+	return evaluate(rng);
+}
+
+// Every evaluation goes through the iterative evaluator under the Generator's budget,
+// into one string reserved up front; each thread keeps its evaluator between calls
+static Evaluator& thread_evaluator() {
+	static thread_local Evaluator evaluator;
+	return evaluator;
+}
+
+string Item::evaluate(random_engine &rng) const {
+	string ret;
+	ret.reserve(reservation(_bounds, _generator.budget()));
+	thread_evaluator().run(this, rng, _generator.budget(), ret);
+	return ret;
+}
+
+const size_bounds& Item::bounds() const {
+	return _bounds;
+}
+
+void Item::bounds(const size_bounds &new_bounds) {
+	_bounds = new_bounds;
+}
+
+string Item::evaluate_at(unsigned long long seed, unsigned long long index) const {
+	string ret;
+	evaluate_at(seed, index, ret);
+	return ret;
+}
+
+void Item::evaluate_at(unsigned long long seed, unsigned long long index, string &out) const {
+	random_engine rng(seed, index);
+	out.reserve(reservation(_bounds, _generator.budget()));
+	thread_evaluator().run(this, rng, _generator.budget(), out);
+}
+
+// Results first, first + 1, ... of `seed`, made one at a time as the consumer pulls
+ResultStream Item::stream(unsigned long long seed, unsigned long long first) const {
+	string buffer;
+	for (unsigned long long index = first;; index++) {
+		evaluate_at(seed, index, buffer);
+		co_yield buffer;
+	}
+}
\ No newline at end of file
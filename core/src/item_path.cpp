@@ -0,0 +1,33 @@
+#include "core.h"
+
+ItemPath::ItemPath() : _target(0), _epoch(UNCACHED) {
+	_root = 0;
+}
+
+ItemPath::ItemPath(const Item* root, const vector<unsigned int> &ids) : ItemPath() {
+	_root = root;
+	_ids = ids;
+}
+
+ItemPath::ItemPath(const ItemPath &other) : _target(other._target.load()), _epoch(other._epoch.load()) {
+	_root = other._root;
+	_ids = other._ids;
+}
+
+ItemPath::~ItemPath() { }
+
+ItemPath& ItemPath::operator=(const ItemPath &other) {
+	_root = other._root;
+	_ids = other._ids;
+	_target = other._target.load();
+	_epoch = other._epoch.load();
+	return *this;
+}
+
+const Item* ItemPath::root() const {
+	return _root;
+}
+
+const vector<unsigned int>& ItemPath::ids() const {
+	return _ids;
+}
\ No newline at end of file
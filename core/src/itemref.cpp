@@ -0,0 +1,273 @@
+#include "core.h"
+
+const string ItemRef::classname = "item_ref";
+const string GroupRef::classname = "group_ref";
+const string OptionRef::classname = "option_ref";
+const string GroupOptionRef::classname = "group_option_ref";
+
+type_mask ItemRef::types() const {
+	return ItemRef::typemask;
+}
+type_mask GroupRef::types() const {
+	return GroupRef::typemask;
+}
+type_mask OptionRef::types() const {
+	return OptionRef::typemask;
+}
+type_mask GroupOptionRef::types() const {
+	return GroupOptionRef::typemask;
+}
+
+const char* const ItemRef::ref_attr = "ref";
+
+ItemRef::ItemRef(Generator& gen) : Item(gen) {
+	_base = 0;
+}
+
+ItemRef::ItemRef(Generator& gen, const XMLNode &node) : Item(gen, node) {
+	_base = 0;
+	_base_path = node.attr(ref_attr);
+}
+
+ItemRef::ItemRef(Item* base) : Item(*base->generator()) {
+	_base = base;
+}
+
+ItemRef::~ItemRef() { }
+
+GroupRef::GroupRef(Generator &gen) : Item(gen), Group(gen), ItemRef(gen) { }
+GroupRef::GroupRef(Generator &gen, const XMLNode &node) : Item(gen, node), Group(gen), ItemRef(gen, node) { }
+GroupRef::GroupRef(Group* base) : Item(*base->generator()), Group(*base->generator()), ItemRef(base) { }
+GroupRef::~GroupRef() { }
+
+OptionRef::OptionRef(Generator &gen) : Item(gen), Option(gen), ItemRef(gen) { }
+OptionRef::OptionRef(Generator &gen, const XMLNode &node) : Item(gen, node), Option(gen, node), ItemRef(gen, node) { }
+OptionRef::OptionRef(Option* base) : Item(*base->generator()), Option(*base->generator()), ItemRef(base) { }
+OptionRef::~OptionRef() { }
+
+GroupOptionRef::GroupOptionRef(Generator& gen) : Item(gen), Option(gen), Group(gen), ItemRef(gen), GroupOption(gen), GroupRef(gen) { }
+GroupOptionRef::GroupOptionRef(Generator& gen, const XMLNode &node)
+	: Item(gen, node), Option(gen, node), Group(gen), ItemRef(gen, node), GroupOption(gen, node), GroupRef(gen, node) { }
+GroupOptionRef::~GroupOptionRef() { }
+
+const Item* ItemRef::base() const {
+	return _base;
+}
+Item* ItemRef::base() {
+	return _base;
+}
+
+// The base is not owned; whoever removes it must rebind or remove its references
+void ItemRef::base(Item* new_base) {
+	_base = new_base;
+	touch();
+}
+
+const string& ItemRef::base_path() const {
+	return _base_path;
+}
+
+// Everything below forwards to the base. An unbound reference has no children or
+// attributes, and anything that would change them fails.
+vector<const Item*> ItemRef::children() const {
+	if (_base == 0) return vector<const Item*>();
+	return static_cast<const Item*>(_base)->children();
+}
+vector<Item*> ItemRef::children() {
+	if (_base == 0) return vector<Item*>();
+	return _base->children();
+}
+
+void ItemRef::children(arena_vector<const Item*> &out) const {
+	if (_base != 0) static_cast<const Item*>(_base)->children(out);
+}
+
+const Item* ItemRef::child(const string &name) const {
+	if (_base == 0) throw(CHILD_NOT_FOUND);
+	return static_cast<const Item*>(_base)->child(name);
+}
+Item* ItemRef::child(const string &name) {
+	return const_cast<Item*>(static_cast<const ItemRef*>(this)->child(name));
+}
+
+const Item* ItemRef::child(unsigned int id) const {
+	if (_base == 0) throw(CHILD_NOT_FOUND);
+	return static_cast<const Item*>(_base)->child(id);
+}
+Item* ItemRef::child(unsigned int id) {
+	return const_cast<Item*>(static_cast<const ItemRef*>(this)->child(id));
+}
+
+const Item* ItemRef::child(const vector<unsigned int> &child_path) const {
+	if (_base == 0) throw(CHILD_NOT_FOUND);
+	return static_cast<const Item*>(_base)->child(child_path);
+}
+Item* ItemRef::child(const vector<unsigned int> &child_path) {
+	return const_cast<Item*>(static_cast<const ItemRef*>(this)->child(child_path));
+}
+
+bool ItemRef::has_child(const Item* child) const {
+	return _base != 0 && _base->has_child(child);
+}
+
+bool ItemRef::has_child(const string &child_name) const {
+	return _base != 0 && _base->has_child(child_name);
+}
+
+bool ItemRef::has_child(unsigned int child_id) const {
+	return _base != 0 && _base->has_child(child_id);
+}
+
+bool ItemRef::has_child(const vector<unsigned int> &child_path) const {
+	return _base != 0 && _base->has_child(child_path);
+}
+
+void ItemRef::add_child(Item* new_child) {
+	if (_base == 0) throw(ITEM_NOT_FOUND);
+	_base->add_child(new_child);
+}
+
+void ItemRef::add_child(const XMLNode &child_node) {
+	if (_base == 0) throw(ITEM_NOT_FOUND);
+	_base->add_child(child_node);
+}
+
+void ItemRef::remove_child(Item* old_child) {
+	if (_base != 0) _base->remove_child(old_child);
+}
+
+void ItemRef::remove_child(const string &child_name) {
+	if (_base == 0) throw(CHILD_NOT_FOUND);
+	_base->remove_child(child_name);
+}
+
+void ItemRef::remove_child(unsigned int child_id) {
+	if (_base == 0) throw(CHILD_NOT_FOUND);
+	_base->remove_child(child_id);
+}
+
+void ItemRef::remove_child(const vector<unsigned int> &child_path) {
+	if (_base == 0) throw(CHILD_NOT_FOUND);
+	_base->remove_child(child_path);
+}
+
+void ItemRef::replace_child(Item* old_child, Item* new_child) {
+	if (_base == 0) throw(CHILD_NOT_FOUND);
+	_base->replace_child(old_child, new_child);
+}
+
+vector<attribute> ItemRef::attributes() const {
+	if (_base == 0) return vector<attribute>();
+	return static_cast<const Item*>(_base)->attributes();
+}
+vector<attribute> ItemRef::attributes() {
+	return static_cast<const ItemRef*>(this)->attributes();
+}
+
+string ItemRef::attr(const string &attr_name) const {
+	return _base == 0 ? string() : _base->attr(attr_name);
+}
+
+void ItemRef::attr(const string &attr_name, const string &attr_value) {
+	if (_base == 0) throw(ITEM_NOT_FOUND);
+	_base->attr(attr_name, attr_value);
+}
+
+bool ItemRef::has_attr(const attribute attr) const {
+	return _base != 0 && _base->has_attr(attr);
+}
+
+bool ItemRef::has_attr(const string &attr_name) const {
+	return _base != 0 && _base->has_attr(attr_name);
+}
+
+void ItemRef::add_attr(const attribute &attr) {
+	if (_base == 0) throw(ITEM_NOT_FOUND);
+	_base->add_attr(attr);
+}
+
+void ItemRef::add_attr(const string &attr_name) {
+	if (_base == 0) throw(ITEM_NOT_FOUND);
+	_base->add_attr(attr_name);
+}
+
+void ItemRef::add_attr(const string &attr_name, const string& attr_value) {
+	if (_base == 0) throw(ITEM_NOT_FOUND);
+	_base->add_attr(attr_name, attr_value);
+}
+
+void ItemRef::remove_attr(const attribute attribute) {
+	if (_base != 0) _base->remove_attr(attribute);
+}
+
+void ItemRef::remove_attr(const string &attr_name) {
+	if (_base != 0) _base->remove_attr(attr_name);
+}
+
+void GroupRef::add_child(Item* new_child) {
+	ItemRef::add_child(new_child);
+}
+
+void GroupRef::remove_child(Item* old_child) {
+	ItemRef::remove_child(old_child);
+}
+
+void GroupRef::replace_child(Item* old_child, Item* new_child) {
+	ItemRef::replace_child(old_child, new_child);
+}
+
+void GroupOptionRef::add_child(Item* new_child) {
+	GroupRef::add_child(new_child);
+}
+
+void GroupOptionRef::remove_child(Item* old_child) {
+	GroupRef::remove_child(old_child);
+}
+
+void GroupOptionRef::replace_child(Item* old_child, Item* new_child) {
+	GroupRef::replace_child(old_child, new_child);
+}
+
+unsigned int OptionRef::weight() const {
+	const Option* option = item_cast<Option>(ItemRef::base());
+	return option == 0 ? 0 : option->weight();
+}
+
+void OptionRef::weight(unsigned int new_weight) {
+	Option* option = item_cast<Option>(ItemRef::base());
+	if (option == 0) throw(ITEM_NOT_FOUND);
+	option->weight(new_weight);
+}
+
+string OptionRef::text() const {
+	const Option* option = item_cast<Option>(ItemRef::base());
+	return option == 0 ? string() : option->text();
+}
+
+void OptionRef::text(const string &new_text) {
+	Option* option = item_cast<Option>(ItemRef::base());
+	if (option == 0) throw(ITEM_NOT_FOUND);
+	option->text(new_text);
+}
+
+unsigned int GroupOptionRef::weight() const {
+	const Option* option = item_cast<Option>(ItemRef::base());
+	return option == 0 ? 0 : option->weight();
+}
+
+void GroupOptionRef::weight(unsigned int new_weight) {
+	Option* option = item_cast<Option>(ItemRef::base());
+	if (option == 0) throw(ITEM_NOT_FOUND);
+	option->weight(new_weight);
+}
+
+string GroupOptionRef::text() const {
+	const Option* option = item_cast<Option>(ItemRef::base());
+	return option == 0 ? string() : option->text();
+}
+
+void GroupOptionRef::text(const string &new_text) {
+	Option* option = item_cast<Option>(ItemRef::base());
+	if (option == 0) throw(ITEM_NOT_FOUND);
+	option->text(new_text);
+}
\ No newline at end of file
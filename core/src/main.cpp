@@ -1,10 +1,263 @@
-
 #include "core.h"
 
-int main(int argc, const char** argv) {
+#include <chrono>
+#include <limits.h>
+#include <string.h>
+#include <thread>
+
+static void usage(const char* name) {
+	printf("usage: %s <xml file> --generator <path> [--count N] [--seed S] [--threads T]\n", name);
+	printf("       %*s [--format text|jsonl|tsv|binary] [--formatters F] [--stats]\n", (int)strlen(name), "");
+	printf("       %s serve <socket> <xml file> [workers] [metrics file]\n", name);
+	printf("       %s publish <ring name> <xml file> <path> [count] [seed]\n", name);
+	printf("       %s consume <ring name>\n", name);
+	printf("       %s compile <xml file> <output.cpp> <table name> <path>...\n", name);
+	printf("       %s validate <xml file>... [--threads T] [--entry <path>]...\n", name);
+	printf("       %s pack <bundle file> <xml file>... [--compress]\n", name);
+}
+
+// A bundle is told from a document by its magic, so every mode takes either
+static bool is_bundle(const char* file) {
+	char magic[sizeof(xml::BUNDLE_MAGIC)];
+	FILE* in = fopen(file, "rb");
+	if (in == 0) return false;
+	bool ret = fread(magic, 1, sizeof(magic), in) == sizeof(magic) && memcmp(magic, xml::BUNDLE_MAGIC, sizeof(magic)) == 0;
+	fclose(in);
+	return ret;
+}
+
+// Every mode loads the same way, and reports a document it cannot use the same way.
+// Nothing here edits a loaded tree, so duplicates are always interned.
+static bool load(Generator &gen, const char* xml_file) {
+	try {
+		if (is_bundle(xml_file)) {
+			xml::bundle source(xml_file);
+			Scheduler pool(std::thread::hardware_concurrency());
+			gen.load(source, pool);
+		}
+		else gen.load(xml_file);
+	}
+	catch (gen_errno err) {
+		fprintf(stderr, "cannot load %s (%d)\n", xml_file, err);
+		return false;
+	}
+	catch (xml::bundle_errno err) {
+		fprintf(stderr, "cannot load %s (%d)\n", xml_file, err == xml::BUNDLE_CORRUPT ? PARSE_ERROR : FILE_NOT_READABLE);
+		return false;
+	}
+	gen.intern();
+	gen.strings().freeze();
+	return true;
+}
+
+static int batch(int argc, const char** argv) {
+	batch_config config = default_batch_config();
+	if (!parse_batch_args(argc, argv, config)) return 1;
+
+	Generator gen;
+	if (!load(gen, argv[0])) return 2;
+	try {
+		if (config.formatters > 0) {
+			Pipeline job(gen, config);
+			job.run(1);
+			if (config.stats) {
+				for (vector<stage_stats>::const_iterator it = job.stats().begin(); it != job.stats().end(); ++it) print_stats(stderr, *it);
+			}
+		}
+		else {
+			Batch job(gen, config);
+			job.run(1);
+		}
+	}
+	catch (gen_errno err) {
+		fprintf(stderr, "generation failed (%d)\n", err);
+		return 2;
+	}
+	catch (const std::exception &err) {
+		fprintf(stderr, "generation failed (%s)\n", err.what());
+		return 2;
+	}
+	return 0;
+}
+
+static int compile(int argc, const char** argv) {
+	Generator gen;
+	if (!load(gen, argv[0])) return 2;
+	AotCompiler compiler(gen);
+	try {
+		for (int i = 3; i < argc; i++) compiler.add_entry(argv[i]);
+	}
+	catch (gen_errno err) {
+		fprintf(stderr, "compile failed (%d)\n", err);
+		return 2;
+	}
+
+	FILE* out = fopen(argv[1], "w");
+	if (out == 0) {
+		fprintf(stderr, "cannot write %s\n", argv[1]);
+		return 2;
+	}
+	compiler.write(out, argv[2]);
+	fclose(out);
+	return 0;
+}
+
+// Entries are named for the files as given, and loading the bundle loads them all
+static int pack(int argc, const char** argv) {
+	bool compress = false;
+	xml::bundle_writer writer;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--compress") == 0) compress = true;
+	}
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--compress") == 0) continue;
+		if (!writer.add_file(argv[i], argv[i], compress)) {
+			fprintf(stderr, "cannot read %s\n", argv[i]);
+			return 2;
+		}
+	}
+	if (!writer.write(argv[0])) {
+		fprintf(stderr, "cannot write %s\n", argv[0]);
+		return 2;
+	}
+	return 0;
+}
+
+// Reports every problem in the documents, one per line, as if loaded together
+static int validate(int argc, const char** argv) {
+	unsigned int threads = std::thread::hardware_concurrency();
+	vector<string> files, entries;
 	for (int i = 0; i < argc; i++) {
-		printf("%s\n", argv[i]);
+		string arg = argv[i];
+		if (arg != "--threads" && arg != "--entry") {
+			files.push_back(arg);
+			continue;
+		}
+		if (i + 1 >= argc) return 1;
+		const char* value = argv[++i];
+		if (arg == "--entry") entries.push_back(value);
+		else if (!parse_number(value, MAX_THREADS, threads) || threads == 0) return 1;
+	}
+	if (files.empty()) return 1;
+
+	Generator gen;
+	Validator validator(gen, threads);
+	for (vector<string>::const_iterator it = files.begin(); it != files.end(); ++it) validator.add_doc(*it);
+	for (vector<string>::const_iterator it = entries.begin(); it != entries.end(); ++it) validator.add_entry(*it);
+	vector<load_problem> problems = validator.run();
+	for (vector<load_problem>::const_iterator it = problems.begin(); it != problems.end(); ++it) {
+		printf("%s: %s (%d)\n", it->document.c_str(), it->path.c_str(), it->code);
 	}
-	printf("Hello world!\n");
+	return problems.empty() ? 0 : 2;
+}
+
+#ifdef __linux__
+static int serve(int argc, const char** argv) {
+	server_config config = default_server_config(argv[0]);
+	if (argc > 2 && !parse_number(argv[2], MAX_THREADS, config.workers)) return 1;
+	if (argc > 3) config.metrics_path = argv[3];
+	if (config.workers == 0) return 1;
+
+	Generator gen;
+	if (!load(gen, argv[1])) return 2;
+	Server server(gen, config);
+	server.metrics().gauge("rnd_gen_documents_loaded", "Generator documents loaded.").set(gen.documents());
+	server.metrics().gauge("rnd_gen_string_pool_bytes", "Bytes held by the generator's option text pool.").set(gen.strings().bytes());
+	server.run();
 	return 0;
+}
+
+static const size_t PUBLISH_RING_SIZE = 64 << 20;
+
+static int publish(int argc, const char** argv) {
+	unsigned long long count = 1;
+	unsigned long long seed = 0;
+	if (argc > 3 && !parse_number(argv[3], ULLONG_MAX, count)) return 1;
+	if (argc > 4 && !parse_number(argv[4], ULLONG_MAX, seed)) return 1;
+	Generator gen;
+	if (!load(gen, argv[1])) return 2;
+	try {
+		const Item* item = gen.find(argv[2]);
+		ShmRing ring(argv[0], PUBLISH_RING_SIZE, SHM_BLOCK);
+		string result;
+		unsigned long long dropped = 0;
+		for (unsigned long long i = 0; i < count; i++) {
+			item->evaluate_at(seed, i, result);
+			if (ring.write(result.data(), result.size())) continue;
+			if (ring.abandoned()) {
+				fprintf(stderr, "publish failed: no consumer on %s after %llu results\n", argv[0], i);
+				return 2;
+			}
+			dropped++;
+		}
+		// A blocking ring only drops what could never fit in it
+		if (dropped != 0) {
+			fprintf(stderr, "%llu of %llu results too large for the ring\n", dropped, count);
+			return 2;
+		}
+	}
+	catch (gen_errno err) {
+		fprintf(stderr, "publish failed (%d)\n", err);
+		return 2;
+	}
+	return 0;
+}
+static const unsigned int ATTACH_TRIES = 500;
+static const unsigned int ATTACH_WAIT_MS = 10;
+
+// Reads a ring to the end, one result per line, and reports the rate on stderr, so
+// `publish` and `consume` together measure the ring end to end. The producer may
+// not have created the ring yet, so attaching is retried for a few seconds.
+static int consume(const char* ring_name) {
+	ShmRing* ring = 0;
+	for (unsigned int i = 0; ring == 0 && i < ATTACH_TRIES; i++) {
+		try {
+			ring = new ShmRing(ring_name);
+		}
+		catch (gen_errno) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(ATTACH_WAIT_MS));
+		}
+	}
+	if (ring == 0) {
+		fprintf(stderr, "cannot attach to %s\n", ring_name);
+		return 2;
+	}
+
+	std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+	unsigned long long count = 0, bytes = 0;
+	shm_result result;
+	while (true) {
+		if (!ring->read(result, 0)) {
+			ring->release();
+			if (!ring->read(result)) break;
+		}
+		fwrite(result.data, 1, result.length, stdout);
+		fputc('\n', stdout);
+		count++;
+		bytes += result.length;
+	}
+	ring->release();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	fprintf(stderr, "%llu results, %llu bytes, %llu lost in %.3fs (%.0f results/s)\n",
+		count, bytes, ring->lost(), seconds, seconds > 0 ? count / seconds : 0.0);
+	delete ring;
+	return 0;
+}
+#endif
+
+int main(int argc, const char** argv) {
+	string mode = argc > 1 ? argv[1] : "";
+	int ret = 1;
+#ifdef __linux__
+	if (mode == "serve" && argc >= 4) ret = serve(argc - 2, argv + 2);
+	if (mode == "publish" && argc >= 5) ret = publish(argc - 2, argv + 2);
+	if (mode == "consume" && argc == 3) ret = consume(argv[2]);
+#endif
+	if (mode == "compile" && argc >= 6) ret = compile(argc - 2, argv + 2);
+	if (mode == "validate" && argc >= 3) ret = validate(argc - 2, argv + 2);
+	if (mode == "pack" && argc >= 4) ret = pack(argc - 2, argv + 2);
+	if (argc >= 2 && mode != "serve" && mode != "publish" && mode != "consume" && mode != "compile" && mode != "validate" && mode != "pack") ret = batch(argc - 1, argv + 1);
+	if (ret != 1) return ret;
+	usage(argv[0]);
+	return 1;
 }
\ No newline at end of file
@@ -0,0 +1,236 @@
+#include "core.h"
+
+#include <chrono>
+
+static std::atomic<unsigned int> next_shard(0);
+
+unsigned int metrics_shard() {
+	thread_local unsigned int shard = next_shard++ % METRICS_SHARDS;
+	return shard;
+}
+
+unsigned long long metrics_now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+
+Counter::Counter() {
+	for (unsigned int i = 0; i < METRICS_SHARDS; i++) _shards[i].value.store(0, std::memory_order_relaxed);
+}
+
+Counter::~Counter() {}
+
+void Counter::add(unsigned long long amount) {
+	_shards[metrics_shard()].value.fetch_add(amount, std::memory_order_relaxed);
+}
+
+unsigned long long Counter::value() const {
+	unsigned long long ret = 0;
+	for (unsigned int i = 0; i < METRICS_SHARDS; i++) ret += _shards[i].value.load(std::memory_order_relaxed);
+	return ret;
+}
+
+
+
+Gauge::Gauge() : _value(0) {}
+
+Gauge::~Gauge() {}
+
+void Gauge::set(long long value) {
+	_value.store(value, std::memory_order_relaxed);
+}
+
+void Gauge::add(long long amount) {
+	_value.fetch_add(amount, std::memory_order_relaxed);
+}
+
+long long Gauge::value() const {
+	return _value.load(std::memory_order_relaxed);
+}
+
+
+
+Histogram::Histogram() {
+	_shards = new shard[METRICS_SHARDS];
+	for (unsigned int i = 0; i < METRICS_SHARDS; i++) {
+		for (unsigned int b = 0; b < HISTOGRAM_BUCKETS; b++) _shards[i].buckets[b].store(0, std::memory_order_relaxed);
+		_shards[i].count.store(0, std::memory_order_relaxed);
+		_shards[i].sum.store(0, std::memory_order_relaxed);
+	}
+}
+
+Histogram::~Histogram() {
+	delete[] _shards;
+}
+
+// Values below 2^SUB_BITS index directly. Above that, a value with highest bit m
+// lands in group m - SUB_BITS + 1, and the SUB_BITS bits under its highest bit pick
+// the bucket within the group.
+unsigned int Histogram::bucket(unsigned long long value) {
+	const unsigned long long sub_count = 1ULL << HISTOGRAM_SUB_BITS;
+	if (value < sub_count) return (unsigned int)value;
+	unsigned int magnitude = 63;
+	while ((value >> magnitude) == 0) magnitude--;
+	if (magnitude > HISTOGRAM_MAX_MAGNITUDE) return HISTOGRAM_BUCKETS - 1;
+	unsigned int group = magnitude - HISTOGRAM_SUB_BITS + 1;
+	return (group << HISTOGRAM_SUB_BITS) + (unsigned int)((value >> (magnitude - HISTOGRAM_SUB_BITS)) - sub_count);
+}
+
+unsigned long long Histogram::bucket_low(unsigned int index) {
+	const unsigned long long sub_count = 1ULL << HISTOGRAM_SUB_BITS;
+	unsigned int group = index >> HISTOGRAM_SUB_BITS;
+	unsigned long long sub = index & (sub_count - 1);
+	if (group == 0) return sub;
+	return (sub + sub_count) << (group - 1);
+}
+
+unsigned long long Histogram::bucket_high(unsigned int index) {
+	if (index + 1 >= HISTOGRAM_BUCKETS) return bucket_low(HISTOGRAM_BUCKETS - 1) * 2 - 1;
+	return bucket_low(index + 1) - 1;
+}
+
+void Histogram::record(unsigned long long value) {
+	shard &mine = _shards[metrics_shard()];
+	mine.buckets[bucket(value)].fetch_add(1, std::memory_order_relaxed);
+	mine.count.fetch_add(1, std::memory_order_relaxed);
+	mine.sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+unsigned long long Histogram::count() const {
+	unsigned long long ret = 0;
+	for (unsigned int i = 0; i < METRICS_SHARDS; i++) ret += _shards[i].count.load(std::memory_order_relaxed);
+	return ret;
+}
+
+unsigned long long Histogram::sum() const {
+	unsigned long long ret = 0;
+	for (unsigned int i = 0; i < METRICS_SHARDS; i++) ret += _shards[i].sum.load(std::memory_order_relaxed);
+	return ret;
+}
+
+// Each quantile reports the middle of the bucket it falls in. Counts are summed from
+// the buckets themselves rather than the shard totals, so a record() racing with the
+// snapshot cannot push a rank past the last bucket.
+vector<unsigned long long> Histogram::quantiles(const vector<double> &quantiles) const {
+	vector<unsigned long long> merged(HISTOGRAM_BUCKETS, 0);
+	unsigned long long total = 0;
+	for (unsigned int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+		for (unsigned int i = 0; i < METRICS_SHARDS; i++) merged[b] += _shards[i].buckets[b].load(std::memory_order_relaxed);
+		total += merged[b];
+	}
+
+	vector<unsigned long long> ret(quantiles.size(), 0);
+	if (total == 0) return ret;
+	unsigned long long seen = 0;
+	unsigned int b = 0;
+	for (unsigned int q = 0; q < quantiles.size(); q++) {
+		unsigned long long rank = (unsigned long long)(quantiles[q] * total);
+		if (rank >= total) rank = total - 1;
+		while (seen + merged[b] <= rank) seen += merged[b++];
+		ret[q] = bucket_low(b) + (bucket_high(b) - bucket_low(b)) / 2;
+	}
+	return ret;
+}
+
+
+
+Metrics::Metrics() {}
+
+Metrics::~Metrics() {
+	for (vector<family>::iterator fam = _families.begin(); fam != _families.end(); ++fam) {
+		for (vector<series>::iterator it = fam->members.begin(); it != fam->members.end(); ++it) {
+			delete it->counter;
+			delete it->gauge;
+			delete it->histogram;
+		}
+	}
+}
+
+Metrics::family& Metrics::find(const string &name, const string &help, metric_type type) {
+	for (vector<family>::iterator it = _families.begin(); it != _families.end(); ++it) {
+		if (it->name != name) continue;
+		if (it->type != type) throw(GEN_OTHER_ERROR);
+		return *it;
+	}
+	_families.push_back({ name, help, type, vector<series>() });
+	return _families.back();
+}
+
+Counter& Metrics::counter(const string &name, const string &help, const string &labels) {
+	std::lock_guard<std::mutex> guard(_lock);
+	family &fam = find(name, help, METRIC_COUNTER);
+	fam.members.push_back({ labels, new Counter(), 0, 0, 1 });
+	return *fam.members.back().counter;
+}
+
+Gauge& Metrics::gauge(const string &name, const string &help, const string &labels) {
+	std::lock_guard<std::mutex> guard(_lock);
+	family &fam = find(name, help, METRIC_GAUGE);
+	fam.members.push_back({ labels, 0, new Gauge(), 0, 1 });
+	return *fam.members.back().gauge;
+}
+
+Histogram& Metrics::histogram(const string &name, const string &help, double scale, const string &labels) {
+	std::lock_guard<std::mutex> guard(_lock);
+	family &fam = find(name, help, METRIC_SUMMARY);
+	fam.members.push_back({ labels, 0, 0, new Histogram(), scale });
+	return *fam.members.back().histogram;
+}
+
+static void write_sample(string &out, const string &name, const string &labels, const string &extra, double value) {
+	char number[32];
+	snprintf(number, sizeof(number), "%.15g", value);
+	out += name;
+	if (!labels.empty() || !extra.empty()) {
+		out += "{";
+		out += labels;
+		if (!labels.empty() && !extra.empty()) out += ",";
+		out += extra;
+		out += "}";
+	}
+	out += " ";
+	out += number;
+	out += "\n";
+}
+
+void Metrics::write(string &out) {
+	static const char* type_names[] = { "counter", "gauge", "summary" };
+	static const char* quantile_labels[] = { "quantile=\"0.5\"", "quantile=\"0.9\"", "quantile=\"0.99\"", "quantile=\"0.999\"" };
+	const vector<double> wanted = { 0.5, 0.9, 0.99, 0.999 };
+
+	std::lock_guard<std::mutex> guard(_lock);
+	for (vector<family>::const_iterator fam = _families.begin(); fam != _families.end(); ++fam) {
+		out += "# HELP " + fam->name + " " + fam->help + "\n";
+		out += "# TYPE " + fam->name + " " + type_names[fam->type] + "\n";
+		for (vector<series>::const_iterator it = fam->members.begin(); it != fam->members.end(); ++it) {
+			if (it->counter != 0) write_sample(out, fam->name, it->labels, "", (double)it->counter->value());
+			else if (it->gauge != 0) write_sample(out, fam->name, it->labels, "", (double)it->gauge->value());
+			else {
+				vector<unsigned long long> values = it->histogram->quantiles(wanted);
+				for (unsigned int q = 0; q < values.size(); q++) {
+					write_sample(out, fam->name, it->labels, quantile_labels[q], values[q] * it->scale);
+				}
+				write_sample(out, fam->name + "_sum", it->labels, "", it->histogram->sum() * it->scale);
+				write_sample(out, fam->name + "_count", it->labels, "", (double)it->histogram->count());
+			}
+		}
+	}
+}
+
+// Written beside `path` and renamed over it, so a reader never sees half a file
+bool Metrics::write_file(const string &path) {
+	string text;
+	write(text);
+	string temp = path + ".tmp";
+	FILE* out = fopen(temp.c_str(), "wb");
+	if (out == 0) return false;
+	bool ok = fwrite(text.data(), 1, text.size(), out) == text.size();
+	ok = fclose(out) == 0 && ok;
+#ifdef _WIN32
+	if (ok) remove(path.c_str());		// rename() will not replace an existing file here
+#endif
+	if (ok) ok = rename(temp.c_str(), path.c_str()) == 0;
+	if (!ok) remove(temp.c_str());
+	return ok;
+}
\ No newline at end of file
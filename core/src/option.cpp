@@ -0,0 +1,70 @@
+#include "core.h"
+
+#include <limits.h>
+
+const string Option::classname = "option";
+const unsigned int Option::default_weight = 1;
+const unsigned int GroupOption::default_weight = Option::default_weight;
+const unsigned int GroupOptionRef::default_weight = Option::default_weight;
+
+const char* const Option::weight_attr = "weight";
+
+// A whole decimal number that fits an unsigned int, nothing else
+bool Option::parse_weight(const string &value, unsigned int &weight) {
+	char* end;
+	unsigned long parsed = strtoul(value.c_str(), &end, 10);
+	if (value.empty() || *end != 0 || parsed > UINT_MAX) return false;
+	weight = parsed;
+	return true;
+}
+
+Option::Option(Generator& gen) : Item(gen) {
+	_weight = Option::default_weight;
+}
+
+// The weight comes from the `weight` attribute and the text from the element's own
+// text, so `<option weight="3">red</option>` reads as it looks
+Option::Option(Generator& gen, const XMLNode &node) : Item(gen, node) {
+	_weight = Option::default_weight;
+	if (node.has_attr(weight_attr) && !parse_weight(node.attr(weight_attr), _weight)) throw(PARSE_ERROR);
+	_text = _generator.strings().add(node.value());
+}
+
+// Options leave their Group before the Option part is gone, so the Group can still
+// find the slot to free
+Option::~Option() {
+	if (_parent != 0) _parent->remove_child(this);
+}
+
+type_mask Option::types() const {
+	return Option::typemask;
+}
+
+unsigned int Option::weight() const {
+	return _weight;
+}
+
+void Option::weight(unsigned int new_weight) {
+	if (new_weight == _weight) return;
+	check_writable();
+	_weight = new_weight;
+	Group* group = item_cast<Group>(parent());
+	if (group != 0 && group->has_option(this)) group->reweight(this);
+}
+
+string Option::text() const {
+	return _generator.strings().get(_text);
+}
+
+void Option::text(const string &new_text) {
+	check_writable();
+	_text = _generator.strings().add(new_text);
+}
+
+unsigned int Option::text_id() const {
+	return _text;
+}
+
+void Option::append_text(string &out) const {
+	_generator.strings().append(_text, out);
+}
\ No newline at end of file
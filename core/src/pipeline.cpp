@@ -0,0 +1,242 @@
+#include "core.h"
+
+#include <chrono>
+
+enum pipeline_stage {
+	STAGE_GENERATE,
+	STAGE_FORMAT,
+	STAGE_WRITE
+};
+
+typedef std::chrono::steady_clock stage_clock;
+
+static double seconds_since(const stage_clock::time_point &start) {
+	return std::chrono::duration<double>(stage_clock::now() - start).count();
+}
+
+void print_stats(FILE* out, const stage_stats &stats) {
+	double total = stats.busy + stats.stalled;
+	fprintf(out, "%-8s %2u threads %12llu results %10.1f MB  busy %8.3fs  stalled %8.3fs (%.0f%%)\n",
+		stats.name.c_str(), stats.threads, stats.items, stats.bytes / 1048576.0, stats.busy, stats.stalled,
+		total > 0 ? 100 * stats.stalled / total : 0.0);
+}
+
+Pipeline::Pipeline(const Generator &gen, const batch_config &config)
+	: _generator(gen), _config(config), _formatted((config.formatters + 1) * PIPELINE_RING_SIZE) {
+	if (_config.threads == 0) _config.threads = 1;
+	_formatters = _config.formatters == 0 ? 1 : _config.formatters;
+	if (_formatters > _config.threads) _formatters = _config.threads;
+	_item = _generator.find(_config.generator);
+	_chunk_count = (_config.count + PIPELINE_CHUNK_SIZE - 1) / PIPELINE_CHUNK_SIZE;
+	_window = _config.threads * PIPELINE_CHUNKS_PER_THREAD;
+	for (unsigned int i = 0; i < _config.threads; i++) _raw.push_back(new SpscRing<raw_chunk>(PIPELINE_RING_SIZE));
+	_next_chunk = 0;
+	_written = 0;
+	_failed = false;
+
+	const char* names[] = { "generate", "format", "write" };
+	unsigned int threads[] = { _config.threads, _formatters, 1 };
+	for (unsigned int i = 0; i < 3; i++) _stats.push_back({ names[i], threads[i], 0, 0, 0, 0 });
+}
+
+Pipeline::~Pipeline() {
+	for (vector<SpscRing<raw_chunk>*>::iterator it = _raw.begin(); it != _raw.end(); ++it) delete *it;
+}
+
+void Pipeline::report(unsigned int stage, const stage_stats &part) {
+	std::lock_guard<std::mutex> guard(_lock);
+	_stats[stage].items += part.items;
+	_stats[stage].bytes += part.bytes;
+	_stats[stage].busy += part.busy;
+	_stats[stage].stalled += part.stalled;
+}
+
+// Keeps the first error for run() to rethrow
+void Pipeline::fail(std::exception_ptr error) {
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		if (!_error) _error = error;
+	}
+	fail();
+}
+
+// Wakes every stage so each sees _failed and stops
+void Pipeline::fail() {
+	_failed = true;
+	_progress.notify();
+	_raw_ready.notify();
+	_raw_space.notify();
+	_formatted_ready.notify();
+	_formatted_space.notify();
+}
+
+// Chunks are claimed in order, but never more than _window ahead of the writer, so
+// the writer's reorder buffer stays bounded however uneven the chunks are
+void Pipeline::generate(unsigned int worker) {
+	stage_stats mine = { "", 0, 0, 0, 0, 0 };
+	SpscRing<raw_chunk> &out = *_raw[worker];
+	raw_chunk chunk;
+	while (!_failed) {
+		unsigned long long index = _next_chunk++;
+		if (index >= _chunk_count) break;
+		stage_clock::time_point waited = stage_clock::now();
+		_progress.wait_until([&] { return index < _written + _window || _failed; });
+		mine.stalled += seconds_since(waited);
+
+		stage_clock::time_point started = stage_clock::now();
+		chunk.index = index;
+		chunk.first = index * PIPELINE_CHUNK_SIZE;
+		unsigned long long last = chunk.first + PIPELINE_CHUNK_SIZE < _config.count ? chunk.first + PIPELINE_CHUNK_SIZE : _config.count;
+		chunk.results.resize(last - chunk.first);
+		try {
+			for (unsigned long long i = chunk.first; i < last; i++) {
+				_item->evaluate_at(_config.seed, i, chunk.results[i - chunk.first]);
+				mine.bytes += chunk.results[i - chunk.first].size();
+			}
+		}
+		catch (...) {
+			fail(std::current_exception());
+			break;
+		}
+		mine.items += last - chunk.first;
+		mine.busy += seconds_since(started);
+
+		waited = stage_clock::now();
+		_raw_space.wait_until([&] { return out.push(chunk) || _failed; });
+		_raw_ready.notify();
+		mine.stalled += seconds_since(waited);
+	}
+	out.close();
+	_raw_ready.notify();
+	report(STAGE_GENERATE, mine);
+}
+
+// Formatter `worker` serves generators worker, worker + formatters, ...
+void Pipeline::format(unsigned int worker) {
+	stage_stats mine = { "", 0, 0, 0, 0, 0 };
+	raw_chunk chunk;
+	formatted_chunk done;
+	stage_clock::time_point idle = stage_clock::now();
+	unsigned int served = (_raw.size() - worker + _formatters - 1) / _formatters;
+	unsigned int turn = 0;
+	bool open = true;
+	while (open && !_failed) {
+		bool got = false;
+		// Rings are tried starting after the last one served, so none is starved.
+		// Closed is read before popping, so an empty pop after it really is the end.
+		_raw_ready.wait_until([&] {
+			open = false;
+			for (unsigned int k = 0; k < served && !got; k++) {
+				SpscRing<raw_chunk> &in = *_raw[worker + (turn + k) % served * _formatters];
+				bool closed = in.closed();
+				got = in.pop(chunk);
+				open = open || got || !closed;
+				if (got) turn += k + 1;
+			}
+			return got || !open || _failed;
+		});
+		if (!got) continue;
+		_raw_space.notify();
+		mine.stalled += seconds_since(idle);
+
+		stage_clock::time_point started = stage_clock::now();
+		done.index = chunk.index;
+		done.records.clear();
+		for (unsigned int k = 0; k < chunk.results.size(); k++) {
+			format_result(done.records, _config.format, chunk.first + k, chunk.results[k]);
+		}
+		mine.items += chunk.results.size();
+		mine.bytes += done.records.size();
+		mine.busy += seconds_since(started);
+
+		idle = stage_clock::now();
+		_formatted_space.wait_until([&] { return _formatted.push(done) || _failed; });
+		_formatted_ready.notify();
+	}
+	mine.stalled += seconds_since(idle);
+	report(STAGE_FORMAT, mine);
+}
+
+// Takes chunks in index order and gathers them into large writes; chunks that
+// arrive early wait in `early`
+void Pipeline::write(int fd) {
+	stage_stats mine = { "", 0, 0, 0, 0, 0 };
+	OutputWriter writer(fd);
+	map<unsigned long long, vector<char>> early;
+	vector<vector<char>> staged;
+	size_t staged_size = 0;
+	unsigned long long next = 0;
+	formatted_chunk done;
+	while (next < _chunk_count && !_failed) {
+		stage_clock::time_point waited = stage_clock::now();
+		bool got = false;
+		_formatted_ready.wait_until([&] {
+			while (_formatted.pop(done)) {
+				got = true;
+				early[done.index].swap(done.records);
+			}
+			return got || !staged.empty() || _failed;
+		});
+		if (got) _formatted_space.notify();
+		mine.stalled += seconds_since(waited);
+		if (_failed) break;
+
+		stage_clock::time_point started = stage_clock::now();
+		map<unsigned long long, vector<char>>::iterator it;
+		unsigned long long taken = next;
+		while ((it = early.find(next)) != early.end()) {
+			staged.push_back(vector<char>());
+			staged.back().swap(it->second);
+			staged_size += staged.back().size();
+			early.erase(it);
+			next++;
+		}
+		if (next != taken) {
+			_written = next;
+			_progress.notify();
+		}
+		// Write once enough has gathered, at the end, or when a pass brought nothing new
+		if (staged_size >= PIPELINE_WRITE_SIZE || next == _chunk_count || (!got && !staged.empty())) {
+			for (vector<vector<char>>::const_iterator st = staged.begin(); st != staged.end(); ++st) writer.add(&*st);
+			writer.flush();
+			mine.bytes += staged_size;
+			mine.items += staged.size();
+			staged.clear();
+			staged_size = 0;
+		}
+		mine.busy += seconds_since(started);
+	}
+	// Counted in chunks above; report results like the other stages
+	mine.items = next == _chunk_count ? _config.count : next * PIPELINE_CHUNK_SIZE;
+	report(STAGE_WRITE, mine);
+}
+
+// Nothing may leave a stage thread, or it would end the process: whatever a stage
+// throws stops the others and is rethrown by run()
+void Pipeline::stage(void (Pipeline::*body)(unsigned int), unsigned int worker) {
+	try {
+		(this->*body)(worker);
+	}
+	catch (...) {
+		fail(std::current_exception());
+	}
+}
+
+void Pipeline::run(int fd) {
+	vector<std::thread> threads;
+	for (unsigned int i = 0; i < _config.threads; i++) threads.push_back(std::thread(&Pipeline::stage, this, &Pipeline::generate, i));
+	for (unsigned int i = 0; i < _formatters; i++) threads.push_back(std::thread(&Pipeline::stage, this, &Pipeline::format, i));
+	try {
+		write(fd);
+	}
+	catch (...) {
+		fail(std::current_exception());
+	}
+	for (vector<std::thread>::iterator it = threads.begin(); it != threads.end(); ++it) it->join();
+	if (_error) std::rethrow_exception(_error);
+	if (_failed) throw(GEN_OTHER_ERROR);
+}
+
+const vector<stage_stats>& Pipeline::stats() const {
+	return _stats;
+}
\ No newline at end of file
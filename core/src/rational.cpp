@@ -0,0 +1,213 @@
+#include "core.h"
+
+#include <math.h>
+
+Rational::Rational() : _den(1, 1) { }
+
+Rational::Rational(unsigned long long num, unsigned long long den) {
+	if (den == 0) throw(GEN_OTHER_ERROR);
+	*this = Rational(from(num), from(den));
+}
+
+// Every other constructor ends here, so a fraction is only ever stored reduced
+Rational::Rational(const natural &num, const natural &den) {
+	if (num.empty()) {
+		_den = natural(1, 1);
+		return;
+	}
+	natural common = gcd(num, den);
+	if (common.size() == 1 && common[0] == 1) {
+		_num = num;
+		_den = den;
+		return;
+	}
+	_num = divide(num, common);
+	_den = divide(den, common);
+}
+
+Rational::~Rational() { }
+
+Rational::natural Rational::from(unsigned long long value) {
+	natural ret;
+	for (; value != 0; value >>= 32) ret.push_back((unsigned int)value);
+	return ret;
+}
+
+int Rational::compare(const natural &a, const natural &b) {
+	if (a.size() != b.size()) return a.size() < b.size() ? -1 : 1;
+	for (size_t i = a.size(); i-- > 0;) {
+		if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+	}
+	return 0;
+}
+
+Rational::natural Rational::add(const natural &a, const natural &b) {
+	natural ret;
+	unsigned long long carry = 0;
+	for (size_t i = 0; i < a.size() || i < b.size() || carry != 0; i++) {
+		if (i < a.size()) carry += a[i];
+		if (i < b.size()) carry += b[i];
+		ret.push_back((unsigned int)carry);
+		carry >>= 32;
+	}
+	return ret;
+}
+
+// a must not be less than b
+Rational::natural Rational::subtract(const natural &a, const natural &b) {
+	natural ret(a);
+	long long borrow = 0;
+	for (size_t i = 0; i < ret.size(); i++) {
+		long long diff = (long long)ret[i] - borrow - (i < b.size() ? b[i] : 0);
+		borrow = diff < 0 ? 1 : 0;
+		ret[i] = (unsigned int)(diff + (borrow << 32));
+	}
+	while (!ret.empty() && ret.back() == 0) ret.pop_back();
+	return ret;
+}
+
+Rational::natural Rational::multiply(const natural &a, const natural &b) {
+	if (a.empty() || b.empty()) return natural();
+	natural ret(a.size() + b.size(), 0);
+	for (size_t i = 0; i < a.size(); i++) {
+		unsigned long long carry = 0;
+		for (size_t j = 0; j < b.size(); j++) {
+			carry += (unsigned long long)a[i] * b[j] + ret[i + j];
+			ret[i + j] = (unsigned int)carry;
+			carry >>= 32;
+		}
+		ret[i + b.size()] = (unsigned int)carry;
+	}
+	while (!ret.empty() && ret.back() == 0) ret.pop_back();
+	return ret;
+}
+
+// Bit-at-a-time long division. It only ever divides by a common factor, which is
+// small next to the cost of finding it.
+Rational::natural Rational::divide(const natural &a, const natural &b) {
+	natural ret(a.size(), 0);
+	natural rest;
+	for (unsigned int bit = bits(a); bit-- > 0;) {
+		rest = add(rest, rest);
+		if ((a[bit / 32] >> (bit % 32)) & 1) rest = add(rest, natural(1, 1));
+		if (compare(rest, b) >= 0) {
+			rest = subtract(rest, b);
+			ret[bit / 32] |= 1u << (bit % 32);
+		}
+	}
+	while (!ret.empty() && ret.back() == 0) ret.pop_back();
+	return ret;
+}
+
+// Divides a in place and returns the remainder
+unsigned int Rational::divide(natural &a, unsigned int divisor) {
+	unsigned long long rest = 0;
+	for (size_t i = a.size(); i-- > 0;) {
+		rest = (rest << 32) | a[i];
+		a[i] = (unsigned int)(rest / divisor);
+		rest %= divisor;
+	}
+	while (!a.empty() && a.back() == 0) a.pop_back();
+	return (unsigned int)rest;
+}
+
+// Binary GCD: only shifts and subtraction, which limbs make cheap
+Rational::natural Rational::gcd(natural a, natural b) {
+	if (a.empty()) return b;
+	if (b.empty()) return a;
+	unsigned int shift = 0;
+	while ((a[0] & 1) == 0 && (b[0] & 1) == 0) {
+		divide(a, 2);
+		divide(b, 2);
+		shift++;
+	}
+	while ((a[0] & 1) == 0) divide(a, 2);
+	while (!b.empty()) {
+		while ((b[0] & 1) == 0) divide(b, 2);
+		if (compare(a, b) > 0) a.swap(b);
+		b = subtract(b, a);
+	}
+	for (; shift > 0; shift--) a = add(a, a);
+	return a;
+}
+
+unsigned int Rational::bits(const natural &a) {
+	if (a.empty()) return 0;
+	unsigned int ret = (a.size() - 1) * 32;
+	for (unsigned int high = a.back(); high != 0; high >>= 1) ret++;
+	return ret;
+}
+
+// The highest 64 bits of a, and how far they were shifted down to fit
+unsigned long long Rational::top(const natural &a, int &exponent) {
+	unsigned int length = bits(a);
+	exponent = length > 64 ? length - 64 : 0;
+	unsigned long long ret = 0;
+	for (unsigned int bit = length; bit-- > (unsigned int)exponent;) {
+		ret = (ret << 1) | ((a[bit / 32] >> (bit % 32)) & 1);
+	}
+	return ret;
+}
+
+bool Rational::zero() const {
+	return _num.empty();
+}
+
+Rational Rational::operator+(const Rational &other) const {
+	if (_den == other._den) return Rational(add(_num, other._num), _den);
+	return Rational(add(multiply(_num, other._den), multiply(other._num, _den)), multiply(_den, other._den));
+}
+
+Rational Rational::operator-(const Rational &other) const {
+	natural left = multiply(_num, other._den);
+	natural right = multiply(other._num, _den);
+	if (compare(left, right) < 0) throw(GEN_OTHER_ERROR);
+	return Rational(subtract(left, right), multiply(_den, other._den));
+}
+
+Rational Rational::operator*(const Rational &other) const {
+	return Rational(multiply(_num, other._num), multiply(_den, other._den));
+}
+
+Rational& Rational::operator+=(const Rational &other) {
+	*this = *this + other;
+	return *this;
+}
+
+// Both sides are in lowest terms, so equal values have equal limbs
+bool Rational::operator==(const Rational &other) const {
+	return _num == other._num && _den == other._den;
+}
+
+bool Rational::operator!=(const Rational &other) const {
+	return !(*this == other);
+}
+
+bool Rational::operator<(const Rational &other) const {
+	return compare(multiply(_num, other._den), multiply(other._num, _den)) < 0;
+}
+
+bool Rational::operator>(const Rational &other) const {
+	return other < *this;
+}
+
+double Rational::approx() const {
+	int num_exponent, den_exponent;
+	unsigned long long num = top(_num, num_exponent);
+	unsigned long long den = top(_den, den_exponent);
+	return ldexp((double)num / (double)den, num_exponent - den_exponent);
+}
+
+string Rational::str() const {
+	string ret;
+	natural parts[] = { _den, _num };
+	for (unsigned int i = 0; i < 2; i++) {
+		if (i == 0 && parts[0].size() == 1 && parts[0][0] == 1) continue;
+		string digits;
+		do {
+			digits += (char)('0' + divide(parts[i], 10));
+		} while (!parts[i].empty());
+		ret = string(digits.rbegin(), digits.rend()) + (ret.empty() ? "" : "/" + ret);
+	}
+	return ret;
+}
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "core.h"
+
+#include <chrono>
+
+thread_local Scheduler* Scheduler::_current = 0;
+thread_local unsigned int Scheduler::_self = Scheduler::NO_WORKER;
+
+static const std::chrono::milliseconds WAIT_RECHECK(1);
+
+TaskGroup::TaskGroup() {
+	_pending = 0;
+}
+
+TaskGroup::~TaskGroup() { }
+
+bool TaskGroup::finished() const {
+	return _pending == 0;
+}
+
+Scheduler::Scheduler(unsigned int threads) {
+	_workers = threads == 0 ? 1 : threads;
+	_queued = 0;
+	_stopping = false;
+	for (unsigned int i = 0; i <= _workers; i++) _queues.push_back(new queue());
+	for (unsigned int i = 0; i < _workers; i++) _threads.push_back(std::thread(&Scheduler::worker, this, i));
+}
+
+Scheduler::~Scheduler() {
+	{
+		std::lock_guard<std::mutex> guard(_sleep_lock);
+		_stopping = true;
+	}
+	_wake.notify_all();
+	for (vector<std::thread>::iterator it = _threads.begin(); it != _threads.end(); ++it) it->join();
+	for (vector<queue*>::iterator it = _queues.begin(); it != _queues.end(); ++it) delete *it;
+}
+
+unsigned int Scheduler::threads() const {
+	return _workers;
+}
+
+unsigned int Scheduler::self() const {
+	return _current == this ? _self : NO_WORKER;
+}
+
+// Own deque from the back, then everyone else's from the front, starting just past
+// ourselves so thieves spread out, then the inbox
+bool Scheduler::take(unsigned int self, job &next) {
+	unsigned int workers = _workers;
+	if (self != NO_WORKER) {
+		queue &own = *_queues[self];
+		std::lock_guard<std::mutex> guard(own.lock);
+		if (!own.jobs.empty()) {
+			next = own.jobs.back();
+			own.jobs.pop_back();
+			_queued--;
+			return true;
+		}
+	}
+	unsigned int start = self == NO_WORKER ? 0 : self + 1;
+	for (unsigned int i = 0; i <= workers; i++) {
+		unsigned int victim = (start + i) % (workers + 1);
+		if (victim == self) continue;
+		queue &other = *_queues[victim];
+		std::lock_guard<std::mutex> guard(other.lock);
+		if (other.jobs.empty()) continue;
+		next = other.jobs.front();
+		other.jobs.pop_front();
+		_queued--;
+		return true;
+	}
+	return false;
+}
+
+void Scheduler::execute(job &next) {
+	try {
+		next.run();
+	}
+	catch (...) {
+		std::lock_guard<std::mutex> guard(next.group->_lock);
+		if (!next.group->_error) next.group->_error = std::current_exception();
+	}
+	// Notify under the lock so a waiter cannot return and destroy the group first
+	std::lock_guard<std::mutex> guard(next.group->_lock);
+	if (--next.group->_pending == 0) next.group->_done.notify_all();
+}
+
+void Scheduler::worker(unsigned int index) {
+	_current = this;
+	_self = index;
+	job next;
+	while (true) {
+		if (take(index, next)) {
+			execute(next);
+			next.run = 0;
+			continue;
+		}
+		std::unique_lock<std::mutex> guard(_sleep_lock);
+		_wake.wait(guard, [this] { return _stopping || _queued > 0; });
+		if (_stopping && _queued == 0) return;
+	}
+}
+
+void Scheduler::spawn(TaskGroup &group, const task &run) {
+	group._pending++;
+	unsigned int target = self();
+	if (target == NO_WORKER) target = _workers;
+	{
+		std::lock_guard<std::mutex> guard(_queues[target]->lock);
+		_queues[target]->jobs.push_back({ run, &group });
+		_queued++;
+	}
+	std::lock_guard<std::mutex> guard(_sleep_lock);
+	_wake.notify_one();
+}
+
+// Helps with any queued work until the group is done; only sleeps when there is
+// nothing at all to run, and even then wakes up regularly to look again
+void Scheduler::wait(TaskGroup &group) {
+	unsigned int me = self();
+	job next;
+	while (group._pending > 0) {
+		if (take(me, next)) {
+			execute(next);
+			next.run = 0;
+			continue;
+		}
+		std::unique_lock<std::mutex> guard(group._lock);
+		group._done.wait_for(guard, WAIT_RECHECK, [&group] { return group._pending == 0; });
+	}
+	std::lock_guard<std::mutex> guard(group._lock);
+	if (group._error) {
+		std::exception_ptr error = group._error;
+		group._error = 0;
+		std::rethrow_exception(error);
+	}
+}
+
+// Halves the range, queueing the upper half each time, until what is left is no
+// bigger than `grain`; thieves therefore take the largest untouched pieces
+void Scheduler::split(TaskGroup &group, unsigned long long first, unsigned long long last, unsigned long long grain, const range_task &body) {
+	while (last - first > grain) {
+		unsigned long long mid = first + (last - first) / 2;
+		spawn(group, [this, &group, mid, last, grain, &body] { split(group, mid, last, grain, body); });
+		last = mid;
+	}
+	if (first < last) body(first, last);
+}
+
+void Scheduler::parallel_for(unsigned long long first, unsigned long long last, unsigned long long grain, const range_task &body) {
+	if (grain == 0) grain = 1;
+	TaskGroup group;
+	// Runs part of the range here; a throw must still wait for the queued parts,
+	// which refer to `group` and `body`
+	try {
+		split(group, first, last, grain, body);
+	}
+	catch (...) {
+		std::lock_guard<std::mutex> guard(group._lock);
+		if (!group._error) group._error = std::current_exception();
+	}
+	wait(group);
+}
\ No newline at end of file
@@ -0,0 +1,523 @@
+#include "core.h"
+
+#ifdef __linux__
+
+#include <chrono>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static const unsigned long long LISTEN_TAG = ~0ULL;
+static const unsigned long long WAKE_TAG = ~0ULL - 1;
+static const unsigned int MAX_EVENTS = 64;
+
+static void put_u32(vector<char> &buffer, size_t offset, unsigned int value) {
+	memcpy(buffer.data() + offset, &value, sizeof(value));
+}
+
+static void append(vector<char> &buffer, const void* data, size_t size) {
+	size_t offset = buffer.size();
+	buffer.resize(offset + size);
+	memcpy(buffer.data() + offset, data, size);
+}
+
+server_config default_server_config(const string &socket_path) {
+	server_config ret;
+	ret.socket_path = socket_path;
+	ret.workers = std::thread::hardware_concurrency();
+	if (ret.workers == 0) ret.workers = 4;
+	ret.max_connections = 1024;
+	ret.max_count = 100000;
+	ret.buffer_size = 64 * 1024;
+	ret.coalesce_window = 200;
+	ret.max_batch = 64;
+	ret.metrics_interval = 10;
+	return ret;
+}
+
+
+
+BufferPool::BufferPool(unsigned int count, unsigned int capacity) {
+	_capacity = capacity;
+	for (unsigned int i = 0; i < count; i++) {
+		vector<char>* buffer = new vector<char>();
+		buffer->reserve(capacity);
+		_free.push_back(buffer);
+	}
+}
+
+BufferPool::~BufferPool() {
+	for (vector<vector<char>*>::iterator it = _free.begin(); it != _free.end(); ++it) {
+		delete *it;
+	}
+}
+
+vector<char>* BufferPool::acquire() {
+	std::lock_guard<std::mutex> guard(_lock);
+	if (_free.empty()) {
+		vector<char>* buffer = new vector<char>();
+		buffer->reserve(_capacity);
+		return buffer;
+	}
+	vector<char>* ret = _free.back();
+	_free.pop_back();
+	return ret;
+}
+
+void BufferPool::release(vector<char>* buffer) {
+	buffer->clear();
+	std::lock_guard<std::mutex> guard(_lock);
+	_free.push_back(buffer);
+}
+
+
+
+Server::Server(const Generator &gen, const server_config &config)
+	: _generator(gen), _config(config), _buffers(2 * config.max_connections, config.buffer_size) {
+	if (_config.metrics_interval == 0) _config.metrics_interval = 1;	// 0 would rewrite the file in a busy loop
+	_connections.resize(_config.max_connections);
+	for (unsigned int i = 0; i < _config.max_connections; i++) {
+		_idle.push_back(&_connections[_config.max_connections - i - 1]);
+	}
+	_jobs.resize(_config.max_connections);
+	_jobs_head = _jobs_count = 0;
+	_gathering = 0;
+	_waiting = 0;
+	_done.resize(_config.max_connections);
+	_done_head = _done_count = 0;
+	_listen_fd = _epoll_fd = _wake_fd = -1;
+	_running = false;
+
+	const char* statuses[] = { "ok", "bad_request", "unknown_generator", "count_too_large", "generation_failed", "budget_exceeded" };
+	for (unsigned int i = 0; i <= BUDGET_EXCEEDED; i++) {
+		string labels = string("status=\"") + statuses[i] + "\"";
+		_requests.push_back(&_metrics.counter("rnd_gen_requests_total", "Requests answered, by status.", labels));
+	}
+	_results = &_metrics.counter("rnd_gen_results_total", "Results generated.");
+	_result_bytes = &_metrics.counter("rnd_gen_result_bytes_total", "Bytes of results generated.");
+	_request_time = &_metrics.histogram("rnd_gen_request_duration_seconds", "Time from a request being read to its response being ready.", 1e-9);
+	_evaluate_time = &_metrics.histogram("rnd_gen_evaluate_duration_seconds", "Time to generate the results of one batch of requests.", 1e-9);
+	_batch_size = &_metrics.histogram("rnd_gen_batch_requests", "Requests answered together by one worker.");
+	_open_connections = &_metrics.gauge("rnd_gen_connections", "Open client connections.");
+}
+
+Server::~Server() {
+	stop();
+	for (vector<connection>::iterator it = _connections.begin(); it != _connections.end(); ++it) {
+		if (it->fd >= 0 && it->in != 0) close(&*it);
+	}
+	if (_wake_fd >= 0) ::close(_wake_fd);
+	if (_epoll_fd >= 0) ::close(_epoll_fd);
+	if (_listen_fd >= 0) ::close(_listen_fd);
+	unlink(_config.socket_path.c_str());
+}
+
+void Server::listen() {
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (_config.socket_path.size() >= sizeof(addr.sun_path)) throw(GEN_OTHER_ERROR);
+	strcpy(addr.sun_path, _config.socket_path.c_str());
+	unlink(addr.sun_path);
+
+	_listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (_listen_fd < 0) throw(GEN_OTHER_ERROR);
+	if (bind(_listen_fd, (sockaddr*)&addr, sizeof(addr)) != 0) throw(GEN_OTHER_ERROR);
+	if (::listen(_listen_fd, SOMAXCONN) != 0) throw(GEN_OTHER_ERROR);
+
+	_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (_epoll_fd < 0 || _wake_fd < 0) throw(GEN_OTHER_ERROR);
+
+	epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.u64 = LISTEN_TAG;
+	epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _listen_fd, &ev);
+	ev.data.u64 = WAKE_TAG;
+	epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _wake_fd, &ev);
+}
+
+void Server::run() {
+	listen();
+	_running = true;
+	for (unsigned int i = 0; i < _config.workers; i++) {
+		_workers.push_back(std::thread(&Server::work, this));
+	}
+	if (!_config.metrics_path.empty()) _workers.push_back(std::thread(&Server::export_metrics, this));
+
+	epoll_event events[MAX_EVENTS];
+	while (_running) {
+		int ready = epoll_wait(_epoll_fd, events, MAX_EVENTS, -1);
+		if (ready < 0 && errno != EINTR) break;
+		for (int i = 0; i < ready; i++) {
+			if (events[i].data.u64 == LISTEN_TAG) accept_all();
+			else if (events[i].data.u64 == WAKE_TAG) finish_all();
+			else {
+				connection* conn = (connection*)events[i].data.ptr;
+				if (events[i].events & (EPOLLERR | EPOLLHUP)) close(conn);
+				else if (events[i].events & EPOLLOUT) write_to(conn);
+				else if (events[i].events & EPOLLIN) read_from(conn);
+			}
+		}
+	}
+
+	stop();
+	for (vector<std::thread>::iterator it = _workers.begin(); it != _workers.end(); ++it) {
+		it->join();
+	}
+	_workers.clear();
+}
+
+void Server::stop() {
+	if (!_running.exchange(false)) return;
+	{
+		std::lock_guard<std::mutex> guard(_jobs_lock);
+	}
+	_jobs_ready.notify_all();
+	_jobs_added.notify_all();
+	_stopped.notify_all();
+	unsigned long long one = 1;
+	if (_wake_fd >= 0) write(_wake_fd, &one, sizeof(one));
+}
+
+void Server::accept_all() {
+	while (true) {
+		int fd = accept4(_listen_fd, 0, 0, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0) return;
+		if (_idle.empty()) {
+			::close(fd);
+			continue;
+		}
+		connection* conn = _idle.back();
+		_idle.pop_back();
+		conn->fd = fd;
+		conn->in = _buffers.acquire();
+		conn->out = _buffers.acquire();
+		conn->in->resize(conn->in->capacity());
+		conn->in_used = conn->out_sent = conn->request_size = 0;
+		conn->busy = conn->closing = false;
+		_open_connections->add(1);
+
+		epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.ptr = conn;
+		epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+	}
+}
+
+void Server::watch(connection* conn, unsigned int events) {
+	epoll_event ev;
+	ev.events = events;
+	ev.data.ptr = conn;
+	epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev);
+}
+
+void Server::read_from(connection* conn) {
+	while (true) {
+		if (conn->in_used == conn->in->size()) {
+			if (conn->in->size() >= MAX_REQUEST_SIZE + FRAME_HEADER_SIZE) break;
+			conn->in->resize(conn->in->size() * 2);
+		}
+		ssize_t got = read(conn->fd, conn->in->data() + conn->in_used, conn->in->size() - conn->in_used);
+		if (got > 0) conn->in_used += got;
+		else if (got < 0 && errno == EINTR) continue;
+		else if (got < 0 && errno == EAGAIN) break;
+		else {
+			close(conn);
+			return;
+		}
+	}
+	dispatch(conn);
+}
+
+void Server::dispatch(connection* conn) {
+	if (conn->busy) return;
+	if (conn->in_used < FRAME_HEADER_SIZE) {
+		watch(conn, EPOLLIN);
+		return;
+	}
+	unsigned int length;
+	memcpy(&length, conn->in->data(), sizeof(length));
+	if (length < REQUEST_FIXED_SIZE || length > MAX_REQUEST_SIZE) {
+		close(conn);
+		return;
+	}
+	if (conn->in_used < FRAME_HEADER_SIZE + length) {
+		watch(conn, EPOLLIN);
+		return;
+	}
+
+	// Stop reading until the response has gone out, so requests stay in order
+	conn->request_size = FRAME_HEADER_SIZE + length;
+	conn->queued_at = metrics_now();
+	conn->busy = true;
+	watch(conn, 0);
+	bool gathering;
+	{
+		std::lock_guard<std::mutex> guard(_jobs_lock);
+		push(_jobs, _jobs_head, _jobs_count, conn);
+		gathering = _gathering > 0;
+	}
+	_jobs_ready.notify_one();
+	if (gathering) _jobs_added.notify_all();
+}
+
+void Server::finish_all() {
+	unsigned long long count;
+	read(_wake_fd, &count, sizeof(count));
+	while (true) {
+		connection* conn;
+		{
+			std::lock_guard<std::mutex> guard(_done_lock);
+			conn = pop(_done, _done_head, _done_count);
+		}
+		if (conn == 0) return;
+		if (conn->closing) {
+			conn->busy = false;
+			close(conn);
+		}
+		else write_to(conn);
+	}
+}
+
+void Server::write_to(connection* conn) {
+	while (conn->out_sent < conn->out->size()) {
+		ssize_t sent = write(conn->fd, conn->out->data() + conn->out_sent, conn->out->size() - conn->out_sent);
+		if (sent > 0) conn->out_sent += sent;
+		else if (sent < 0 && errno == EINTR) continue;
+		else if (sent < 0 && errno == EAGAIN) {
+			watch(conn, EPOLLOUT);
+			return;
+		}
+		else {
+			conn->busy = false;
+			close(conn);
+			return;
+		}
+	}
+
+	conn->out->clear();
+	conn->out_sent = 0;
+	memmove(conn->in->data(), conn->in->data() + conn->request_size, conn->in_used - conn->request_size);
+	conn->in_used -= conn->request_size;
+	conn->request_size = 0;
+	conn->busy = false;
+	dispatch(conn);
+}
+
+void Server::close(connection* conn) {
+	if (conn->busy) {
+		// A worker still holds the buffers; finish_all() closes it once the job returns
+		conn->closing = true;
+		epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, conn->fd, 0);
+		return;
+	}
+	epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, conn->fd, 0);
+	::close(conn->fd);
+	conn->fd = -1;
+	_buffers.release(conn->in);
+	_buffers.release(conn->out);
+	conn->in = conn->out = 0;
+	_idle.push_back(conn);
+	_open_connections->add(-1);
+}
+
+void Server::push(vector<connection*> &ring, size_t &head, size_t &count, connection* conn) {
+	ring[(head + count) % ring.size()] = conn;
+	count++;
+}
+
+Metrics& Server::metrics() {
+	return _metrics;
+}
+
+Server::connection* Server::pop(vector<connection*> &ring, size_t &head, size_t &count) {
+	if (count == 0) return 0;
+	connection* ret = ring[head];
+	head = (head + 1) % ring.size();
+	count--;
+	return ret;
+}
+
+
+
+// Each worker answers a batch of requests to one generator: the first it pops, plus
+// any others for the same path queued within coalesce_window. The path is looked up
+// once, the batch is evaluated as one job, and it goes back to the event loop with
+// one wakeup.
+void Server::work() {
+	string path, path_scratch, result;
+	vector<connection*> batch;
+	while (true) {
+		batch.clear();
+		{
+			std::unique_lock<std::mutex> guard(_jobs_lock);
+			_waiting++;
+			_jobs_ready.wait(guard, [this] { return _jobs_count > 0 || !_running; });
+			_waiting--;
+			if (!_running) return;
+			batch.push_back(pop(_jobs, _jobs_head, _jobs_count));
+			if (request_path(batch[0], path)) gather(guard, path, path_scratch, batch);
+		}
+		handle(batch, path, result);
+		{
+			std::lock_guard<std::mutex> guard(_done_lock);
+			for (vector<connection*>::iterator it = batch.begin(); it != batch.end(); ++it) {
+				push(_done, _done_head, _done_count, *it);
+			}
+		}
+		unsigned long long one = 1;
+		write(_wake_fd, &one, sizeof(one));
+	}
+}
+
+bool Server::request_path(const connection* conn, string &path) const {
+	const char* request = conn->in->data() + FRAME_HEADER_SIZE;
+	unsigned short path_length;
+	memcpy(&path_length, request + 12, sizeof(path_length));
+	if (REQUEST_FIXED_SIZE + path_length != conn->request_size - FRAME_HEADER_SIZE) return false;
+	path.assign(request + REQUEST_FIXED_SIZE, path_length);
+	return true;
+}
+
+// Called with _jobs_lock held. Requests already queued are taken straight away. The
+// worker only waits for more while the server is loaded, meaning other requests are
+// queued or no worker is free; otherwise a new request would be picked up at once by
+// an idle worker, and waiting would only add latency.
+void Server::gather(std::unique_lock<std::mutex> &guard, const string &path, string &path_scratch, vector<connection*> &batch) {
+	take(path, path_scratch, batch);
+	if (_config.coalesce_window == 0) return;
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(_config.coalesce_window);
+	_gathering++;
+	while (_running && batch.size() < _config.max_batch && (_jobs_count > 0 || _waiting == 0)) {
+		bool timed_out = _jobs_added.wait_until(guard, deadline) == std::cv_status::timeout;
+		take(path, path_scratch, batch);
+		if (timed_out) break;
+	}
+	_gathering--;
+}
+
+// Pulls queued requests for `path` out of the job ring, keeping the rest in order.
+// A connection only ever has one request queued, so this cannot reorder its replies.
+void Server::take(const string &path, string &path_scratch, vector<connection*> &batch) {
+	size_t queued = _jobs_count;
+	for (size_t i = 0; i < queued; i++) {
+		connection* conn = pop(_jobs, _jobs_head, _jobs_count);
+		if (batch.size() < _config.max_batch && request_path(conn, path_scratch) && path_scratch == path) batch.push_back(conn);
+		else push(_jobs, _jobs_head, _jobs_count, conn);
+	}
+}
+
+void Server::export_metrics() {
+	std::unique_lock<std::mutex> guard(_jobs_lock);
+	while (_running) {
+		guard.unlock();
+		_metrics.write_file(_config.metrics_path);
+		guard.lock();
+		_stopped.wait_for(guard, std::chrono::seconds(_config.metrics_interval), [this] { return !_running; });
+	}
+}
+
+// This is the worker boundary: nothing thrown while serving a batch may escape, or
+// it would end the process. Whatever is not a generation error still gets a reply.
+// The batch is answered in three passes: every request is checked, the accepted
+// ones are evaluated together as one job straight into their replies, and then
+// every reply is finished and counted. The job is timed as a whole, since timing
+// each result cost about a quarter of the evaluation time on small generators.
+void Server::handle(vector<connection*> &batch, string &path, string &result) {
+	unsigned int lookup = BAD_REQUEST;
+	const Item* item = 0;
+	if (request_path(batch[0], path)) {
+		try {
+			item = _generator.find(path);
+			lookup = REQUEST_OK;
+		}
+		catch (gen_errno) {
+			lookup = UNKNOWN_GENERATOR;
+		}
+		catch (...) {
+			lookup = GENERATION_FAILED;
+		}
+	}
+	for (vector<connection*>::iterator it = batch.begin(); it != batch.end(); ++it) check(*it, lookup);
+
+	unsigned long long started = metrics_now();
+	bool evaluated = false;
+	for (vector<connection*>::iterator it = batch.begin(); it != batch.end(); ++it) {
+		if ((*it)->status != REQUEST_OK) continue;
+		evaluate(*it, item, result);
+		evaluated = true;
+	}
+	unsigned long long finished = metrics_now();
+	if (evaluated) _evaluate_time->record(finished - started);
+
+	unsigned long long produced = 0;
+	size_t bytes = 0;
+	for (vector<connection*>::iterator it = batch.begin(); it != batch.end(); ++it) {
+		produced += finish(*it, finished, bytes);
+	}
+	if (produced > 0) {
+		_results->add(produced);
+		_result_bytes->add(bytes);
+	}
+	_batch_size->record(batch.size());
+}
+
+// `lookup` is the status of finding the generator, REQUEST_OK if it was found.
+// Leaves the request's status in the connection and its reply just the header.
+void Server::check(connection* conn, unsigned int lookup) {
+	unsigned int count;
+	memcpy(&count, conn->in->data() + FRAME_HEADER_SIZE + 8, sizeof(count));
+	conn->out->resize(FRAME_HEADER_SIZE + 8);
+	if (lookup == BAD_REQUEST) conn->status = BAD_REQUEST;
+	else if (count > _config.max_count) conn->status = COUNT_TOO_LARGE;
+	else conn->status = lookup;
+}
+
+// Appends every result of the request to its reply, or changes its status
+void Server::evaluate(connection* conn, const Item* item, string &result) {
+	const char* request = conn->in->data() + FRAME_HEADER_SIZE;
+	unsigned long long seed;
+	unsigned int count;
+	memcpy(&seed, request, sizeof(seed));
+	memcpy(&count, request + 8, sizeof(count));
+	vector<char> &out = *conn->out;
+	try {
+		for (unsigned int i = 0; i < count; i++) {
+			item->evaluate_at(seed, i, result);
+			unsigned int length = result.size();
+			append(out, &length, sizeof(length));
+			append(out, result.data(), result.size());
+		}
+	}
+	catch (gen_errno err) {
+		bool budget = err == NODE_BUDGET_EXCEEDED || err == OUTPUT_BUDGET_EXCEEDED || err == DEPTH_BUDGET_EXCEEDED;
+		conn->status = budget ? BUDGET_EXCEEDED : GENERATION_FAILED;
+	}
+	catch (...) {
+		conn->status = GENERATION_FAILED;
+	}
+}
+
+// Fills in the reply's header. Returns the number of results sent and adds their
+// bytes to `bytes`.
+unsigned int Server::finish(connection* conn, unsigned long long finished, size_t &bytes) {
+	vector<char> &out = *conn->out;
+	unsigned int produced = 0;
+	if (conn->status == REQUEST_OK) memcpy(&produced, conn->in->data() + FRAME_HEADER_SIZE + 8, sizeof(produced));
+	else out.resize(FRAME_HEADER_SIZE + 8);
+	put_u32(out, 0, out.size() - FRAME_HEADER_SIZE);
+	put_u32(out, 4, conn->status);
+	put_u32(out, 8, produced);
+
+	_requests[conn->status]->add();
+	if (produced > 0) bytes += out.size() - FRAME_HEADER_SIZE - 8 - 4 * produced;
+	_request_time->record(finished - conn->queued_at);
+	return produced;
+}
+
+#endif // __linux__
\ No newline at end of file
@@ -0,0 +1,342 @@
+#include "core.h"
+
+#ifdef __linux__
+
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <new>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <thread>
+
+static const unsigned long long NO_SEQUENCE = ~0ULL;
+static const size_t SHM_MIN_CAPACITY = 4096;
+
+static_assert(sizeof(std::atomic<unsigned int>) == sizeof(unsigned int), "futex words must be plain 32-bit integers");
+static_assert(sizeof(shm_record_header) == SHM_RECORD_ALIGN, "record headers must keep records aligned");
+
+// Not FUTEX_PRIVATE_FLAG: the word is shared with another process
+static void futex_wait(std::atomic<unsigned int>* word, unsigned int expected, int timeout_ms) {
+	timespec limit;
+	timespec* limit_ptr = 0;
+	if (timeout_ms >= 0) {
+		limit.tv_sec = timeout_ms / 1000;
+		limit.tv_nsec = (timeout_ms % 1000) * 1000000L;
+		limit_ptr = &limit;
+	}
+	syscall(SYS_futex, (unsigned int*)word, FUTEX_WAIT, expected, limit_ptr, 0, 0);
+}
+
+static void futex_wake(std::atomic<unsigned int>* word) {
+	syscall(SYS_futex, (unsigned int*)word, FUTEX_WAKE, INT_MAX, 0, 0, 0);
+}
+
+static unsigned long long record_size(unsigned int length) {
+	return (sizeof(shm_record_header) + length + SHM_RECORD_ALIGN - 1) & ~(unsigned long long)(SHM_RECORD_ALIGN - 1);
+}
+
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+// Spinning only helps when the other side is running on another core
+static unsigned int spin_limit() {
+	static const unsigned int limit = std::thread::hardware_concurrency() > 1 ? SHM_SPIN_LIMIT : 0;
+	return limit;
+}
+
+ShmRing::ShmRing(const string &path, size_t capacity, shm_full_policy policy) : _path(path_of(path)) {
+	_producer = true;
+	_policy = policy;
+	size_t records = ring_capacity(capacity < SHM_MIN_CAPACITY ? SHM_MIN_CAPACITY : capacity);
+	map(sizeof(shm_ring_header) + records, true);
+
+	// The magic goes in last, so a consumer attaching early fails rather than
+	// reading a half-made header
+	_header = new (_base) shm_ring_header();
+	_header->version = SHM_RING_VERSION;
+	_header->capacity = records;
+	_header->head.store(0, std::memory_order_relaxed);
+	_header->tail.store(0, std::memory_order_relaxed);
+	_header->data_signal.store(0, std::memory_order_relaxed);
+	_header->space_signal.store(0, std::memory_order_relaxed);
+	_header->consumer_waiting.store(0, std::memory_order_relaxed);
+	_header->producer_waiting.store(0, std::memory_order_relaxed);
+	_header->consumer_pid.store(0, std::memory_order_relaxed);
+	_header->detached.store(0, std::memory_order_relaxed);
+	_header->closed.store(0, std::memory_order_relaxed);
+	_header->end_sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	_header->magic = SHM_RING_MAGIC;
+
+	_records = _base + sizeof(shm_ring_header);
+	_mask = records - 1;
+	_position = 0;
+	_reserved = 0;
+	_sequence = 0;
+	_lost = 0;
+	_abandoned = false;
+}
+
+ShmRing::ShmRing(const string &path) : _path(path_of(path)) {
+	_producer = false;
+	_policy = SHM_BLOCK;
+	map(0, false);
+	_header = (shm_ring_header*)_base;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	unsigned long long records = _header->capacity;
+	if (_header->magic != SHM_RING_MAGIC || _header->version != SHM_RING_VERSION
+		|| records < SHM_MIN_CAPACITY || (records & (records - 1)) != 0 || sizeof(shm_ring_header) + records != _size) {
+		munmap(_base, _size);
+		::close(_fd);
+		throw(GEN_OTHER_ERROR);
+	}
+
+	_records = _base + sizeof(shm_ring_header);
+	_mask = records - 1;
+	_position = _header->tail.load(std::memory_order_acquire);
+	_reserved = 0;
+	// Nothing released yet means nothing was read before, so every result counts
+	_sequence = _position == 0 ? 0 : NO_SEQUENCE;
+	_lost = 0;
+	_abandoned = false;
+	_header->detached.store(0);
+	_header->consumer_pid.store(getpid());
+}
+
+// A consumer going away wakes a producer waiting on it, which then sees it gone
+ShmRing::~ShmRing() {
+	if (_producer) close();
+	else {
+		_header->detached.store(1);
+		_header->space_signal.fetch_add(1);
+		futex_wake(&_header->space_signal);
+	}
+	munmap(_base, _size);
+	::close(_fd);
+}
+
+void ShmRing::map(size_t size, bool create) {
+	// Truncating a ring in use would fault a consumer still reading it, so the old
+	// file is unlinked and a new one made in its place
+	if (create) ::unlink(_path.c_str());
+	_fd = create ? open(_path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600) : open(_path.c_str(), O_RDWR | O_CLOEXEC);
+	if (_fd < 0) throw(GEN_OTHER_ERROR);
+	if (create) {
+		if (ftruncate(_fd, size) != 0) {
+			::close(_fd);
+			throw(GEN_OTHER_ERROR);
+		}
+	}
+	else {
+		struct stat info;
+		if (fstat(_fd, &info) != 0 || (size_t)info.st_size < sizeof(shm_ring_header)) {
+			::close(_fd);
+			throw(GEN_OTHER_ERROR);
+		}
+		size = info.st_size;
+	}
+	void* base = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+	if (base == MAP_FAILED) {
+		::close(_fd);
+		throw(GEN_OTHER_ERROR);
+	}
+	_base = (char*)base;
+	_size = size;
+}
+
+string ShmRing::path_of(const string &name) {
+	return name.find('/') == string::npos ? SHM_RING_DIR + name : name;
+}
+
+bool ShmRing::remove(const string &name) {
+	return ::unlink(path_of(name).c_str()) == 0;
+}
+
+size_t ShmRing::max_length() const {
+	return (_mask + 1) / 2 - sizeof(shm_record_header);
+}
+
+// A consumer that crashed never detaches, so its process is looked for as well
+bool ShmRing::consumer_gone(int waited_ms) const {
+	if (_header->detached.load()) return true;
+	int pid = _header->consumer_pid.load();
+	if (pid == 0) return waited_ms >= SHM_ATTACH_TIMEOUT_MS;
+	return kill(pid, 0) != 0 && errno == ESRCH;
+}
+
+// Spins first, since a consumer keeping up frees space within microseconds. The
+// waiting flag is set before space is checked once more; commit() and release()
+// publish before they look at the flag, so one side always sees the other. The
+// side that wakes clears the flag, so a sleeper that has been woken but not yet
+// run costs the other side no further syscalls. Sleeps are bounded, so a consumer
+// that is gone is noticed within SHM_WAIT_SLICE_MS.
+bool ShmRing::wait_for_space(unsigned long long needed) {
+	unsigned long long capacity = _mask + 1;
+	if (_position + needed - _header->tail.load(std::memory_order_acquire) <= capacity) return true;
+	if (_policy == SHM_DROP) return false;
+	for (unsigned int i = 0; i < spin_limit(); i++) {
+		cpu_relax();
+		if (_position + needed - _header->tail.load(std::memory_order_acquire) <= capacity) return true;
+	}
+	std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+	bool ready = false;
+	while (true) {
+		unsigned int signal = _header->space_signal.load();
+		_header->producer_waiting.store(1);
+		if (_position + needed - _header->tail.load() <= capacity) {
+			ready = true;
+			break;
+		}
+		long long waited = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+		if (consumer_gone((int)(waited < INT_MAX ? waited : INT_MAX))) {
+			_abandoned = true;
+			break;
+		}
+		futex_wait(&_header->space_signal, signal, SHM_WAIT_SLICE_MS);
+	}
+	_header->producer_waiting.store(0, std::memory_order_relaxed);
+	return ready;
+}
+
+char* ShmRing::reserve(unsigned int length) {
+	if (!_producer || _abandoned || _header->closed.load(std::memory_order_relaxed)) return 0;
+	unsigned long long needed = record_size(length);
+	unsigned long long offset = _position & _mask;
+	unsigned long long pad = offset + needed > _mask + 1 ? _mask + 1 - offset : 0;
+	if (length > max_length() || !wait_for_space(pad + needed)) {
+		// Its sequence number is still used up, so the consumer can count it as lost
+		_sequence++;
+		return 0;
+	}
+
+	if (pad != 0) {
+		shm_record_header* filler = (shm_record_header*)(_records + offset);
+		filler->sequence = 0;
+		filler->length = pad - sizeof(shm_record_header);
+		filler->padding = 1;
+		_position += pad;
+	}
+	shm_record_header* record = (shm_record_header*)(_records + (_position & _mask));
+	record->sequence = _sequence;
+	record->length = length;
+	record->padding = 0;
+	_reserved = needed;
+	return (char*)(record + 1);
+}
+
+void ShmRing::commit() {
+	_position += _reserved;
+	_reserved = 0;
+	_sequence++;
+	_header->head.store(_position);
+	if (_header->consumer_waiting.exchange(0)) {
+		_header->data_signal.fetch_add(1);
+		futex_wake(&_header->data_signal);
+	}
+}
+
+bool ShmRing::write(const char* data, unsigned int length) {
+	char* target = reserve(length);
+	if (target == 0) return false;
+	memcpy(target, data, length);
+	commit();
+	return true;
+}
+
+// The final sequence goes in first, so the consumer can count results dropped after
+// the last one it got
+void ShmRing::close() {
+	if (!_producer || _header->closed.load(std::memory_order_relaxed)) return;
+	_header->end_sequence.store(_sequence, std::memory_order_relaxed);
+	_header->closed.store(1);
+	_header->data_signal.fetch_add(1);
+	futex_wake(&_header->data_signal);
+}
+
+bool ShmRing::abandoned() const {
+	return _abandoned;
+}
+
+bool ShmRing::wait_for_data(int timeout_ms) {
+	for (unsigned int i = 0; i < spin_limit(); i++) {
+		cpu_relax();
+		if (_header->head.load(std::memory_order_acquire) != _position) return true;
+	}
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+	bool ready = false;
+	while (true) {
+		unsigned int signal = _header->data_signal.load();
+		_header->consumer_waiting.store(1);
+		if (_header->head.load() != _position) {
+			ready = true;
+			break;
+		}
+		// closed is set after the last head store, so an empty ring now stays empty
+		if (_header->closed.load()) break;
+		int wait_ms = -1;
+		if (timeout_ms >= 0) {
+			long long left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+			if (left <= 0) break;
+			wait_ms = (int)left;
+		}
+		futex_wait(&_header->data_signal, signal, wait_ms);
+	}
+	_header->consumer_waiting.store(0, std::memory_order_relaxed);
+	return ready;
+}
+
+bool ShmRing::read(shm_result &result, int timeout_ms) {
+	if (_producer) return false;
+	while (true) {
+		if (_header->head.load(std::memory_order_acquire) == _position && !wait_for_data(timeout_ms)) {
+			if (closed() && _header->head.load(std::memory_order_acquire) == _position && _sequence != NO_SEQUENCE) {
+				unsigned long long end = _header->end_sequence.load(std::memory_order_relaxed);
+				if (end > _sequence) _lost += end - _sequence;
+				_sequence = end;
+			}
+			return false;
+		}
+		const shm_record_header* record = (const shm_record_header*)(_records + (_position & _mask));
+		if (record->padding) {
+			_position += sizeof(shm_record_header) + record->length;
+			continue;
+		}
+		if (_sequence != NO_SEQUENCE && record->sequence > _sequence) _lost += record->sequence - _sequence;
+		_sequence = record->sequence + 1;
+		result.sequence = record->sequence;
+		result.data = (const char*)(record + 1);
+		result.length = record->length;
+		_position += record_size(record->length);
+		return true;
+	}
+}
+
+void ShmRing::release() {
+	if (_producer) return;
+	_header->tail.store(_position);
+	if (_header->producer_waiting.exchange(0)) {
+		_header->space_signal.fetch_add(1);
+		futex_wake(&_header->space_signal);
+	}
+}
+
+unsigned long long ShmRing::lost() const {
+	return _lost;
+}
+
+bool ShmRing::closed() const {
+	return _header->closed.load(std::memory_order_acquire) != 0;
+}
+
+#endif // __linux__
\ No newline at end of file
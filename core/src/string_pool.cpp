@@ -0,0 +1,201 @@
+#include "core.h"
+
+#include <algorithm>
+#include <string.h>
+#include <string_view>
+
+static const unsigned int MIN_WORD_LENGTH = 3;
+static const size_t MIN_INDEX_SIZE = 16;
+
+static size_t hash_bytes(const unsigned char* data, size_t size) {
+	return std::hash<std::string_view>()(std::string_view((const char*)data, size));
+}
+
+// A word is a run of letters or digits plus the one space after it, which is
+// how flavour text repeats: whole words, not arbitrary substrings
+static size_t word_end(const string &text, size_t start) {
+	size_t end = start;
+	while (end < text.size() && (isalnum((unsigned char)text[end]) || (unsigned char)text[end] >= 0x80)) end++;
+	if (end == start) return start + 1;
+	if (end < text.size() && text[end] == ' ') end++;
+	return end;
+}
+
+StringPool::StringPool() {
+	_frozen = false;
+	_offsets.push_back(0);
+	_offsets.push_back(0);
+	rehash(MIN_INDEX_SIZE);
+}
+
+StringPool::~StringPool() { }
+
+void StringPool::encode(const string &text, vector<unsigned char> &out) const {
+	for (size_t start = 0; start < text.size();) {
+		size_t end = word_end(text, start);
+		if (end - start >= MIN_WORD_LENGTH) {
+			hashmap<string, unsigned int>::const_iterator it = _codes.find(text.substr(start, end - start));
+			if (it != _codes.end()) {
+				out.push_back((unsigned char)(WORD_PREFIX + it->second / 256));
+				out.push_back((unsigned char)(it->second % 256));
+				start = end;
+				continue;
+			}
+		}
+		for (; start < end; start++) {
+			unsigned char c = text[start];
+			if (c >= WORD_PREFIX) out.push_back(ESCAPE);
+			out.push_back(c);
+		}
+	}
+}
+
+// Decodes one code: returns its word, or 0 with the text byte in `literal`
+const string* StringPool::next(const unsigned char* &at, char &literal) const {
+	unsigned char b = *at++;
+	if (b < WORD_PREFIX) {
+		literal = (char)b;
+		return 0;
+	}
+	if (b == ESCAPE) {
+		literal = (char)*at++;
+		return 0;
+	}
+	return &_words[(b - WORD_PREFIX) * 256 + *at++];
+}
+
+// Equal texts encode to equal bytes under one dictionary, so the text is encoded
+// straight onto the end of the pool and compared there, and taken back off if an
+// entry already holds it
+unsigned int StringPool::add(const string &text) {
+	size_t start = _data.size();
+	encode(text, _data);
+	size_t length = _data.size() - start;
+	size_t mask = _index.size() - 1;
+	size_t slot = hash_bytes(_data.data() + start, length) & mask;
+	for (; _index[slot] != NO_ID; slot = (slot + 1) & mask) {
+		unsigned int id = _index[slot];
+		if (_offsets[id + 1] - _offsets[id] != length) continue;
+		if (length != 0 && memcmp(_data.data() + _offsets[id], _data.data() + start, length) != 0) continue;
+		_data.resize(start);
+		return id;
+	}
+	unsigned int id = size();
+	_offsets.push_back(_data.size());
+	_index[slot] = id;
+	if (size() * 2 > _index.size()) rehash(_index.size() * 2);
+	return id;
+}
+
+size_t StringPool::hash(unsigned int id) const {
+	return hash_bytes(_data.data() + _offsets[id], _offsets[id + 1] - _offsets[id]);
+}
+
+// Linear probing, kept at most half full
+void StringPool::rehash(size_t capacity) {
+	_index.assign(capacity, NO_ID);
+	size_t mask = capacity - 1;
+	for (unsigned int id = 0; id < size(); id++) {
+		size_t slot = hash(id) & mask;
+		while (_index[slot] != NO_ID) slot = (slot + 1) & mask;
+		_index[slot] = id;
+	}
+}
+
+string StringPool::get(unsigned int id) const {
+	string ret;
+	append(id, ret);
+	return ret;
+}
+
+void StringPool::append(unsigned int id, string &out) const {
+	if (id >= size()) throw(OPTION_NOT_FOUND);
+	const unsigned char* at = _data.data() + _offsets[id];
+	const unsigned char* end = _data.data() + _offsets[id + 1];
+	char literal;
+	while (at < end) {
+		const string* word = next(at, literal);
+		if (word == 0) out.push_back(literal);
+		else out += *word;
+	}
+}
+
+size_t StringPool::length(unsigned int id) const {
+	if (id >= size()) throw(OPTION_NOT_FOUND);
+	size_t ret = 0;
+	const unsigned char* at = _data.data() + _offsets[id];
+	const unsigned char* end = _data.data() + _offsets[id + 1];
+	char literal;
+	while (at < end) {
+		const string* word = next(at, literal);
+		ret += word == 0 ? 1 : word->size();
+	}
+	return ret;
+}
+
+// Words are ranked by the bytes they would save: every use shrinks from the word's
+// length to a two-byte code
+void StringPool::train(const vector<string> &texts) {
+	hashmap<string, unsigned int> counts;
+	for (vector<string>::const_iterator it = texts.begin(); it != texts.end(); ++it) {
+		for (size_t start = 0; start < it->size();) {
+			size_t end = word_end(*it, start);
+			if (end - start >= MIN_WORD_LENGTH) counts[it->substr(start, end - start)]++;
+			start = end;
+		}
+	}
+	vector<std::pair<unsigned long long, string>> ranked;
+	for (hashmap<string, unsigned int>::const_iterator it = counts.begin(); it != counts.end(); ++it) {
+		unsigned long long saving = (unsigned long long)it->second * (it->first.size() - 2);
+		if (it->second > 1 && saving > it->first.size()) ranked.push_back(std::make_pair(saving, it->first));
+	}
+	// Ties broken by the word so the dictionary does not depend on hash order
+	std::sort(ranked.begin(), ranked.end(), [](const std::pair<unsigned long long, string> &a, const std::pair<unsigned long long, string> &b) {
+		return a.first != b.first ? a.first > b.first : a.second < b.second;
+	});
+	if (ranked.size() > MAX_WORDS) ranked.resize(MAX_WORDS);
+
+	_words.clear();
+	_codes.clear();
+	for (vector<std::pair<unsigned long long, string>>::const_iterator it = ranked.begin(); it != ranked.end(); ++it) {
+		_codes[it->second] = _words.size();
+		_words.push_back(it->second);
+	}
+}
+
+// Builds the dictionary from everything added so far and re-encodes with it. Ids do
+// not change. Texts added afterwards are encoded with the same dictionary. The dedup
+// table hashes encoded bytes, so it is rebuilt once here, in the same pass over the
+// pool; an add() afterwards costs what one before it does.
+void StringPool::freeze() {
+	if (_frozen) return;
+	vector<string> texts;
+	for (unsigned int id = 0; id < size(); id++) texts.push_back(get(id));
+	train(texts);
+
+	vector<unsigned char> data;
+	vector<unsigned int> offsets(1, 0);
+	for (vector<string>::const_iterator it = texts.begin(); it != texts.end(); ++it) {
+		encode(*it, data);
+		offsets.push_back(data.size());
+	}
+	_data.swap(data);
+	_offsets.swap(offsets);
+	_data.shrink_to_fit();
+	rehash(_index.size());
+	_frozen = true;
+}
+
+bool StringPool::frozen() const {
+	return _frozen;
+}
+
+unsigned int StringPool::size() const {
+	return _offsets.size() - 1;
+}
+
+size_t StringPool::bytes() const {
+	size_t ret = _data.size() + _offsets.size() * sizeof(unsigned int);
+	for (vector<string>::const_iterator it = _words.begin(); it != _words.end(); ++it) ret += it->size();
+	return ret;
+}
\ No newline at end of file
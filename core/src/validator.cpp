@@ -0,0 +1,323 @@
+#include "core.h"
+
+#include <algorithm>
+
+static const type_mask REF_BITS = ITEM_REF_BIT | GROUP_REF_BIT | OPTION_REF_BIT | GROUP_OPTION_REF_BIT;
+
+// Children are looked up by parent and name; NO_NODE as the parent is the Generator
+static string child_key(unsigned int parent, const string &name, string::size_type start = 0, string::size_type length = string::npos) {
+	string ret((const char*)&parent, sizeof(parent));
+	ret.append(name, start, length);
+	return ret;
+}
+
+Validator::Validator(const Generator &gen, unsigned int threads) : _generator(gen) {
+	_threads = threads == 0 ? 1 : threads;
+}
+
+Validator::~Validator() { }
+
+void Validator::add_doc(const string &xml_file) {
+	_files.push_back(xml_file);
+}
+
+void Validator::add_entry(const string &path) {
+	_entries.push_back(path);
+}
+
+// Mirrors Generator::create() and Item::add_child(): the tag must have a factory, an
+// option's weight must parse, and siblings may not share a name. Elements that fail are
+// reported and left out along with everything under them, as load() would stop there.
+// Problems are kept against the local parent and the element's name, and the paths
+// are only put together in merge(), once numbering at the top is known.
+void Validator::check_doc(const string &xml_file, doc_result &result) const {
+	XMLDoc* doc;
+	try {
+		doc = new XMLDoc(xml_file);
+	}
+	catch (gen_errno err) {
+		result.problems.push_back({ err, NO_NODE, NO_NODE, "" });
+		return;
+	}
+	vector<std::pair<XMLNode, unsigned int>> stack;
+	stack.push_back(std::make_pair(doc->root(), NO_NODE));
+	while (!stack.empty()) {
+		XMLNode node = stack.back().first;
+		unsigned int parent = stack.back().second;
+		stack.pop_back();
+		vector<XMLNode> kids = node.children();
+		// A reference hands its children to its base, which is not bound until later
+		if (parent != NO_NODE && (result.entries[parent].types & ITEM_REF_BIT) != 0 && !kids.empty()) {
+			result.problems.push_back({ ITEM_NOT_FOUND, result.entries[parent].parent, result.entries[parent].position, result.entries[parent].name });
+			continue;
+		}
+		hashmap<string, bool> names;
+		for (vector<XMLNode>::const_iterator it = kids.begin(); it != kids.end(); ++it) {
+			entry curr = { "", "", 0, parent, (unsigned int)names.size() };
+			if (it->has_attr(Item::id_attr)) curr.name = it->attr(Item::id_attr);
+			string name = curr.name.empty() ? "#" + std::to_string(curr.position) : curr.name;
+			curr.types = _generator.kind(it->tag(), it->tag_length());
+			if (curr.types == 0) {
+				result.problems.push_back({ UNKNOWN_ELEMENT, parent, curr.position, curr.name });
+				continue;
+			}
+			unsigned int weight;
+			if ((curr.types & OPTION_BIT) != 0 && it->has_attr(Option::weight_attr) && !Option::parse_weight(it->attr(Option::weight_attr), weight)) {
+				result.problems.push_back({ PARSE_ERROR, parent, curr.position, curr.name });
+				continue;
+			}
+			if (names.find(name) != names.end()) {
+				result.problems.push_back({ NAME_COLLISION, parent, curr.position, curr.name });
+				continue;
+			}
+			names[name] = true;
+			if ((curr.types & ITEM_REF_BIT) != 0) curr.ref = it->attr(ItemRef::ref_attr);
+			result.entries.push_back(curr);
+			stack.push_back(std::make_pair(*it, (unsigned int)result.entries.size() - 1));
+		}
+	}
+	delete doc;
+}
+
+// Documents go in one after another as load() adds them. Unnamed items at the top are
+// numbered by how many are at the top already, and a top level name a previous
+// document took is a collision; entries under a dropped one are dropped with it.
+void Validator::merge(vector<doc_result> &docs) {
+	unsigned int top_count = 0;
+	for (unsigned int d = 0; d < docs.size(); d++) {
+		doc_result &doc = docs[d];
+		unsigned int top_before = top_count;
+		vector<unsigned int> global(doc.entries.size(), NO_NODE);
+		for (unsigned int i = 0; i < doc.entries.size(); i++) {
+			entry curr = doc.entries[i];
+			if (curr.parent != NO_NODE) {
+				if (global[curr.parent] == NO_NODE) continue;
+				curr.parent = global[curr.parent];
+			}
+			if (curr.name.empty()) curr.name = "#" + std::to_string(curr.parent == NO_NODE ? top_count : curr.position);
+			string key = child_key(curr.parent, curr.name);
+			if (_by_name.find(key) != _by_name.end()) {
+				_problems.push_back({ NAME_COLLISION, _files[d], path_of(curr.parent, curr.name) });
+				continue;
+			}
+			global[i] = _nodes.size();
+			_by_name[key] = _nodes.size();
+			_nodes.push_back(curr);
+			_doc_of.push_back(d);
+			if (curr.parent == NO_NODE) top_count++;
+		}
+		for (vector<local_problem>::const_iterator it = doc.problems.begin(); it != doc.problems.end(); ++it) {
+			if (it->position == NO_NODE) {
+				_problems.push_back({ it->code, _files[d], "" });
+				continue;
+			}
+			unsigned int parent = it->parent == NO_NODE ? NO_NODE : global[it->parent];
+			if (it->parent != NO_NODE && parent == NO_NODE) continue;
+			string name = it->name;
+			if (name.empty()) name = "#" + std::to_string(it->parent == NO_NODE ? top_before + it->position : it->position);
+			_problems.push_back({ it->code, _files[d], path_of(parent, name) });
+		}
+	}
+
+	unsigned int count = _nodes.size();
+	_child_start.assign(count + 1, 0);
+	_children.assign(count, 0);
+	_top.clear();
+	for (unsigned int i = 0; i < count; i++) {
+		if (_nodes[i].parent == NO_NODE) _top.push_back(i);
+		else _child_start[_nodes[i].parent + 1]++;
+	}
+	for (unsigned int i = 0; i < count; i++) _child_start[i + 1] += _child_start[i];
+	vector<unsigned int> fill(_child_start.begin(), _child_start.end() - 1);
+	for (unsigned int i = 0; i < count; i++) {
+		if (_nodes[i].parent != NO_NODE) _children[fill[_nodes[i].parent]++] = i;
+	}
+}
+
+string Validator::path_of(unsigned int parent, const string &name) const {
+	string ret = name;
+	for (unsigned int curr = parent; curr != NO_NODE; curr = _nodes[curr].parent) {
+		ret = _nodes[curr].name + PATH_DELIMITER + ret;
+	}
+	return ret;
+}
+
+// Generator::find() over the entries: a reference on the way is looked through to its
+// base, and one not bound yet has no children, just as ItemRef::has_child() says
+bool Validator::find(const string &path, unsigned int &found) const {
+	unsigned int curr = NO_NODE;
+	string::size_type start = 0;
+	const string::size_type delim_len = string(PATH_DELIMITER).size();
+	while (start <= path.size()) {
+		string::size_type end = path.find(PATH_DELIMITER, start);
+		if (end == string::npos) end = path.size();
+		if (end > start) {
+			while (curr != NO_NODE && (_nodes[curr].types & ITEM_REF_BIT) != 0) {
+				if (_targets[curr] == NO_NODE || _targets[curr] == ROOT) return false;
+				curr = _targets[curr];
+			}
+			hashmap<string, unsigned int>::const_iterator it = _by_name.find(child_key(curr, path, start, end - start));
+			if (it == _by_name.end()) return false;
+			curr = it->second;
+		}
+		start = end + delim_len;
+	}
+	found = curr == NO_NODE ? ROOT : curr;
+	return true;
+}
+
+// Same walk as Generator::bind_refs(), so a path through another reference only works
+// where load() would already have bound that one. A reference to the Generator itself
+// contains itself, so it is a cycle without going any further.
+void Validator::bind_refs() {
+	_targets.assign(_nodes.size(), NO_NODE);
+	vector<unsigned int> stack(_top.begin(), _top.end());
+	while (!stack.empty()) {
+		unsigned int v = stack.back();
+		stack.pop_back();
+		const entry &curr = _nodes[v];
+		if ((curr.types & ITEM_REF_BIT) != 0) {
+			unsigned int base;
+			if (curr.ref.empty() || !find(curr.ref, base)) {
+				report(BAD_REFERENCE, v);
+				continue;
+			}
+			type_mask base_types = base == ROOT ? Generator::typemask : _nodes[base].types;
+			type_mask wanted = curr.types & ~REF_BITS;
+			if ((base_types & wanted) != wanted) {
+				report(BAD_REFERENCE, v);
+				continue;
+			}
+			_targets[v] = base;
+			if (base == ROOT) report(REFERENCE_CYCLE, v);
+			continue;
+		}
+		for (unsigned int i = _child_start[v]; i < _child_start[v + 1]; i++) stack.push_back(_children[i]);
+	}
+}
+
+// Edge `edge` of node v: a reference has its base, anything else its children
+unsigned int Validator::edge_target(unsigned int v, unsigned int edge) const {
+	if ((_nodes[v].types & ITEM_REF_BIT) != 0) {
+		if (edge > 0 || _targets[v] == ROOT) return NO_NODE;
+		return _targets[v];
+	}
+	unsigned int slot = _child_start[v] + edge;
+	return slot < _child_start[v + 1] ? _children[slot] : NO_NODE;
+}
+
+// Iterative Tarjan over containment and reference edges. Containment alone is a tree,
+// so every strongly connected component of more than one node, or a reference to
+// itself, goes through a reference; each is reported once, at its first reference.
+void Validator::find_cycles() {
+	unsigned int count = _nodes.size();
+	vector<unsigned int> index(count, NO_NODE), low(count, 0), component;
+	vector<bool> on_stack(count, false);
+	vector<std::pair<unsigned int, unsigned int>> calls;
+	unsigned int counter = 0;
+	for (unsigned int start = 0; start < count; start++) {
+		if (index[start] != NO_NODE) continue;
+		calls.push_back(std::make_pair(start, 0u));
+		index[start] = low[start] = counter++;
+		component.push_back(start);
+		on_stack[start] = true;
+		while (!calls.empty()) {
+			unsigned int v = calls.back().first;
+			unsigned int next = edge_target(v, calls.back().second++);
+			if (next != NO_NODE) {
+				if (index[next] == NO_NODE) {
+					index[next] = low[next] = counter++;
+					component.push_back(next);
+					on_stack[next] = true;
+					calls.push_back(std::make_pair(next, 0u));
+				}
+				else if (on_stack[next] && index[next] < low[v]) low[v] = index[next];
+				continue;
+			}
+
+			calls.pop_back();
+			if (!calls.empty() && low[v] < low[calls.back().first]) low[calls.back().first] = low[v];
+			if (low[v] != index[v]) continue;
+
+			vector<unsigned int> members;
+			unsigned int w;
+			do {
+				w = component.back();
+				component.pop_back();
+				on_stack[w] = false;
+				members.push_back(w);
+			} while (w != v);
+			if (members.size() < 2 && _targets[v] != v) continue;
+
+			std::sort(members.begin(), members.end());
+			for (vector<unsigned int>::const_iterator it = members.begin(); it != members.end(); ++it) {
+				if ((_nodes[*it].types & ITEM_REF_BIT) != 0) {
+					report(REFERENCE_CYCLE, *it);
+					break;
+				}
+			}
+		}
+	}
+}
+
+// With entry paths given, whatever evaluating them cannot get to is reported. Only top
+// level items are listed, and one counts as used if anything under it is reached.
+void Validator::find_unreachable() {
+	if (_entries.empty()) return;
+	vector<bool> reached(_nodes.size(), false);
+	vector<unsigned int> stack;
+	for (vector<string>::const_iterator it = _entries.begin(); it != _entries.end(); ++it) {
+		unsigned int start;
+		if (!find(*it, start)) {
+			_problems.push_back({ ITEM_NOT_FOUND, "", *it });
+			continue;
+		}
+		if (start == ROOT) return;
+		stack.push_back(start);
+	}
+	while (!stack.empty()) {
+		unsigned int v = stack.back();
+		stack.pop_back();
+		if (reached[v]) continue;
+		reached[v] = true;
+		unsigned int next;
+		for (unsigned int edge = 0; (next = edge_target(v, edge)) != NO_NODE; edge++) {
+			if (!reached[next]) stack.push_back(next);
+		}
+	}
+	// Children always come after their parent, so one backwards pass carries it up
+	for (unsigned int i = _nodes.size(); i-- > 0;) {
+		if (reached[i] && _nodes[i].parent != NO_NODE) reached[_nodes[i].parent] = true;
+	}
+	for (vector<unsigned int>::const_iterator it = _top.begin(); it != _top.end(); ++it) {
+		if (!reached[*it]) report(UNREACHABLE_ITEM, *it);
+	}
+}
+
+void Validator::report(gen_errno code, unsigned int node) {
+	_problems.push_back({ code, _files[_doc_of[node]], path_of(_nodes[node].parent, _nodes[node].name) });
+}
+
+// Problems come out per document as they were found, then those binding, cycles and
+// entries turned up across the whole set
+vector<load_problem> Validator::run() {
+	_nodes.clear();
+	_doc_of.clear();
+	_by_name.clear();
+	_problems.clear();
+
+	vector<doc_result> docs(_files.size());
+	{
+		Scheduler pool(_threads);
+		TaskGroup checking;
+		for (unsigned int i = 0; i < _files.size(); i++) {
+			pool.spawn(checking, [this, &docs, i] { check_doc(_files[i], docs[i]); });
+		}
+		pool.wait(checking);
+	}
+	merge(docs);
+	bind_refs();
+	find_cycles();
+	find_unreachable();
+	return _problems;
+}
\ No newline at end of file
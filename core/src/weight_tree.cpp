@@ -0,0 +1,124 @@
+#include "core.h"
+
+WeightTree::WeightTree() {
+	_sums.push_back(0);
+	_total = 0;
+	_top = 0;
+}
+
+WeightTree::WeightTree(const vector<unsigned int> &weights) : WeightTree() {
+	_weights = weights;
+	_sums.resize(weights.size() + 1, 0);
+	for (unsigned int i = 1; i <= weights.size(); i++) {
+		_sums[i] += weights[i - 1];
+		_total += weights[i - 1];
+		unsigned int up = i + (i & (0 - i));
+		if (up <= weights.size()) _sums[up] += _sums[i];
+	}
+	if (size() > 0) _top = 1;
+	while (_top != 0 && (_top << 1) <= size()) _top <<= 1;
+}
+
+WeightTree::~WeightTree() { }
+
+unsigned long long WeightTree::prefix(unsigned int count) const {
+	unsigned long long ret = 0;
+	for (unsigned int i = count; i > 0; i -= i & (0 - i)) ret += _sums[i];
+	return ret;
+}
+
+unsigned int WeightTree::size() const {
+	return _weights.size();
+}
+
+bool WeightTree::empty() const {
+	return _weights.empty();
+}
+
+unsigned long long WeightTree::total() const {
+	return _total;
+}
+
+unsigned int WeightTree::weight(unsigned int index) const {
+	if (index >= size()) throw(OPTION_NOT_FOUND);
+	return _weights[index];
+}
+
+void WeightTree::weight(unsigned int index, unsigned int new_weight) {
+	if (index >= size()) throw(OPTION_NOT_FOUND);
+	unsigned long long old_weight = _weights[index];
+	_weights[index] = new_weight;
+	_total = _total - old_weight + new_weight;
+	for (unsigned int i = index + 1; i <= size(); i += i & (0 - i)) {
+		_sums[i] = _sums[i] - old_weight + new_weight;
+	}
+}
+
+unsigned int WeightTree::push_back(unsigned int new_weight) {
+	unsigned int i = size() + 1;
+	unsigned int low = i & (0 - i);
+	// A new node covers (i - low, i]: everything but itself is already summed
+	_sums.push_back(prefix(i - 1) - prefix(i - low) + new_weight);
+	_weights.push_back(new_weight);
+	_total += new_weight;
+	if (_top == 0) _top = 1;
+	else if ((_top << 1) <= size()) _top <<= 1;
+	return i - 1;
+}
+
+void WeightTree::pop_back() {
+	if (empty()) return;
+	_total -= _weights.back();
+	_weights.pop_back();
+	_sums.pop_back();
+	if (_top > size()) _top >>= 1;
+}
+
+void WeightTree::clear() {
+	_weights.clear();
+	_sums.resize(1);
+	_total = 0;
+	_top = 0;
+}
+
+unsigned int WeightTree::find(unsigned long long target) const {
+	if (target >= _total) throw(OPTION_NOT_FOUND);
+	unsigned int pos = 0;
+	for (unsigned int step = _top; step != 0; step >>= 1) {
+		if (pos + step <= size() && _sums[pos + step] <= target) {
+			pos += step;
+			target -= _sums[pos];
+		}
+	}
+	return pos;
+}
+
+// Takes a slot's weight off every node that covers it, along the same path an update
+// would write: O(log n). A slot must be excluded at most once per overlay.
+void WeightTree::exclude(unsigned int index, weight_overlay &overlay) const {
+	if (index >= size()) throw(OPTION_NOT_FOUND);
+	for (unsigned int i = index + 1; i <= size(); i += i & (0 - i)) overlay[i] += _weights[index];
+}
+
+// As find(), reading each node less its overlay entry; target must fall below the
+// total less the excluded weights. One lookup per step keeps it O(log n).
+unsigned int WeightTree::find(unsigned long long target, const weight_overlay &overlay) const {
+	unsigned int pos = 0;
+	for (unsigned int step = _top; step != 0; step >>= 1) {
+		if (pos + step > size()) continue;
+		unsigned long long sum = _sums[pos + step];
+		weight_overlay::const_iterator taken = overlay.find(pos + step);
+		if (taken != overlay.end()) sum -= taken->second;
+		if (sum <= target) {
+			pos += step;
+			target -= sum;
+		}
+	}
+	if (pos >= size()) throw(OPTION_NOT_FOUND);
+	return pos;
+}
+
+unsigned int WeightTree::sample(random_engine &rng) const {
+	if (_total == 0) throw(NO_OPTIONS);
+	return find(rng.below(_total));
+}
\ No newline at end of file
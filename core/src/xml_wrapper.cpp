@@ -0,0 +1,98 @@
+#include "core.h"
+
+XMLAttr::XMLAttr(const rapidxml::xml_attribute<>* base_attr) {
+	_attr = base_attr;
+}
+
+XMLAttr::~XMLAttr() { }
+
+string XMLAttr::name() const {
+	return string(_attr->name(), _attr->name_size());
+}
+
+string XMLAttr::value() const {
+	return string(_attr->value(), _attr->value_size());
+}
+
+XMLNode::XMLNode() {
+	_node = 0;
+}
+
+XMLNode::XMLNode(const rapidxml::xml_node<>* base_node) {
+	_node = base_node;
+}
+
+XMLNode::~XMLNode() { }
+
+bool XMLNode::valid() const {
+	return _node != 0;
+}
+
+const char* XMLNode::tag() const {
+	return _node->name();
+}
+
+size_t XMLNode::tag_length() const {
+	return _node->name_size();
+}
+
+string XMLNode::value() const {
+	return string(_node->value(), _node->value_size());
+}
+
+vector<XMLAttr> XMLNode::attributes() const {
+	vector<XMLAttr> ret;
+	for (const rapidxml::xml_attribute<>* it = _node->first_attribute(); it != 0; it = it->next_attribute()) ret.push_back(XMLAttr(it));
+	return ret;
+}
+
+bool XMLNode::has_attr(const string &attr_name) const {
+	return _node->first_attribute(attr_name.c_str(), attr_name.size()) != 0;
+}
+
+string XMLNode::attr(const string &attr_name) const {
+	const rapidxml::xml_attribute<>* found = _node->first_attribute(attr_name.c_str(), attr_name.size());
+	return found == 0 ? string() : XMLAttr(found).value();
+}
+
+vector<XMLNode> XMLNode::children() const {
+	vector<XMLNode> ret;
+	for (const rapidxml::xml_node<>* it = _node->first_node(); it != 0; it = it->next_sibling()) {
+		if (it->type() == rapidxml::node_element) ret.push_back(XMLNode(it));
+	}
+	return ret;
+}
+
+XMLDoc::XMLDoc(const string &xml_file) {
+	FILE* in = fopen(xml_file.c_str(), "rb");
+	if (in == 0) throw(FILE_NOT_READABLE);
+	char chunk[64 * 1024];
+	size_t got;
+	while ((got = fread(chunk, 1, sizeof(chunk), in)) > 0) _text.insert(_text.end(), chunk, chunk + got);
+	bool failed = ferror(in) != 0;
+	fclose(in);
+	if (failed) throw(FILE_NOT_READABLE);
+	parse();
+}
+
+// rapidxml parses in place, so the text is copied even when it is already in memory
+XMLDoc::XMLDoc(const char* text, size_t length) : _text(text, text + length) {
+	parse();
+}
+
+void XMLDoc::parse() {
+	_text.push_back(0);
+	try {
+		_doc.parse<0>(_text.data());
+	}
+	catch (const rapidxml::parse_error&) {
+		throw(PARSE_ERROR);
+	}
+	if (_doc.first_node() == 0) throw(PARSE_ERROR);
+}
+
+XMLDoc::~XMLDoc() { }
+
+XMLNode XMLDoc::root() const {
+	return XMLNode(_doc.first_node());
+}
\ No newline at end of file
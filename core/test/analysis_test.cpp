@@ -0,0 +1,121 @@
+#include "test.h"
+
+static Rational power(const Rational &base, unsigned int exponent) {
+	Rational ret(1);
+	for (unsigned int i = 0; i < exponent; i++) ret = ret * base;
+	return ret;
+}
+
+static void write_doc(const char* path, const string &text) {
+	FILE* out = fopen(path, "w");
+	CHECK(out != 0);
+	fputs(text.c_str(), out);
+	fclose(out);
+}
+
+static Group* make_group(Generator &gen, const unsigned int* weights, unsigned int count) {
+	Group* ret = new Group(gen);
+	ret->name("group");
+	gen.add_child(ret);
+	for (unsigned int i = 0; i < count; i++) {
+		Option* option = new Option(gen);
+		option->name("option" + std::to_string(i));
+		option->text(std::to_string(i));
+		option->weight(weights[i]);
+		ret->add_child(option);
+	}
+	return ret;
+}
+
+TEST(option_shares_sum_to_one) {
+	Generator gen;
+	const unsigned int weights[] = { 1, 1, 1, 0, 5, 7 };
+	Group* group = make_group(gen, weights, 6);
+	Analysis analysis(group);
+	Rational total;
+	vector<Item*> options = group->children();
+	for (vector<Item*>::const_iterator it = options.begin(); it != options.end(); ++it) total += analysis.expected(*it);
+	CHECK(total == Rational(1));
+	CHECK(analysis.probability(options[3]).zero());
+	CHECK(analysis.probability(options[5]) == Rational(7, 15));
+	CHECK(analysis.probability(options[5]).str() == "7/15");
+}
+
+TEST(weightless_groups_fail_like_evaluate) {
+	Generator gen;
+	const unsigned int weights[] = { 0, 0 };
+	Group* group = make_group(gen, weights, 2);
+	CHECK_THROWS(group->evaluate_at(0, 0), NO_OPTIONS);
+	CHECK_THROWS(Analysis analysis(group), NO_OPTIONS);
+}
+
+// Eight levels of one in a thousand is far below what any 64-bit fixed point holds,
+// and comes out exact rather than close
+TEST(rare_options_of_nested_groups_keep_their_chance) {
+	const char* path = "core_test_nested.xml";
+	const unsigned int depth = 8;
+	string text = "<library><group id=\"deep\">";
+	for (unsigned int i = 0; i < depth; i++) text += "<option weight=\"999\">x</option><group_option weight=\"1\"><group>";
+	text += "<option id=\"rare\">y</option>";
+	for (unsigned int i = 0; i < depth; i++) text += "</group></group_option>";
+	text += "</group></library>";
+	write_doc(path, text);
+	Generator gen;
+	gen.load(path);
+	remove(path);
+
+	Analysis analysis(gen.find("deep"));
+	vector<const Option*> leaves = analysis.leaves();
+	CHECK(leaves.size() == depth + 1);
+	Rational total, rarest(1);
+	for (vector<const Option*>::const_iterator it = leaves.begin(); it != leaves.end(); ++it) {
+		total += analysis.expected(*it);
+		if (analysis.probability(*it) < rarest) rarest = analysis.probability(*it);
+	}
+	CHECK(total == Rational(1));
+	CHECK(rarest == power(Rational(1, 1000), depth));
+	CHECK(rarest.str() == "1/1" + string(3 * depth, '0'));
+	CHECK(rarest.approx() > 0.99e-24 && rarest.approx() < 1.01e-24);
+}
+
+// A shared target is one node of the DAG, reached through every reference to it
+TEST(shared_references_count_every_use) {
+	const char* path = "core_test_shared.xml";
+	write_doc(path, "<library>"
+		"<group id=\"coin\"><option id=\"heads\">h</option><option id=\"tails\" weight=\"3\">t</option></group>"
+		"<item id=\"pair\"><group_ref ref=\"coin\"/><group_ref ref=\"coin\"/></item>"
+		"<item id=\"twice\"><item_ref ref=\"pair\"/><item_ref ref=\"pair\"/></item>"
+		"<group id=\"either\"><option weight=\"1\">none</option><group_option weight=\"1\"><item_ref ref=\"pair\"/></group_option></group>"
+		"</library>");
+	Generator gen;
+	gen.load(path);
+	remove(path);
+	const Item* heads = gen.find("coin::heads");
+
+	Analysis pair(gen.find("pair"));
+	Rational tails(3, 4);
+	CHECK(pair.expected(heads) == Rational(1, 2));
+	CHECK(pair.probability(heads) == Rational(1) - tails * tails);
+
+	Analysis twice(gen.find("twice"));
+	CHECK(twice.size() == pair.size() + 3);
+	CHECK(twice.expected(heads) == Rational(1));
+	CHECK(twice.probability(heads) == Rational(1) - power(tails, 4));
+
+	Analysis either(gen.find("either"));
+	CHECK(either.probability(heads) == Rational(1, 2) * (Rational(1) - tails * tails));
+	CHECK(either.probability(gen.find("coin")) == Rational(1, 2));
+	CHECK(!either.reaches(gen.find("twice")) && either.probability(gen.find("twice")).zero());
+}
+
+TEST(rationals_stay_in_lowest_terms) {
+	CHECK(Rational(6, 8) == Rational(3, 4) && Rational(6, 8).str() == "3/4");
+	CHECK(Rational(1, 3) + Rational(1, 6) == Rational(1, 2));
+	CHECK(Rational(0, 5) == Rational() && Rational().str() == "0");
+	CHECK(Rational(1) - Rational(1, 3) > Rational(1, 3) + Rational(1, 3) - Rational(1, 1000000));
+	CHECK_THROWS(Rational(1, 3) - Rational(1, 2), GEN_OTHER_ERROR);
+	// Past 64 bits on both sides, and reduced back down
+	Rational big = power(Rational(0xFFFFFFFFFFFFFFFFull, 3), 5) * power(Rational(3, 0xFFFFFFFFFFFFFFFFull), 5);
+	CHECK(big == Rational(1) && big.str() == "1");
+	CHECK(power(Rational(1ull << 40), 3).str() == "1329227995784915872903807060280344576");
+}
\ No newline at end of file
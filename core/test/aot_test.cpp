@@ -0,0 +1,78 @@
+#include "test.h"
+
+static const char* const LIBRARY = "<library>\n"
+	"\t<group id=\"color\"><option weight=\"3\">red</option><option>blue</option>"
+	"<group_option id=\"mixed\" weight=\"2\">light <group><option>green</option><option>teal</option></group></group_option></group>\n"
+	"\t<group id=\"number\"><option weight=\"0\">none</option><option>one</option><option weight=\"2\">two</option><option>three</option>"
+	"<option weight=\"5\">four</option><option>five</option><option weight=\"7\">six</option></group>\n"
+	"\t<item id=\"npc\"><option>A </option><group_ref ref=\"color\"/><option> thing with </option><group_ref ref=\"number\"/>"
+	"<option> arms and </option><group_ref ref=\"number\"/><item_ref ref=\"tail\"/></item>\n"
+	"\t<item id=\"tail\"><option> legs</option><option></option></item>\n"
+	"\t<item id=\"crowd\"><item_ref ref=\"npc\"/><option>, </option><item_ref ref=\"npc\"/></item>\n"
+	"</library>";
+
+// The compiled tables must draw the same values from the engine in the same order,
+// so every result matches the interpreter's exactly
+TEST(compiled_tables_match_the_interpreter) {
+	const char* path = "core_test_aot.xml";
+	FILE* out = fopen(path, "w");
+	CHECK(out != 0);
+	fputs(LIBRARY, out);
+	fclose(out);
+	Generator gen(path);
+	remove(path);
+
+	AotCompiler compiler(gen);
+	const char* entries[] = { "npc", "crowd", "color", "number", "color::mixed" };
+	for (unsigned int i = 0; i < 5; i++) compiler.add_entry(entries[i]);
+	vector<aot_entry> entry_table;
+	aot_table table = compiler.table(entry_table);
+	AotRuntime runtime(table);
+	CHECK(runtime.find("missing") == AotRuntime::NO_ENTRY);
+
+	string compiled;
+	for (unsigned int i = 0; i < 5; i++) {
+		unsigned int root = runtime.find(entries[i]);
+		CHECK(root != AotRuntime::NO_ENTRY);
+		const Item* item = gen.find(entries[i]);
+		for (unsigned long long index = 0; index < 300; index++) {
+			runtime.evaluate_at(root, 11, index, compiled);
+			CHECK(compiled == item->evaluate_at(11, index));
+		}
+	}
+}
+
+TEST(the_written_unit_holds_every_table) {
+	const char* path = "core_test_aot_unit.xml";
+	FILE* out = fopen(path, "w");
+	CHECK(out != 0);
+	fputs(LIBRARY, out);
+	fclose(out);
+	Generator gen(path);
+	remove(path);
+
+	AotCompiler compiler(gen);
+	compiler.add_entry("crowd");
+	unsigned int shared = compiler.size();
+	compiler.add_entry("npc");
+	CHECK(compiler.size() == shared);
+	CHECK_THROWS(compiler.add_entry("nowhere"), ITEM_NOT_FOUND);
+
+	const char* unit = "core_test_aot_unit.cpp";
+	out = fopen(unit, "w");
+	CHECK(out != 0);
+	compiler.write(out, "library");
+	fclose(out);
+	FILE* in = fopen(unit, "r");
+	CHECK(in != 0);
+	string text;
+	char buffer[4096];
+	size_t got;
+	while ((got = fread(buffer, 1, sizeof(buffer), in)) > 0) text.append(buffer, got);
+	fclose(in);
+	remove(unit);
+	CHECK(text.find("static constexpr aot_node library_nodes[]") != string::npos);
+	CHECK(text.find("AOT_SMALL_DRAW") != string::npos && text.find("AOT_DRAW }") != string::npos);
+	CHECK(text.find("{ \"crowd\", ") != string::npos && text.find("{ \"npc\", ") != string::npos);
+	CHECK(text.find("extern const aot_table library = {") != string::npos);
+}
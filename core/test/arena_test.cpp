@@ -0,0 +1,60 @@
+#include "test.h"
+
+#include <stdint.h>
+#include <string.h>
+
+TEST(arena_allocations_are_aligned_and_counted) {
+	Arena arena;
+	CHECK(arena.used() == 0 && arena.capacity() == 0);
+	const size_t aligns[] = { 1, 2, 8, 16, 64 };
+	size_t total = 0;
+	for (unsigned int i = 0; i < 50; i++) {
+		size_t align = aligns[i % 5];
+		size_t size = 1 + i * 3;
+		char* block = (char*)arena.allocate(size, align);
+		CHECK((uintptr_t)block % align == 0);
+		memset(block, (int)i, size);
+		total += size;
+	}
+	CHECK(arena.used() >= total && arena.used() < total + 50 * 64);
+	CHECK(arena.capacity() >= arena.used());
+}
+
+// A reset arena hands the same memory out again, in the same order, without growing
+TEST(a_reset_arena_reuses_its_chunks) {
+	Arena arena;
+	vector<void*> first;
+	for (unsigned int i = 0; i < 100; i++) first.push_back(arena.allocate(4096, 16));
+	size_t capacity = arena.capacity();
+	CHECK(capacity >= 100 * 4096 && arena.used() == 100 * 4096);
+
+	for (unsigned int round = 0; round < 3; round++) {
+		arena.reset();
+		CHECK(arena.used() == 0 && arena.capacity() == capacity);
+		for (unsigned int i = 0; i < 100; i++) CHECK(arena.allocate(4096, 16) == first[i]);
+		CHECK(arena.capacity() == capacity);
+	}
+
+	// Larger than twice the last chunk: the new chunk is sized to the request
+	arena.reset();
+	char* huge = (char*)arena.allocate(8 * capacity, 8);
+	memset(huge, 0, 8 * capacity);
+	CHECK(arena.capacity() >= 9 * capacity);
+}
+
+TEST(arena_vectors_draw_from_the_arena) {
+	Arena arena;
+	arena_vector<unsigned int> numbers((ArenaAllocator<unsigned int>(arena)));
+	for (unsigned int i = 0; i < 10000; i++) numbers.push_back(i);
+	CHECK(numbers.size() == 10000 && numbers[9999] == 9999);
+	CHECK(arena.used() >= 10000 * sizeof(unsigned int));
+	size_t capacity = arena.capacity();
+
+	arena.reset();
+	arena_vector<unsigned int> again((ArenaAllocator<unsigned int>(arena)));
+	for (unsigned int i = 0; i < 10000; i++) again.push_back(i);
+	CHECK(arena.capacity() == capacity);
+	CHECK(ArenaAllocator<unsigned int>(arena) == ArenaAllocator<char>(arena));
+	Arena other;
+	CHECK(ArenaAllocator<unsigned int>(arena) != ArenaAllocator<unsigned int>(other));
+}
@@ -0,0 +1,56 @@
+#include "test.h"
+#include "attr_list.h"
+
+static xml::attribute named(const string &name, const string &value) {
+	xml::attribute ret;
+	ret.name = name;
+	ret.value = value;
+	return ret;
+}
+
+static bool sorted(const xml::attr_list &attrs) {
+	for (xml::attr_list::const_iterator it = attrs.begin(); it != attrs.end(); ++it) {
+		if (it != attrs.begin() && !((it - 1)->name < it->name)) return false;
+	}
+	return true;
+}
+
+TEST(attributes_stay_sorted_and_unique) {
+	xml::attr_list attrs;
+	CHECK(attrs.empty() && attrs.begin() == attrs.end());
+	attrs.insert(named("weight", "2"));
+	attrs.insert(named("id", "npc"));
+	attrs.insert(named("ref", "color"));
+	CHECK(attrs.size() == 3 && sorted(attrs));
+	CHECK(attrs.begin()->name == "id");
+
+	attrs.insert(named("id", "other")).value += "!";
+	CHECK(attrs.size() == 3);
+	CHECK(attrs.find("id")->value == "other!");
+	CHECK(attrs.find("missing") == 0);
+	attrs.find("weight")->value = "5";
+	const xml::attr_list &view = attrs;
+	CHECK(view.find("weight")->value == "5");
+}
+
+// The fourth attribute moves every one of them to the heap; erasing keeps the order
+TEST(wide_elements_spill_and_shrink) {
+	xml::attr_list attrs;
+	const char* names[] = { "f", "b", "e", "a", "d", "c" };
+	for (unsigned int i = 0; i < 6; i++) attrs.insert(named(names[i], string(1, (char)('0' + i))));
+	CHECK(attrs.size() == 6 && sorted(attrs));
+	for (unsigned int i = 0; i < 6; i++) CHECK(attrs.find(names[i])->value == string(1, (char)('0' + i)));
+
+	CHECK(attrs.erase("a") && attrs.erase("f") && attrs.erase("c"));
+	CHECK(!attrs.erase("a"));
+	CHECK(attrs.size() == 3 && sorted(attrs));
+	CHECK(attrs.begin()->name == "b" && (attrs.end() - 1)->name == "e");
+	CHECK(attrs.find("d")->value == "4");
+
+	attrs.clear();
+	CHECK(attrs.empty() && attrs.find("b") == 0);
+	attrs.insert(named("z", "1"));
+	attrs.insert(named("y", "2"));
+	CHECK(attrs.size() == 2 && attrs.begin()->name == "y");
+	CHECK(attrs.erase("y") && attrs.size() == 1 && attrs.begin()->name == "z");
+}
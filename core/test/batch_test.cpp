@@ -0,0 +1,94 @@
+#include "test.h"
+
+#include <limits.h>
+#include <stdio.h>
+
+static bool parse(vector<const char*> args, batch_config &config) {
+	args.insert(args.begin(), "doc.xml");
+	config = default_batch_config();
+	return parse_batch_args((int)args.size(), args.data(), config);
+}
+
+static string formatted(output_format format, unsigned long long index, const string &result) {
+	vector<char> out;
+	format_result(out, format, index, result);
+	return string(out.begin(), out.end());
+}
+
+TEST(numbers_on_the_command_line_are_whole_and_in_range) {
+	unsigned long long value = 7;
+	CHECK(parse_number("0", 10, value) && value == 0);
+	CHECK(parse_number("18446744073709551615", ULLONG_MAX, value) && value == ULLONG_MAX);
+	const char* bad[] = { "", "-1", "+1", " 1", "1 ", "1x", "0x10", "1e3", "18446744073709551616", "11" };
+	for (unsigned int i = 0; i < 10; i++) {
+		value = 7;
+		CHECK(!parse_number(bad[i], 10, value) && value == 7);
+	}
+	unsigned int small = 7;
+	CHECK(!parse_number("4294967296", ULLONG_MAX >> 32, small) && small == 7);
+}
+
+TEST(batch_flags_are_parsed_strictly) {
+	batch_config config;
+	CHECK(parse({ "--generator", "npc", "--count", "20", "--seed", "99", "--threads", "3", "--format", "tsv", "--stats" }, config));
+	CHECK(config.generator == "npc" && config.count == 20 && config.seed == 99 && config.threads == 3);
+	CHECK(config.format == FORMAT_TSV && config.stats);
+	CHECK(parse({ "--generator", "npc", "--format", "binary" }, config) && config.format == FORMAT_BINARY);
+
+	CHECK(!parse({ "--count", "20" }, config));
+	CHECK(!parse({ "--generator", "npc", "--count", "-5" }, config));
+	CHECK(!parse({ "--generator", "npc", "--count", "5k" }, config));
+	CHECK(!parse({ "--generator", "npc", "--seed", "18446744073709551616" }, config));
+	CHECK(!parse({ "--generator", "npc", "--threads", "0" }, config));
+	CHECK(!parse({ "--generator", "npc", "--threads", "1025" }, config));
+	CHECK(!parse({ "--generator", "npc", "--format", "JSONL" }, config));
+	CHECK(!parse({ "--generator", "npc", "--format" }, config));
+	CHECK(!parse({ "--generator", "npc", "--colour", "red" }, config));
+}
+
+// Text is written as is; every other format keeps one result per record whatever it holds
+TEST(results_are_escaped_for_their_format) {
+	string awkward = "say \"hi\"\tthen\\\nleave\r\x01";
+	CHECK(formatted(FORMAT_TEXT, 0, awkward) == awkward + "\n");
+	CHECK(formatted(FORMAT_JSONL, 12, awkward) == "{\"index\":12,\"result\":\"say \\\"hi\\\"\\tthen\\\\\\nleave\\r\\u0001\"}\n");
+	CHECK(formatted(FORMAT_TSV, 7, awkward) == "7\tsay \"hi\"\\tthen\\\\\\nleave\\r\x01\n");
+	CHECK(formatted(FORMAT_JSONL, 0, "") == "{\"index\":0,\"result\":\"\"}\n");
+}
+
+TEST(binary_results_carry_their_length_first) {
+	string result("a\0b\n", 4);
+	string out = formatted(FORMAT_BINARY, 5, result) + formatted(FORMAT_BINARY, 6, "");
+	CHECK(out.size() == 4 + 4 + 4);
+	unsigned int length;
+	memcpy(&length, out.data(), 4);
+	CHECK(length == 4 && out.substr(4, 4) == result);
+	memcpy(&length, out.data() + 8, 4);
+	CHECK(length == 0);
+}
+
+// More buffers than one writev() takes, so the writer has to go round again
+TEST(an_output_writer_writes_every_buffer_in_order) {
+	const char* path = "core_test_output.bin";
+	FILE* file = fopen(path, "wb+");
+	CHECK(file != 0);
+	vector<vector<char>> buffers(3000);
+	string expected;
+	for (unsigned int i = 0; i < buffers.size(); i++) {
+		format_result(buffers[i], FORMAT_BINARY, i, std::to_string(i));
+		expected.append(buffers[i].begin(), buffers[i].end());
+	}
+	OutputWriter writer(fileno(file));
+	vector<char> empty;
+	writer.add(&empty);
+	for (unsigned int i = 0; i < buffers.size(); i++) writer.add(&buffers[i]);
+	CHECK(writer.pending() == expected.size());
+	writer.flush();
+	CHECK(writer.pending() == 0);
+
+	string written(expected.size() + 1, '\0');
+	fseek(file, 0, SEEK_SET);
+	size_t got = fread(written.data(), 1, written.size(), file);
+	fclose(file);
+	remove(path);
+	CHECK(got == expected.size() && written.substr(0, got) == expected);
+}
\ No newline at end of file
@@ -0,0 +1,151 @@
+#include "test.h"
+
+static vector<char> expand(const vector<char> &packed, size_t size) {
+	vector<char> ret(size);
+	CHECK(xml::lz_decompress(packed.data(), packed.size(), ret.data(), ret.size()));
+	return ret;
+}
+
+TEST(lz_round_trips) {
+	vector<vector<char>> inputs;
+	inputs.push_back(vector<char>());
+	string small = "abc";
+	inputs.push_back(vector<char>(small.begin(), small.end()));
+	string xml;
+	for (int i = 0; i < 500; i++) xml += "<option weight=\"" + std::to_string(i % 7) + "\">item " + std::to_string(i) + "</option>\n";
+	inputs.push_back(vector<char>(xml.begin(), xml.end()));
+	random_engine rng(9, 0);
+	vector<char> noise(70000);
+	for (size_t i = 0; i < noise.size(); i++) noise[i] = (char)rng();
+	inputs.push_back(noise);
+	inputs.push_back(vector<char>(100000, 'x'));
+
+	for (vector<vector<char>>::const_iterator it = inputs.begin(); it != inputs.end(); ++it) {
+		vector<char> packed;
+		xml::lz_compress(it->data(), it->size(), packed);
+		CHECK(expand(packed, it->size()) == *it);
+	}
+	vector<char> packed;
+	xml::lz_compress(xml.data(), xml.size(), packed);
+	CHECK(packed.size() < xml.size() / 4);
+}
+
+TEST(lz_rejects_damaged_input) {
+	string text;
+	for (int i = 0; i < 200; i++) text += "<group id=\"g\"><option>x</option></group>";
+	vector<char> packed;
+	xml::lz_compress(text.data(), text.size(), packed);
+	vector<char> out(text.size());
+	CHECK(!xml::lz_decompress(packed.data(), packed.size() / 2, out.data(), out.size()));
+	CHECK(!xml::lz_decompress(packed.data(), packed.size(), out.data(), out.size() - 1));
+	vector<char> bigger(text.size() + 1);
+	CHECK(!xml::lz_decompress(packed.data(), packed.size(), bigger.data(), bigger.size()));
+}
+
+TEST(bundles_round_trip_plain_and_compressed_entries) {
+	const char* path = "core_test.bundle";
+	string repeated;
+	for (int i = 0; i < 100; i++) repeated += "<option>same</option>";
+	xml::bundle_writer writer;
+	writer.add("zeta", "last", 4, true);
+	writer.add("alpha", repeated.data(), repeated.size(), true);
+	writer.add("mid", "", 0, false);
+	CHECK(writer.write(path));
+
+	// Mapped files cannot be removed everywhere, so the bundle is closed first
+	{
+		xml::bundle source(path);
+		CHECK(source.size() == 3);
+		vector<string> names = source.names();
+		CHECK(names[0] == "alpha" && names[1] == "mid" && names[2] == "zeta");
+		CHECK(source.has("mid") && !source.has("other"));
+		size_t length;
+		const char* text = source.data("alpha", length);
+		CHECK(string(text, length) == repeated);
+		CHECK(source.data("alpha", length) == text);
+		text = source.data("zeta", length);
+		CHECK(string(text, length) == "last");
+		source.data("mid", length);
+		CHECK(length == 0);
+		bool missing = false;
+		try {
+			source.data("other", length);
+		}
+		catch (xml::bundle_errno err) {
+			missing = err == xml::BUNDLE_NO_ENTRY;
+		}
+		CHECK(missing);
+	}
+	remove(path);
+}
+
+TEST(damaged_bundles_are_refused) {
+	const char* path = "core_test_damaged.bundle";
+	xml::bundle_writer writer;
+	writer.add("doc", "<library/>", 10, false);
+	CHECK(writer.write(path));
+	FILE* file = fopen(path, "r+b");
+	CHECK(file != 0);
+	fseek(file, 16, SEEK_SET);
+	unsigned long long index_offset = ~0ULL;
+	fwrite(&index_offset, sizeof(index_offset), 1, file);
+	fclose(file);
+
+	xml::bundle_errno found = xml::BUNDLE_NO_ENTRY;
+	try {
+		xml::bundle source(path);
+	}
+	catch (xml::bundle_errno err) {
+		found = err;
+	}
+	CHECK(found == xml::BUNDLE_CORRUPT);
+	remove(path);
+	try {
+		xml::bundle source(path);
+	}
+	catch (xml::bundle_errno err) {
+		found = err;
+	}
+	CHECK(found == xml::BUNDLE_NOT_READABLE);
+}
+
+TEST(a_bundle_loads_like_its_documents) {
+	const char* path = "core_test_library.bundle";
+	string colors = "<library><group id=\"color\"><option weight=\"0\">red</option><option>blue</option></group></library>";
+	string npc = "<library><item id=\"npc\"><option>a </option><group_ref ref=\"color\"/></item></library>";
+	xml::bundle_writer writer;
+	writer.add("npc.xml", npc.data(), npc.size(), false);
+	writer.add("colors.xml", colors.data(), colors.size(), true);
+	writer.add("broken.xml", "<library>", 9, false);
+	CHECK(writer.write(path));
+
+	Scheduler pool(2);
+	{
+		xml::bundle source(path);
+		Generator one;
+		one.load(source, "colors.xml");
+		one.load(source, "npc.xml");
+		CHECK(one.documents() == 2);
+		CHECK(one.find("npc")->evaluate_at(1, 0) == "a blue");
+		CHECK_THROWS(one.load(source, "missing.xml"), FILE_NOT_READABLE);
+
+		Generator all;
+		CHECK_THROWS(all.load(source, pool), PARSE_ERROR);
+	}
+	remove(path);
+
+	xml::bundle_writer good;
+	good.add("npc.xml", npc.data(), npc.size(), true);
+	good.add("colors.xml", colors.data(), colors.size(), true);
+	CHECK(good.write(path));
+	Generator gen;
+	{
+		xml::bundle library(path);
+		gen.load(library, pool);
+	}
+	remove(path);
+	CHECK(gen.documents() == 2);
+	vector<Item*> items = gen.children();
+	CHECK(items.size() == 2 && items[0]->name() == "color" && items[1]->name() == "npc");
+	CHECK(gen.find("npc")->evaluate_at(1, 0) == "a blue");
+}
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include "test.h"
+
+static Option* make_option(Generator &gen, Group* group, const string &name, unsigned int weight) {
+	Option* ret = new Option(gen);
+	ret->name(name);
+	ret->text(name);
+	ret->weight(weight);
+	group->add_child(ret);
+	return ret;
+}
+
+static Group* make_group(Generator &gen) {
+	Group* ret = new Group(gen);
+	ret->name("color");
+	gen.add_child(ret);
+	return ret;
+}
+
+TEST(a_deck_deals_every_option_once) {
+	Generator gen;
+	Group* group = make_group(gen);
+	make_option(gen, group, "red", 1);
+	make_option(gen, group, "green", 5);
+	make_option(gen, group, "blue", 2);
+
+	Deck deck(group);
+	random_engine rng(3, 0);
+	vector<const Option*> dealt = deck.draw(rng, 10);
+	CHECK(dealt.size() == 3);
+	CHECK(dealt[0] != dealt[1] && dealt[1] != dealt[2] && dealt[0] != dealt[2]);
+	CHECK(deck.empty());
+	deck.reset();
+	CHECK(!deck.empty() && deck.drawn() == 0);
+}
+
+TEST(a_deck_sees_reweights) {
+	Generator gen;
+	Group* group = make_group(gen);
+	Option* red = make_option(gen, group, "red", 1);
+	Option* blue = make_option(gen, group, "blue", 1);
+
+	Deck deck(group);
+	random_engine rng(5, 0);
+	deck.draw(rng);
+	deck.reset();
+	red->weight(0);
+	for (unsigned int i = 0; i < 20; i++) {
+		CHECK(deck.draw(rng) == blue);
+		deck.reset();
+	}
+}
+
+TEST(reweighting_a_drawn_option_leaves_it_out_until_reset) {
+	Generator gen;
+	Group* group = make_group(gen);
+	Option* red = make_option(gen, group, "red", 1);
+	Option* blue = make_option(gen, group, "blue", 0);
+	Option* green = make_option(gen, group, "green", 0);
+
+	Deck deck(group);
+	random_engine rng(9, 0);
+	CHECK(deck.draw(rng) == red);
+	CHECK(deck.empty());
+	red->weight(2);
+	green->weight(1);
+	CHECK(!deck.has(red) && deck.has(green));
+	green->weight(0);
+	CHECK(deck.empty());
+	// Enough reweights to run past the Group's log and force a rebuild on the way
+	for (unsigned int i = 0; i < 10; i++) {
+		red->weight(5 + i);
+		green->weight(i % 2);
+	}
+	blue->weight(3);
+	CHECK(!deck.has(red) && deck.has(blue) && deck.has(green));
+	CHECK(deck.drawn() == 1);
+	blue->weight(0);
+	green->weight(0);
+	CHECK(deck.empty());
+	deck.reset();
+	CHECK(deck.has(red) && !deck.has(blue));
+	CHECK(deck.draw(rng) == red);
+}
+
+TEST(a_deck_follows_options_across_slot_swaps) {
+	Generator gen;
+	Group* group = make_group(gen);
+	Option* red = make_option(gen, group, "red", 1);
+	make_option(gen, group, "green", 1);
+	Option* blue = make_option(gen, group, "blue", 1);
+
+	Deck deck(group);
+	deck.remove(blue);
+	CHECK(!deck.has(blue));
+
+	// Blue's slot is reused: red leaves, so the last option moves into its slot
+	group->remove_child(red);
+	delete red;
+	Option* white = make_option(gen, group, "white", 1);
+	CHECK(!deck.has(blue));
+	CHECK(deck.has(white));
+	CHECK(deck.drawn() == 1);
+
+	random_engine rng(9, 0);
+	vector<const Option*> dealt = deck.draw(rng, 10);
+	CHECK(dealt.size() == 2);
+	for (vector<const Option*>::const_iterator it = dealt.begin(); it != dealt.end(); ++it) CHECK(*it != blue);
+}
+
+TEST(group_draws_leave_the_weights_alone) {
+	Generator gen;
+	Group* group = make_group(gen);
+	make_option(gen, group, "red", 1);
+	make_option(gen, group, "green", 2);
+	make_option(gen, group, "blue", 3);
+	unsigned long long version = group->version();
+
+	random_engine rng(1, 0);
+	vector<Option*> picked = group->draw(rng, 2);
+	CHECK(picked.size() == 2 && picked[0] != picked[1]);
+	CHECK(group->total_weight() == 6);
+	CHECK(group->version() == version);
+
+	const Group* dealer = group;
+	vector<const Option*> all = dealer->draw(rng, 5);
+	CHECK(all.size() == 3);
+	CHECK(group->total_weight() == 6);
+	vector<Item*> options = group->children();
+	for (unsigned int i = 0; i < 3; i++) CHECK(item_cast<Option>(options[i])->weight() == i + 1);
+}
+
+// Drawing nearly the whole table is the case the per-call overlay exists for
+TEST(a_large_draw_takes_every_weighted_option_once) {
+	Generator gen;
+	Group* group = make_group(gen);
+	for (unsigned int i = 0; i < 3000; i++) make_option(gen, group, std::to_string(i), i % 7);
+
+	random_engine rng(5, 0);
+	vector<Option*> picked = group->draw(rng, 3000);
+	CHECK(picked.size() == 3000 - 3000 / 7 - 1);
+	hashmap<const Option*, bool> seen;
+	for (vector<Option*>::const_iterator it = picked.begin(); it != picked.end(); ++it) {
+		CHECK((*it)->weight() != 0 && !seen[*it]);
+		seen[*it] = true;
+	}
+	CHECK(group->draw(rng, 10).size() == 10);
+}
+
+TEST(a_snapshot_follows_options_when_slots_move) {
+	Generator gen;
+	Group* group = make_group(gen);
+	Option* red = make_option(gen, group, "red", 1);
+	make_option(gen, group, "green", 1);
+	Option* blue = make_option(gen, group, "blue", 1);
+
+	Deck deck(group);
+	deck.remove(blue);
+	deck_state state = deck.snapshot();
+	// Removing red moves blue into red's slot
+	group->remove_child(red);
+	delete red;
+	deck.restore(state);
+	CHECK(deck.drawn() == 1);
+	CHECK(!deck.has(blue));
+	random_engine rng(5, 0);
+	CHECK(deck.draw(rng)->name() == "green");
+	CHECK(deck.empty());
+}
\ No newline at end of file
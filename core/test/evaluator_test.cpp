@@ -0,0 +1,101 @@
+#include "test.h"
+
+static Option* make_option(Generator &gen, Item* parent, const string &name, const string &text) {
+	Option* ret = new Option(gen);
+	ret->name(name);
+	ret->text(text);
+	parent->add_child(ret);
+	return ret;
+}
+
+static eval_budget unlimited() {
+	eval_budget ret;
+	ret.max_nodes = 0;
+	ret.max_bytes = 0;
+	ret.max_depth = 0;
+	return ret;
+}
+
+// A chain of `depth` plain items under the Generator, ending in one option
+static Item* make_chain(Generator &gen, unsigned int depth) {
+	Item* top = new Item(gen);
+	top->name("chain");
+	gen.add_child(top);
+	Item* curr = top;
+	for (unsigned int i = 1; i < depth; i++) {
+		Item* next = new Item(gen);
+		next->name("link");
+		curr->add_child(next);
+		curr = next;
+	}
+	make_option(gen, curr, "end", "end");
+	return top;
+}
+
+TEST(budgets_allow_exactly_their_limit) {
+	Generator gen;
+	Item* root = new Item(gen);
+	root->name("root");
+	gen.add_child(root);
+	for (unsigned int i = 0; i < 10; i++) make_option(gen, root, "o" + std::to_string(i), "ab");
+
+	Evaluator evaluator;
+	random_engine rng(1, 0);
+	eval_budget budget = unlimited();
+	CHECK(evaluator.run(root, rng, budget) == "abababababababababab");
+	CHECK(evaluator.nodes() == 11);
+
+	budget.max_nodes = 11;
+	budget.max_bytes = 20;
+	CHECK(evaluator.run(root, rng, budget).size() == 20);
+	budget.max_nodes = 10;
+	CHECK_THROWS(evaluator.run(root, rng, budget), NODE_BUDGET_EXCEEDED);
+	budget.max_nodes = 11;
+	budget.max_bytes = 19;
+	CHECK_THROWS(evaluator.run(root, rng, budget), OUTPUT_BUDGET_EXCEEDED);
+
+	// A failed run leaves nothing behind for the next one
+	budget.max_bytes = 0;
+	string out = "stale";
+	evaluator.run(root, rng, budget, out);
+	CHECK(out.size() == 20 && evaluator.nodes() == 11);
+}
+
+// Depth counts each level below the root, and each reference as a level of its own
+TEST(depth_budgets_count_nesting_and_references) {
+	Generator gen;
+	Item* chain = make_chain(gen, 50);
+	Evaluator evaluator;
+	random_engine rng(1, 0);
+	eval_budget budget = unlimited();
+	budget.max_depth = 50;
+	CHECK(evaluator.run(chain, rng, budget) == "end");
+	budget.max_depth = 49;
+	CHECK_THROWS(evaluator.run(chain, rng, budget), DEPTH_BUDGET_EXCEEDED);
+
+	ItemRef* ref = new ItemRef(gen);
+	ref->name("ref");
+	gen.add_child(ref);
+	ref->base(chain);
+	budget.max_depth = 51;
+	CHECK(evaluator.run(ref, rng, budget) == "end");
+	budget.max_depth = 50;
+	CHECK_THROWS(evaluator.run(ref, rng, budget), DEPTH_BUDGET_EXCEEDED);
+}
+
+// Nothing recurses, so nesting far deeper than a worker's stack would allow is fine
+TEST(deep_nesting_does_not_use_the_call_stack) {
+	Generator gen;
+	Item* chain = make_chain(gen, 1000);
+	Evaluator evaluator;
+	random_engine rng(1, 0);
+	CHECK(evaluator.run(chain, rng, unlimited()) == "end");
+	CHECK(evaluator.nodes() == 1001);
+
+	eval_budget budget = gen.budget();
+	budget.max_depth = 100;
+	gen.budget(budget);
+	CHECK_THROWS(chain->evaluate_at(0, 0), DEPTH_BUDGET_EXCEEDED);
+	random_engine again(0, 0);
+	CHECK_THROWS(chain->evaluate(again), DEPTH_BUDGET_EXCEEDED);
+}
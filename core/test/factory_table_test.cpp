@@ -0,0 +1,43 @@
+#include "test.h"
+
+TEST(factory_tables_find_nothing_until_frozen) {
+	xml::factory_table<int> table;
+	table.add("item", 1);
+	CHECK(!table.frozen() && table.find("item") == 0);
+	table.freeze();
+	CHECK(table.frozen() && *table.find("item") == 1);
+
+	table.add("group", 2);
+	CHECK(!table.frozen() && table.find("item") == 0);
+	table.freeze();
+	CHECK(table.size() == 2 && *table.find("item") == 1 && *table.find("group") == 2);
+}
+
+// A frozen lookup only hashes three characters, so names that share them land on
+// the same slot and the final compare has to turn the impostors away
+TEST(lookups_confirm_the_whole_name) {
+	xml::factory_table<int> table;
+	table.add("option", 1);
+	table.add("group", 2);
+	table.freeze();
+	CHECK(table.find("opxion") == 0);
+	CHECK(table.find("gxoup") == 0);
+	CHECK(table.find("optio") == 0);
+	CHECK(table.find("") == 0);
+	CHECK(*table.find("group_ref", 5) == 2);
+}
+
+// Length and the first, middle and last characters are all equal here, so no seed
+// separates them until the whole name is hashed
+TEST(names_alike_in_three_characters_fall_back_to_the_whole_name) {
+	xml::factory_table<int> table;
+	table.add("a1m2z", 1);
+	table.add("a3m4z", 2);
+	table.add("a5m6z", 3);
+	for (unsigned int i = 0; i < 200; i++) table.add("name" + std::to_string(i), 100 + i);
+	table.freeze();
+	CHECK(*table.find("a1m2z") == 1 && *table.find("a3m4z") == 2 && *table.find("a5m6z") == 3);
+	CHECK(table.find("a7m8z") == 0);
+	for (unsigned int i = 0; i < 200; i++) CHECK(*table.find("name" + std::to_string(i)) == (int)(100 + i));
+	CHECK(table.find("name200") == 0);
+}
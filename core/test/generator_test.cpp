@@ -0,0 +1,227 @@
+#include "test.h"
+
+static Option* make_option(Generator &gen, const string &name, const string &text) {
+	Option* ret = new Option(gen);
+	ret->name(name);
+	ret->text(text);
+	return ret;
+}
+
+TEST(items_get_ids_when_made) {
+	Generator gen;
+	unsigned int before = gen.item_count();
+	Group* group = new Group(gen);
+	group->name("color");
+	CHECK(gen.item_count() == before + 1);
+	CHECK(gen.has_item(group->id()));
+	CHECK(gen.item(group->id()) == group);
+	delete group;
+	CHECK(gen.item_count() == before);
+}
+
+TEST(children_are_found_by_id) {
+	Generator gen;
+	Group* group = new Group(gen);
+	group->name("color");
+	gen.add_child(group);
+	Option* red = make_option(gen, "red", "red");
+	group->add_child(red);
+
+	CHECK(gen.has_child(group->id()));
+	CHECK(gen.child(group->id()) == group);
+	CHECK(group->child(red->id()) == red);
+	vector<unsigned int> path = { group->id(), red->id() };
+	CHECK(gen.child(path) == red);
+	CHECK(!gen.has_child(red->id()));
+	CHECK_THROWS(gen.child(red->id()), CHILD_NOT_FOUND);
+}
+
+TEST(removed_items_keep_their_id_until_deleted) {
+	Generator gen;
+	Group* group = new Group(gen);
+	group->name("color");
+	gen.add_child(group);
+	Option* red = make_option(gen, "red", "red");
+	group->add_child(red);
+	unsigned int red_id = red->id();
+
+	group->remove_child(red);
+	CHECK(!group->has_child(red_id));
+	CHECK(gen.item(red_id) == red);
+	group->add_child(red);
+	CHECK(group->child(red_id) == red);
+
+	item_handle handle = gen.handle(red_id);
+	group->remove_child(red_id);
+	delete red;
+	CHECK(!gen.has_item(red_id));
+	CHECK(gen.item(handle) == 0);
+	CHECK_THROWS(gen.item(red_id), ITEM_NOT_FOUND);
+}
+
+TEST(freed_ids_are_reused_with_a_new_generation) {
+	Generator gen;
+	Option* red = make_option(gen, "red", "red");
+	unsigned int red_id = red->id();
+	item_handle handle = gen.handle(red_id);
+	delete red;
+
+	Option* blue = make_option(gen, "blue", "blue");
+	CHECK(blue->id() == red_id);
+	CHECK(gen.item(handle) == 0);
+	CHECK(gen.item(gen.handle(blue->id())) == blue);
+	gen.add_child(blue);
+	CHECK(gen.child(red_id) == blue);
+}
+
+TEST(deleting_a_subtree_frees_every_id) {
+	Generator gen;
+	unsigned int before = gen.item_count();
+	Group* group = new Group(gen);
+	group->name("color");
+	gen.add_child(group);
+	group->add_child(make_option(gen, "red", "red"));
+	group->add_child(make_option(gen, "blue", "blue"));
+	CHECK(gen.item_count() == before + 3);
+
+	gen.remove_child(group);
+	delete group;
+	CHECK(gen.item_count() == before);
+}
+
+TEST(children_keep_the_order_they_were_added_in) {
+	Generator gen;
+	Item* sentence = new Item(gen);
+	sentence->name("sentence");
+	gen.add_child(sentence);
+	const char* words[] = { "the ", "quick ", "brown ", "fox" };
+	for (unsigned int i = 0; i < 4; i++) sentence->add_child(make_option(gen, words[i], words[i]));
+	CHECK(sentence->evaluate_at(0, 0) == "the quick brown fox");
+
+	Item* quick = sentence->child("quick ");
+	sentence->remove_child(quick);
+	CHECK(sentence->evaluate_at(0, 0) == "the brown fox");
+	sentence->add_child(quick);
+	CHECK(sentence->evaluate_at(0, 0) == "the brown foxquick ");
+}
+
+TEST(removing_and_replacing_children_keeps_the_rest_in_order) {
+	Generator gen;
+	Item* list = new Item(gen);
+	gen.add_child(list);
+	for (unsigned int i = 0; i < 100; i++) list->add_child(make_option(gen, std::to_string(i), std::to_string(i) + " "));
+	// Every other child goes, enough to squeeze the holes out along the way
+	for (unsigned int i = 1; i < 100; i += 2) delete list->child(std::to_string(i));
+	Item* old_child = list->child("50");
+	Item* new_child = make_option(gen, "new", "x ");
+	list->replace_child(old_child, new_child);
+	delete old_child;
+	list->add_child(make_option(gen, "last", "end"));
+
+	string expected;
+	for (unsigned int i = 0; i < 100; i += 2) expected += i == 50 ? "x " : std::to_string(i) + " ";
+	CHECK(list->evaluate_at(0, 0) == expected + "end");
+	vector<Item*> kids = list->children();
+	CHECK(kids.size() == 51);
+	CHECK(kids[25] == new_child);
+	CHECK(list->child("50") == new_child);
+}
+
+TEST(documents_load_in_document_order) {
+	const char* path = "core_test_document.xml";
+	FILE* out = fopen(path, "w");
+	CHECK(out != 0);
+	fputs("<library>\n"
+		"\t<item id=\"npc\"><option>a </option><group_ref ref=\"color\"/><option> b</option></item>\n"
+		"\t<group id=\"color\"><option weight=\"0\">red</option><option>blue</option></group>\n"
+		"</library>", out);
+	fclose(out);
+
+	Generator gen(path);
+	remove(path);
+	CHECK(gen.documents() == 1);
+	vector<Item*> items = gen.children();
+	CHECK(items.size() == 2 && items[0]->name() == "npc" && items[1]->name() == "color");
+	for (unsigned long long i = 0; i < 20; i++) CHECK(gen.find("npc")->evaluate_at(7, i) == "a blue b");
+}
+
+// Loading measures the tree, and a seeded evaluate() is the same run evaluate_at makes
+TEST(loaded_items_are_measured_and_evaluate_like_evaluate_at) {
+	const char* path = "core_test_measured.xml";
+	FILE* out = fopen(path, "w");
+	CHECK(out != 0);
+	fputs("<library><item id=\"npc\"><option>a </option><group id=\"color\"><option>red</option><option>teal</option></group></item></library>", out);
+	fclose(out);
+
+	Generator gen;
+	gen.load(path);
+	remove(path);
+	const Item* npc = gen.find("npc");
+	CHECK(npc->bounds().min == 5 && npc->bounds().max == 6);
+	for (unsigned long long i = 0; i < 20; i++) {
+		random_engine rng(4, i);
+		CHECK(npc->evaluate(rng) == npc->evaluate_at(4, i));
+	}
+
+	eval_budget tight = gen.budget();
+	tight.max_nodes = 3;
+	gen.budget(tight);
+	random_engine rng(4, 0);
+	CHECK_THROWS(npc->evaluate(rng), NODE_BUDGET_EXCEEDED);
+}
+
+// Segments are matched in place, so only whole names may match, and a reference on
+// the way leads on into its base
+TEST(paths_are_found_segment_by_segment) {
+	const char* path = "core_test_paths.xml";
+	FILE* out = fopen(path, "w");
+	CHECK(out != 0);
+	fputs("<library>\n"
+		"\t<group id=\"color\"><option id=\"red\">red</option><option id=\"a_rather_long_shade_of_blue\">blue</option></group>\n"
+		"\t<item id=\"palette\"><group_ref id=\"shade\" ref=\"color\"/></item>\n"
+		"</library>", out);
+	fclose(out);
+
+	Generator gen(path);
+	remove(path);
+	const Item* blue = gen.find("color::a_rather_long_shade_of_blue");
+	CHECK(blue->evaluate_at(0, 0) == "blue");
+	CHECK(gen.find("palette::shade::a_rather_long_shade_of_blue") == blue);
+	CHECK(gen.find("::palette::::shade::red") == gen.find("color::red"));
+	CHECK(gen.find("") == &gen && gen.find("::") == &gen);
+	CHECK_THROWS(gen.find("pal"), ITEM_NOT_FOUND);
+	CHECK_THROWS(gen.find("palette::shad"), ITEM_NOT_FOUND);
+	CHECK_THROWS(gen.find("palette::shade::red::more"), ITEM_NOT_FOUND);
+	CHECK_THROWS(gen.find("color:red"), ITEM_NOT_FOUND);
+}
+
+
+TEST(documents_parse_in_parallel_and_load_in_order) {
+	const char* paths[] = { "core_test_first.xml", "core_test_second.xml" };
+	const char* texts[] = {
+		"<library><item id=\"npc\"><option>a </option><group_ref ref=\"color\"/></item></library>",
+		"<library><group id=\"color\"><option weight=\"0\">red</option><option>blue</option></group></library>"
+	};
+	vector<string> files;
+	for (int i = 0; i < 2; i++) {
+		FILE* out = fopen(paths[i], "w");
+		CHECK(out != 0);
+		fputs(texts[i], out);
+		fclose(out);
+		files.push_back(paths[i]);
+	}
+
+	Generator gen;
+	Scheduler pool(2);
+	gen.load(files, pool);
+	CHECK(gen.documents() == 2);
+	vector<Item*> items = gen.children();
+	CHECK(items.size() == 2 && items[0]->name() == "npc" && items[1]->name() == "color");
+	CHECK(gen.find("npc")->evaluate_at(3, 0) == "a blue");
+
+	files.push_back("core_test_missing.xml");
+	Generator broken;
+	CHECK_THROWS(broken.load(files, pool), FILE_NOT_READABLE);
+	CHECK(broken.documents() == 0);
+	for (int i = 0; i < 2; i++) remove(paths[i]);
+}
\ No newline at end of file
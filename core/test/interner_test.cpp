@@ -0,0 +1,237 @@
+#include "test.h"
+
+static Group* make_colors(Generator &gen, const string &name) {
+	Group* ret = new Group(gen);
+	ret->name(name);
+	gen.add_child(ret);
+	const char* colors[] = { "red", "green", "blue" };
+	for (unsigned int i = 0; i < 3; i++) {
+		Option* option = new Option(gen);
+		option->name(colors[i]);
+		option->text(colors[i]);
+		ret->add_child(option);
+	}
+	return ret;
+}
+
+TEST(identical_subtrees_collapse_onto_one) {
+	Generator gen;
+	Group* first = make_colors(gen, "first");
+	make_colors(gen, "second");
+	string before = gen.find("second")->evaluate_at(4, 2);
+	unsigned int items = gen.item_count();
+
+	Interner interner;
+	CHECK(interner.intern(gen) == 1);
+	const GroupRef* second = item_cast<GroupRef>(gen.find("second"));
+	CHECK(second != 0 && second->base() == first);
+	CHECK(gen.find("second")->evaluate_at(4, 2) == before);
+	// The copy and its three options are gone, and one reference stands in
+	CHECK(gen.item_count() == items - 4 + 1);
+}
+
+TEST(references_anywhere_move_to_the_kept_copy) {
+	Generator gen;
+	Group* first = make_colors(gen, "first");
+	Group* second = make_colors(gen, "second");
+	Item* holder = new Item(gen);
+	holder->name("holder");
+	gen.add_child(holder);
+	ItemRef* attached = new ItemRef(second->child("green"));
+	attached->name("green");
+	holder->add_child(attached);
+	ItemRef* detached = new ItemRef(second);
+	unsigned int second_id = second->id();
+
+	Interner interner;
+	interner.intern(gen);
+	CHECK(attached->base() == first->child("green"));
+	CHECK(detached->base() == first);
+	CHECK(!gen.has_item(second_id));
+	delete detached;
+}
+
+TEST(replaced_copies_keep_their_place) {
+	Generator gen;
+	Item* sentence = new Item(gen);
+	sentence->name("sentence");
+	gen.add_child(sentence);
+	const char* words[] = { "a ", "b ", "a ", "c" };
+	for (unsigned int i = 0; i < 4; i++) {
+		Option* word = new Option(gen);
+		word->name("word" + std::to_string(i));
+		word->text(words[i]);
+		sentence->add_child(word);
+	}
+	Group* first = make_colors(gen, "first");
+	make_colors(gen, "second");
+	Group* mixed = new Group(gen);
+	mixed->name("mixed");
+	gen.add_child(mixed);
+	const char* colors[] = { "red", "green", "blue" };
+	for (unsigned int i = 0; i < 3; i++) {
+		Option* option = new Option(gen);
+		option->name(std::to_string(i));
+		option->text(colors[i]);
+		mixed->add_child(option);
+	}
+	vector<string> before;
+	for (unsigned long long i = 0; i < 16; i++) before.push_back(mixed->evaluate_at(1, i));
+
+	Interner interner;
+	interner.intern(gen);
+	CHECK(sentence->evaluate_at(0, 0) == "a b a c");
+	CHECK(item_cast<OptionRef>(sentence->child("word2")) != 0);
+	CHECK(sentence->children()[2]->name() == "word2");
+	// Options matching the ones in "first" became references in their own slots
+	CHECK(item_cast<OptionRef>(mixed->child("0"))->base() == first->child("red"));
+	for (unsigned long long i = 0; i < 16; i++) CHECK(mixed->evaluate_at(1, i) == before[i]);
+}
+
+static Item* make_word(Generator &gen, const string &name, const string &text) {
+	Item* ret = new Item(gen);
+	ret->name(name);
+	Option* word = new Option(gen);
+	word->name("word");
+	word->text(text);
+	ret->add_child(word);
+	return ret;
+}
+
+// Without options a Group reads out every child in order, so a copy swapped for a
+// reference has to stay where it was
+TEST(a_group_without_options_keeps_its_children_in_order) {
+	Generator gen;
+	gen.add_child(make_word(gen, "earlier", "X"));
+	Group* group = new Group(gen);
+	group->name("group");
+	gen.add_child(group);
+	group->add_child(make_word(gen, "b", "X"));
+	group->add_child(make_word(gen, "c", "Y"));
+	CHECK(group->evaluate_at(1, 0) == "XY");
+
+	Interner interner;
+	interner.intern(gen);
+	CHECK(item_cast<ItemRef>(group->child("b")) != 0);
+	CHECK(group->children()[0]->name() == "b" && group->options().empty());
+	CHECK(group->evaluate_at(1, 0) == "XY");
+}
+
+
+static Item* make_sequence(Generator &gen, const string &name, const vector<std::pair<string, string>> &words) {
+	Item* ret = new Item(gen);
+	ret->name(name);
+	gen.add_child(ret);
+	for (vector<std::pair<string, string>>::const_iterator it = words.begin(); it != words.end(); ++it) {
+		Option* word = new Option(gen);
+		word->name(it->first);
+		word->text(it->second);
+		ret->add_child(word);
+	}
+	return ret;
+}
+
+TEST(children_in_another_order_are_not_the_same_subtree) {
+	Generator gen;
+	Item* forward = make_sequence(gen, "forward", { { "one", "1" }, { "two", "2" } });
+	Item* backward = make_sequence(gen, "backward", { { "two", "2" }, { "one", "1" } });
+	Interner interner;
+	interner.intern(gen);
+	CHECK(item_cast<ItemRef>(gen.find("backward")) == 0);
+	CHECK(forward->evaluate_at(0, 0) == "12");
+	CHECK(backward->evaluate_at(0, 0) == "21");
+}
+
+TEST(options_in_another_slot_order_are_not_the_same_group) {
+	Generator gen;
+	Group* first = make_colors(gen, "first");
+	Group* second = new Group(gen);
+	second->name("second");
+	gen.add_child(second);
+	const char* colors[] = { "blue", "green", "red" };
+	for (unsigned int i = 0; i < 3; i++) {
+		Option* option = new Option(gen);
+		option->name(colors[i]);
+		option->text(colors[i]);
+		second->add_child(option);
+	}
+	vector<string> before;
+	for (unsigned long long i = 0; i < 16; i++) before.push_back(second->evaluate_at(9, i));
+
+	Interner interner;
+	interner.intern(gen);
+	CHECK(item_cast<GroupRef>(gen.find("second")) == 0);
+	CHECK(first->evaluate_at(9, 0) != "" && second->options().size() == 3);
+	for (unsigned long long i = 0; i < 16; i++) CHECK(gen.find("second")->evaluate_at(9, i) == before[i]);
+}
+
+TEST(merged_items_refuse_changes) {
+	Generator gen;
+	Group* first = make_colors(gen, "first");
+	make_colors(gen, "second");
+	Group* alone = make_colors(gen, "alone");
+	item_cast<Option>(alone->child("green"))->weight(2);
+	Interner interner;
+	interner.intern(gen);
+
+	Option* red = item_cast<Option>(first->child("red"));
+	CHECK(first->shared() && red->shared());
+	CHECK_THROWS(red->weight(5), ITEM_SHARED);
+	CHECK_THROWS(red->text("pink"), ITEM_SHARED);
+	CHECK_THROWS(item_cast<Option>(gen.find("second")->child("green"))->weight(5), ITEM_SHARED);
+	CHECK_THROWS(first->remove_child(red), ITEM_SHARED);
+	CHECK_THROWS(red->name("scarlet"), ITEM_SHARED);
+	CHECK(first->evaluate_at(3, 0) == gen.find("second")->evaluate_at(3, 0));
+
+	// Nothing was merged into these, so they stay editable
+	Option* green = item_cast<Option>(alone->child("green"));
+	CHECK(!alone->shared() && !green->shared());
+	green->weight(5);
+	CHECK(green->weight() == 5);
+}
+
+static void write_duplicates(const char* path) {
+	FILE* out = fopen(path, "w");
+	CHECK(out != 0);
+	fputs("<library>\n"
+		"\t<group id=\"first\"><option>red</option><option>blue</option></group>\n"
+		"\t<group id=\"second\"><option>red</option><option>blue</option></group>\n"
+		"</library>", out);
+	fclose(out);
+}
+
+TEST(a_loaded_duplicate_stays_editable_until_interned) {
+	const char* path = "core_test_duplicates.xml";
+	write_duplicates(path);
+	Generator gen(path);
+	remove(path);
+	Group* second = item_cast<Group>(gen.find("second"));
+	CHECK(second != 0 && item_cast<GroupRef>(second) == 0 && !second->shared());
+
+	Option* red = second->options()[0];
+	Option* blue = second->options()[1];
+	blue->weight(3);
+	second->add_child(new Option(gen));
+	second->remove_child(red);
+	delete red;
+	CHECK(second->total_weight() == 4);
+	CHECK(item_cast<Group>(gen.find("first"))->total_weight() == 2);
+
+	// Edited, "second" no longer matches "first" and keeps its own instance
+	CHECK(gen.intern() == 0);
+	CHECK(!gen.find("first")->shared());
+	blue->weight(4);
+	CHECK(second->total_weight() == 5);
+}
+
+TEST(interning_a_loaded_document_shares_its_duplicates) {
+	const char* path = "core_test_interned.xml";
+	write_duplicates(path);
+	Generator gen(path);
+	remove(path);
+	CHECK(gen.intern() == 1);
+	const GroupRef* second = item_cast<GroupRef>(gen.find("second"));
+	CHECK(second != 0 && second->base() == gen.find("first"));
+	CHECK(gen.find("first")->shared());
+	CHECK_THROWS(item_cast<Group>(gen.find("first"))->options()[0]->weight(5), ITEM_SHARED);
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "test.h"
+
+#include <thread>
+
+static Group* make_group(Generator &gen, Item* parent, const string &name) {
+	Group* ret = new Group(gen);
+	ret->name(name);
+	parent->add_child(ret);
+	return ret;
+}
+
+static Option* make_option(Generator &gen, Item* parent, const string &name) {
+	Option* ret = new Option(gen);
+	ret->name(name);
+	ret->text(name);
+	parent->add_child(ret);
+	return ret;
+}
+
+TEST(paths_resolve_to_their_target) {
+	Generator gen;
+	Group* color = make_group(gen, &gen, "color");
+	Option* red = make_option(gen, color, "red");
+	ItemPath path = gen.compile(&gen, { color->id(), red->id() });
+	CHECK(gen.resolve(path) == red);
+	CHECK(gen.resolve(path) == red);
+}
+
+TEST(edits_elsewhere_leave_a_path_cached) {
+	Generator gen;
+	Group* color = make_group(gen, &gen, "color");
+	Option* red = make_option(gen, color, "red");
+	Group* size = make_group(gen, &gen, "size");
+	ItemPath path = gen.compile(color, { red->id() });
+
+	unsigned long long before = color->epoch();
+	make_option(gen, size, "large");
+	CHECK(color->epoch() == before);
+	CHECK(gen.resolve(path) == red);
+}
+
+TEST(edits_below_the_root_are_seen) {
+	Generator gen;
+	Group* color = make_group(gen, &gen, "color");
+	Group* warm = make_group(gen, color, "warm");
+	Option* red = make_option(gen, warm, "red");
+	ItemPath path = gen.compile(&gen, { color->id(), warm->id(), red->id() });
+
+	unsigned long long before = gen.epoch();
+	make_option(gen, warm, "orange");
+	CHECK(gen.epoch() != before);
+	CHECK(gen.resolve(path) == red);
+
+	warm->remove_child(red);
+	delete red;
+	CHECK_THROWS(gen.resolve(path), CHILD_NOT_FOUND);
+}
+
+TEST(a_child_cannot_displace_a_sibling) {
+	Generator gen;
+	Group* color = make_group(gen, &gen, "color");
+	Option* red = make_option(gen, color, "red");
+	Option* other = new Option(gen);
+	other->name("red");
+	CHECK_THROWS(color->add_child(other), NAME_COLLISION);
+	CHECK(color->child("red") == red);
+	CHECK(!other->has_parent());
+	CHECK(item_cast<Group>(color)->options().size() == 1);
+	delete other;
+
+	Option* blue = make_option(gen, color, "blue");
+	CHECK_THROWS(blue->name("red"), NAME_COLLISION);
+	CHECK(color->child("blue") == blue);
+}
+
+TEST(threads_may_resolve_one_path_together) {
+	Generator gen;
+	Group* color = make_group(gen, &gen, "color");
+	Option* red = make_option(gen, color, "red");
+	ItemPath path = gen.compile(&gen, { color->id(), red->id() });
+	make_option(gen, color, "blue");
+
+	bool wrong[4] = { false, false, false, false };
+	vector<std::thread> threads;
+	for (unsigned int i = 0; i < 4; i++) {
+		threads.push_back(std::thread([&gen, &path, red, &wrong, i] {
+			for (unsigned int j = 0; j < 1000; j++) {
+				if (gen.resolve(path) != red) wrong[i] = true;
+			}
+		}));
+	}
+	for (vector<std::thread>::iterator it = threads.begin(); it != threads.end(); ++it) it->join();
+	for (unsigned int i = 0; i < 4; i++) CHECK(!wrong[i]);
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#include "test.h"
+
+vector<std::pair<const char*, test_function>>& all_tests() {
+	static vector<std::pair<const char*, test_function>> tests;
+	return tests;
+}
+
+int main() {
+	unsigned int failed = 0;
+	vector<std::pair<const char*, test_function>> &tests = all_tests();
+	for (vector<std::pair<const char*, test_function>>::const_iterator it = tests.begin(); it != tests.end(); ++it) {
+		try {
+			it->second();
+		}
+		catch (const test_failure &failure) {
+			printf("FAIL %s: %s:%d: %s\n", it->first, failure.file, failure.line, failure.expression);
+			failed++;
+			continue;
+		}
+		catch (gen_errno err) {
+			printf("FAIL %s: uncaught gen_errno %d\n", it->first, err);
+			failed++;
+			continue;
+		}
+	}
+	printf("%u of %u tests passed\n", (unsigned int)tests.size() - failed, (unsigned int)tests.size());
+	return failed == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+// Buckets cover every value once, in order, each within 1/32 of its smallest value
+TEST(histogram_buckets_tile_the_range) {
+	for (unsigned long long v = 0; v < 32; v++) CHECK(Histogram::bucket(v) == v && Histogram::bucket_low((unsigned int)v) == v);
+	for (unsigned int b = 0; b + 1 < HISTOGRAM_BUCKETS; b++) {
+		unsigned long long low = Histogram::bucket_low(b), high = Histogram::bucket_high(b);
+		CHECK(low <= high && Histogram::bucket_low(b + 1) == high + 1);
+		CHECK(Histogram::bucket(low) == b && Histogram::bucket(high) == b);
+		CHECK((high - low + 1) * 32 <= (low < 32 ? 32 : low));
+	}
+	const unsigned long long largest = (1ULL << (HISTOGRAM_MAX_MAGNITUDE + 1)) - 1;
+	CHECK(Histogram::bucket(largest) == HISTOGRAM_BUCKETS - 1);
+	CHECK(Histogram::bucket(largest + 1) == HISTOGRAM_BUCKETS - 1);
+	CHECK(Histogram::bucket(~0ULL) == HISTOGRAM_BUCKETS - 1);
+	CHECK(Histogram::bucket_high(HISTOGRAM_BUCKETS - 1) >= largest);
+}
+
+static bool within(unsigned long long value, double expected, double error) {
+	return value >= expected * (1 - error) && value <= expected * (1 + error);
+}
+
+TEST(histogram_quantiles_are_within_a_bucket) {
+	Histogram empty;
+	vector<double> wanted = { 0, 0.5, 0.9, 0.99, 1 };
+	vector<unsigned long long> none = empty.quantiles(wanted);
+	CHECK(none.size() == 5 && none[0] == 0 && none[4] == 0);
+
+	Histogram one;
+	one.record(7);
+	vector<unsigned long long> seven = one.quantiles(wanted);
+	for (unsigned int i = 0; i < 5; i++) CHECK(seven[i] == 7);
+
+	// Four threads record into their own shards; the totals and quantiles see all of them
+	Histogram latency;
+	vector<std::thread> threads;
+	for (unsigned int t = 0; t < 4; t++) {
+		threads.push_back(std::thread([&latency, t] {
+			for (unsigned long long v = 1 + t; v <= 100000; v += 4) latency.record(v);
+		}));
+	}
+	for (vector<std::thread>::iterator it = threads.begin(); it != threads.end(); ++it) it->join();
+	CHECK(latency.count() == 100000);
+	CHECK(latency.sum() == 100000ULL * 100001 / 2);
+	vector<unsigned long long> values = latency.quantiles(wanted);
+	CHECK(values[0] <= 1);
+	CHECK(within(values[1], 50000, 0.03));
+	CHECK(within(values[2], 90000, 0.03));
+	CHECK(within(values[3], 99000, 0.03));
+	CHECK(within(values[4], 100000, 0.03));
+}
+
+static double sample(const string &text, const string &series) {
+	string::size_type at = text.find("\n" + series + " ");
+	CHECK(at != string::npos);
+	return strtod(text.c_str() + at + series.size() + 2, 0);
+}
+
+TEST(metrics_are_written_in_the_prometheus_format) {
+	Metrics metrics;
+	metrics.counter("requests_total", "Requests answered.", "status=\"ok\"").add(3);
+	metrics.counter("requests_total", "Requests answered.", "status=\"bad\"").add();
+	metrics.gauge("documents", "Documents loaded.").set(-2);
+	Histogram &latency = metrics.histogram("latency_seconds", "Time per request.", 1e-9);
+	for (unsigned int i = 0; i < 10; i++) latency.record(1000);
+	CHECK_THROWS(metrics.gauge("requests_total", "Requests answered."), GEN_OTHER_ERROR);
+
+	string text;
+	metrics.write(text);
+	CHECK(text.find("# HELP requests_total Requests answered.\n# TYPE requests_total counter\n"
+		"requests_total{status=\"ok\"} 3\nrequests_total{status=\"bad\"} 1\n") == 0);
+	CHECK(text.find("# HELP documents Documents loaded.\n# TYPE documents gauge\ndocuments -2\n") != string::npos);
+	CHECK(text.find("# TYPE latency_seconds summary\n") != string::npos);
+	const char* quantiles[] = { "0.5", "0.9", "0.99", "0.999" };
+	for (unsigned int q = 0; q < 4; q++) {
+		double value = sample(text, string("latency_seconds{quantile=\"") + quantiles[q] + "\"}");
+		CHECK(value >= Histogram::bucket_low(Histogram::bucket(1000)) * 1e-9 && value <= Histogram::bucket_high(Histogram::bucket(1000)) * 1e-9);
+	}
+	CHECK(sample(text, "latency_seconds_sum") > 0.99e-5 && sample(text, "latency_seconds_sum") < 1.01e-5);
+	CHECK(sample(text, "latency_seconds_count") == 10);
+	CHECK(text[text.size() - 1] == '\n');
+
+	const char* path = "core_test_metrics.prom";
+	CHECK(metrics.write_file(path));
+	FILE* in = fopen(path, "rb");
+	CHECK(in != 0);
+	string read;
+	char buffer[4096];
+	size_t got;
+	while ((got = fread(buffer, 1, sizeof(buffer), in)) > 0) read.append(buffer, got);
+	fclose(in);
+	remove(path);
+	CHECK(read == text);
+}
@@ -0,0 +1,163 @@
+#include "test.h"
+
+#include <stdio.h>
+#include <thread>
+
+TEST(spsc_rings_hold_their_capacity_in_order) {
+	SpscRing<unsigned int> ring(5);
+	unsigned int value = 0;
+	CHECK(!ring.pop(value));
+	for (unsigned int i = 0; i < 8; i++) {
+		value = i;
+		CHECK(ring.push(value));
+	}
+	value = 8;
+	CHECK(!ring.push(value) && value == 8);
+	for (unsigned int i = 0; i < 8; i++) CHECK(ring.pop(value) && value == i);
+	CHECK(!ring.pop(value));
+	ring.close();
+	CHECK(ring.closed());
+}
+
+TEST(spsc_rings_hand_over_in_order_across_threads) {
+	const unsigned int count = 200000;
+	SpscRing<unsigned int> ring(64);
+	std::thread producer([&ring, count] {
+		for (unsigned int i = 0; i < count; i++) {
+			unsigned int value = i;
+			while (!ring.push(value)) std::this_thread::yield();
+		}
+		ring.close();
+	});
+	unsigned int expected = 0;
+	bool ordered = true;
+	// Closed is read before the pop, so an empty ring after that means nothing is left
+	while (true) {
+		bool closed = ring.closed();
+		unsigned int value;
+		if (ring.pop(value)) {
+			ordered = ordered && value == expected;
+			expected++;
+			continue;
+		}
+		if (closed) break;
+		std::this_thread::yield();
+	}
+	producer.join();
+	CHECK(ordered && expected == count);
+}
+
+// Every producer's values arrive in the order that producer pushed them
+TEST(mpsc_rings_keep_each_producers_order) {
+	const unsigned int producers = 4, count = 50000;
+	MpscRing<std::pair<unsigned int, unsigned int>> ring(32);
+	std::pair<unsigned int, unsigned int> value(0, 0);
+	CHECK(!ring.pop(value));
+
+	vector<std::thread> threads;
+	for (unsigned int p = 0; p < producers; p++) {
+		threads.push_back(std::thread([&ring, p, count] {
+			for (unsigned int i = 0; i < count; i++) {
+				std::pair<unsigned int, unsigned int> item(p, i);
+				while (!ring.push(item)) std::this_thread::yield();
+			}
+		}));
+	}
+	vector<unsigned int> next(producers, 0);
+	bool ordered = true;
+	for (unsigned int taken = 0; taken < producers * count;) {
+		if (!ring.pop(value)) {
+			std::this_thread::yield();
+			continue;
+		}
+		ordered = ordered && value.first < producers && value.second == next[value.first];
+		next[value.first]++;
+		taken++;
+	}
+	for (vector<std::thread>::iterator it = threads.begin(); it != threads.end(); ++it) it->join();
+	CHECK(ordered && !ring.pop(value));
+
+	MpscRing<unsigned int> small(2);
+	unsigned int one = 1, two = 2, three = 3;
+	CHECK(small.push(one) && small.push(two) && !small.push(three));
+	CHECK(small.pop(one) && one == 1 && small.push(three));
+}
+
+static string read_all(FILE* file) {
+	string ret;
+	char buffer[65536];
+	size_t got;
+	rewind(file);
+	while ((got = fread(buffer, 1, sizeof(buffer), file)) > 0) ret.append(buffer, got);
+	return ret;
+}
+
+// Chunks are generated and formatted out of order on several threads, so the output
+// only comes out right if the writer puts them back in order
+TEST(the_pipeline_writes_results_in_order_in_every_format) {
+	Generator gen;
+	Group* color = new Group(gen);
+	color->name("color");
+	gen.add_child(color);
+	const char* names[] = { "red", "green", "tab\there", "quote \"q\"", "line\nbreak" };
+	for (unsigned int i = 0; i < 5; i++) {
+		Option* option = new Option(gen);
+		option->name("o" + std::to_string(i));
+		option->text(names[i]);
+		color->add_child(option);
+	}
+
+	const output_format formats[] = { FORMAT_TEXT, FORMAT_JSONL, FORMAT_TSV, FORMAT_BINARY };
+	for (unsigned int f = 0; f < 4; f++) {
+		batch_config config = default_batch_config();
+		config.generator = "color";
+		config.count = 5 * PIPELINE_CHUNK_SIZE + 17;
+		config.seed = 13;
+		config.threads = 3;
+		config.formatters = 2;
+		config.format = formats[f];
+
+		vector<char> expected;
+		for (unsigned long long i = 0; i < config.count; i++) format_result(expected, config.format, i, color->evaluate_at(config.seed, i));
+
+		FILE* out = tmpfile();
+		CHECK(out != 0);
+		Pipeline job(gen, config);
+		job.run(fileno(out));
+		string written = read_all(out);
+		fclose(out);
+		CHECK(written == string(expected.begin(), expected.end()));
+
+		const vector<stage_stats> &stats = job.stats();
+		CHECK(stats.size() == 3);
+		for (unsigned int s = 0; s < 3; s++) CHECK(stats[s].items == config.count);
+		CHECK(stats[2].bytes == expected.size());
+	}
+}
+
+
+// An error on a stage thread stops every stage and comes out of run() as it was thrown
+TEST(a_failing_stage_stops_the_pipeline_and_is_rethrown) {
+	Generator gen;
+	Group* color = new Group(gen);
+	color->name("color");
+	gen.add_child(color);
+	Option* option = new Option(gen);
+	option->name("long");
+	option->text("far too long for the budget");
+	color->add_child(option);
+	eval_budget budget = gen.budget();
+	budget.max_bytes = 4;
+	gen.budget(budget);
+
+	batch_config config = default_batch_config();
+	config.generator = "color";
+	config.count = 3 * PIPELINE_CHUNK_SIZE;
+	config.threads = 2;
+	config.formatters = 1;
+	FILE* out = tmpfile();
+	CHECK(out != 0);
+	Pipeline job(gen, config);
+	CHECK_THROWS(job.run(fileno(out)), OUTPUT_BUDGET_EXCEEDED);
+	fclose(out);
+}
\ No newline at end of file
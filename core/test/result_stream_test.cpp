@@ -0,0 +1,63 @@
+#include "test.h"
+
+static Group* make_color(Generator &gen) {
+	Group* ret = new Group(gen);
+	ret->name("color");
+	gen.add_child(ret);
+	const char* names[] = { "red", "green", "blue", "a rather long shade of teal" };
+	for (unsigned int i = 0; i < 4; i++) {
+		Option* option = new Option(gen);
+		option->name(names[i]);
+		option->text(names[i]);
+		option->weight(i + 1);
+		ret->add_child(option);
+	}
+	return ret;
+}
+
+TEST(a_stream_yields_what_evaluate_at_does) {
+	Generator gen;
+	Group* color = make_color(gen);
+	unsigned long long index = 0;
+	const string* buffer = 0;
+	ResultStream stream = color->stream(42);
+	for (ResultStream::iterator it = stream.begin(); index < 200; ++it, index++) {
+		CHECK(*it == color->evaluate_at(42, index));
+		if (buffer == 0) buffer = &*it;
+		CHECK(&*it == buffer && it->size() == buffer->size());
+	}
+
+	index = 1000;
+	for (const string &result : color->stream(42, 1000)) {
+		CHECK(result == color->evaluate_at(42, index));
+		if (++index == 1100) break;
+	}
+}
+
+// Nothing runs until the first result is asked for, and a failure ends the stream
+TEST(a_stream_is_lazy_and_rethrows_failures) {
+	Generator gen;
+	Group* color = make_color(gen);
+	eval_budget nothing = gen.budget();
+	nothing.max_bytes = 1;
+	gen.budget(nothing);
+	ResultStream stream = color->stream(7);
+	gen.budget(default_eval_budget());
+	ResultStream::iterator it = stream.begin();
+	CHECK(*it == color->evaluate_at(7, 0));
+
+	eval_budget budget = gen.budget();
+	budget.max_bytes = 4;
+	gen.budget(budget);
+	unsigned long long index = 1;
+	bool failed = false;
+	try {
+		for (; index < 1000; index++) ++it;
+	}
+	catch (gen_errno err) {
+		failed = err == OUTPUT_BUDGET_EXCEEDED;
+	}
+	CHECK(failed);
+	CHECK_THROWS(color->evaluate_at(7, index), OUTPUT_BUDGET_EXCEEDED);
+	CHECK(it == std::default_sentinel);
+}
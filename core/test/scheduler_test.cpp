@@ -0,0 +1,101 @@
+#include "test.h"
+
+#include <chrono>
+#include <thread>
+
+// All the work starts in one worker's own deque, which only that worker pops from
+// the back; anything run on another thread must have been stolen from the front
+TEST(idle_workers_steal_from_a_loaded_one) {
+	const unsigned int count = 64;
+	Scheduler pool(4);
+	std::atomic<unsigned int> ran{ 0 };
+	std::atomic<unsigned int> stolen{ 0 };
+	TaskGroup outer;
+	pool.spawn(outer, [&pool, &ran, &stolen, count] {
+		std::thread::id owner = std::this_thread::get_id();
+		TaskGroup inner;
+		for (unsigned int i = 0; i < count; i++) {
+			pool.spawn(inner, [&ran, &stolen, owner] {
+				if (std::this_thread::get_id() != owner) stolen++;
+				ran++;
+			});
+		}
+		// Stay busy so the owner cannot drain its own deque before anyone looks
+		std::chrono::steady_clock::time_point give_up = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (stolen == 0 && std::chrono::steady_clock::now() < give_up) std::this_thread::yield();
+		pool.wait(inner);
+	});
+	pool.wait(outer);
+	CHECK(ran == count);
+	CHECK(stolen > 0);
+}
+
+static unsigned long long nested_sum(Scheduler &pool, unsigned long long first, unsigned long long last) {
+	if (last - first <= 4) {
+		unsigned long long sum = 0;
+		for (unsigned long long i = first; i < last; i++) sum += i;
+		return sum;
+	}
+	unsigned long long mid = first + (last - first) / 2;
+	unsigned long long low = 0, high = 0;
+	TaskGroup group;
+	pool.spawn(group, [&pool, &low, first, mid] { low = nested_sum(pool, first, mid); });
+	pool.spawn(group, [&pool, &high, mid, last] { high = nested_sum(pool, mid, last); });
+	pool.wait(group);
+	return low + high;
+}
+
+// A single worker waiting inside a task has to run the subtasks itself
+TEST(tasks_can_wait_on_their_own_subtasks) {
+	for (unsigned int threads = 1; threads <= 3; threads++) {
+		Scheduler pool(threads);
+		unsigned long long sum = 0;
+		TaskGroup group;
+		pool.spawn(group, [&pool, &sum] { sum = nested_sum(pool, 0, 1000); });
+		pool.wait(group);
+		CHECK(sum == 999 * 1000 / 2);
+	}
+}
+
+TEST(wait_rethrows_the_first_error_once_every_task_is_done) {
+	Scheduler pool(3);
+	std::atomic<unsigned int> ran{ 0 };
+	TaskGroup group;
+	for (unsigned int i = 0; i < 20; i++) {
+		pool.spawn(group, [&ran, i] {
+			if (i == 7) throw(ITEM_NOT_FOUND);
+			ran++;
+		});
+	}
+	CHECK_THROWS(pool.wait(group), ITEM_NOT_FOUND);
+	CHECK(group.finished() && ran == 19);
+	// The error is handed out once, so the group can be used again
+	pool.spawn(group, [&ran] { ran++; });
+	pool.wait(group);
+	CHECK(ran == 20);
+
+	CHECK_THROWS(pool.parallel_for(0, 1000, 10, [](unsigned long long first, unsigned long long last) {
+		if (first <= 500 && 500 < last) throw(CHILD_NOT_FOUND);
+	}), CHILD_NOT_FOUND);
+}
+
+TEST(parallel_for_covers_the_range_exactly_once) {
+	const unsigned long long first = 13, last = 10013;
+	Scheduler pool(4);
+	unsigned long long grains[] = { 0, 1, 7, 4096, 20000 };
+	for (unsigned int g = 0; g < 5; g++) {
+		vector<std::atomic<unsigned int>> hits(last);
+		std::atomic<bool> too_big{ false };
+		unsigned long long grain = grains[g];
+		pool.parallel_for(first, last, grain, [&hits, &too_big, grain](unsigned long long from, unsigned long long to) {
+			if (to - from > (grain == 0 ? 1 : grain)) too_big = true;
+			for (unsigned long long i = from; i < to; i++) hits[i]++;
+		});
+		bool exact = true;
+		for (unsigned long long i = 0; i < last; i++) exact = exact && hits[i] == (i < first ? 0u : 1u);
+		CHECK(exact && !too_big);
+	}
+	bool called = false;
+	pool.parallel_for(5, 5, 1, [&called](unsigned long long, unsigned long long) { called = true; });
+	CHECK(!called);
+}
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include "test.h"
+
+#ifdef __linux__
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static const char* const SERVER_SOCKET = "rnd_gen_server_test.sock";
+
+typedef struct {
+	unsigned int status;
+	vector<string> results;
+} test_reply;
+
+static void load_words(Generator &gen) {
+	const char* path = "core_test_server.xml";
+	FILE* out = fopen(path, "w");
+	fputs("<library><group id=\"word\">"
+		"<option>amber</option><option>birch</option><option>cedar</option><option>dune</option>"
+		"<option>elm</option><option>fern</option><option>gale</option><option>heath</option>"
+		"</group><item id=\"long\"><option>a line longer than any word</option></item></library>", out);
+	fclose(out);
+	gen.load(path);
+	remove(path);
+}
+
+// The server runs on its own thread until the test is done with it
+class TestServer {
+private:
+	Server _server;
+	std::thread _thread;
+public:
+	TestServer(const Generator &gen, const server_config &config) : _server(gen, config) {
+		_thread = std::thread([this] { _server.run(); });
+	}
+	~TestServer() {
+		_server.stop();
+		_thread.join();
+	}
+
+	Metrics& metrics() {
+		return _server.metrics();
+	}
+};
+
+// Retries until the server thread has started listening
+static int connect_to(const char* socket_path) {
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, socket_path);
+	for (unsigned int attempt = 0; attempt < 500; attempt++) {
+		int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0) return fd;
+		close(fd);
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return -1;
+}
+
+static void send_all(int fd, const vector<char> &data) {
+	for (size_t sent = 0; sent < data.size();) {
+		ssize_t done = write(fd, data.data() + sent, data.size() - sent);
+		if (done <= 0) throw(GEN_OTHER_ERROR);
+		sent += done;
+	}
+}
+
+static void read_all(int fd, void* data, size_t size) {
+	for (size_t got = 0; got < size;) {
+		ssize_t done = read(fd, (char*)data + got, size - got);
+		if (done <= 0) throw(GEN_OTHER_ERROR);
+		got += done;
+	}
+}
+
+// `path_length` is sent as given, so it can disagree with the frame
+static void send_request(int fd, unsigned long long seed, unsigned int count, const string &path, unsigned short path_length) {
+	unsigned int length = REQUEST_FIXED_SIZE + path.size();
+	vector<char> frame(FRAME_HEADER_SIZE + length);
+	memcpy(frame.data(), &length, 4);
+	memcpy(frame.data() + 4, &seed, 8);
+	memcpy(frame.data() + 12, &count, 4);
+	memcpy(frame.data() + 16, &path_length, 2);
+	memcpy(frame.data() + 18, path.data(), path.size());
+	send_all(fd, frame);
+}
+static void send_request(int fd, unsigned long long seed, unsigned int count, const string &path) {
+	send_request(fd, seed, count, path, (unsigned short)path.size());
+}
+
+static test_reply read_reply(int fd) {
+	test_reply ret;
+	unsigned int length, count;
+	read_all(fd, &length, 4);
+	read_all(fd, &ret.status, 4);
+	read_all(fd, &count, 4);
+	size_t left = length - 8;
+	for (unsigned int i = 0; i < count; i++) {
+		unsigned int size;
+		read_all(fd, &size, 4);
+		string result(size, '\0');
+		read_all(fd, result.data(), size);
+		ret.results.push_back(result);
+		left -= 4 + size;
+	}
+	if (left != 0) throw(GEN_OTHER_ERROR);
+	return ret;
+}
+
+static bool has_line(const string &text, const string &line) {
+	return text.find("\n" + line + "\n") != string::npos;
+}
+
+// One worker that may wait a long time for a second request: the batch is closed by
+// reaching max_batch, not by the window running out
+TEST(concurrent_requests_to_one_generator_share_a_batch) {
+	Generator gen;
+	load_words(gen);
+	const Item* word = gen.find("word");
+	server_config config = default_server_config(SERVER_SOCKET);
+	config.workers = 1;
+	config.max_connections = 8;
+	config.buffer_size = 4096;
+	config.coalesce_window = 10 * 1000 * 1000;
+	config.max_batch = 2;
+	TestServer server(gen, config);
+
+	int first = connect_to(SERVER_SOCKET);
+	int second = connect_to(SERVER_SOCKET);
+	CHECK(first >= 0 && second >= 0);
+	send_request(first, 11, 6, "word");
+	send_request(second, 12, 4, "word");
+	test_reply first_reply = read_reply(first);
+	test_reply second_reply = read_reply(second);
+	close(first);
+	close(second);
+
+	CHECK(first_reply.status == REQUEST_OK && first_reply.results.size() == 6);
+	CHECK(second_reply.status == REQUEST_OK && second_reply.results.size() == 4);
+	bool seeded = true;
+	for (unsigned int i = 0; i < 6; i++) seeded = seeded && first_reply.results[i] == word->evaluate_at(11, i);
+	for (unsigned int i = 0; i < 4; i++) seeded = seeded && second_reply.results[i] == word->evaluate_at(12, i);
+	CHECK(seeded);
+
+	string text;
+	server.metrics().write(text);
+	CHECK(has_line(text, "rnd_gen_batch_requests_count 1") && has_line(text, "rnd_gen_batch_requests_sum 2"));
+	CHECK(has_line(text, "rnd_gen_evaluate_duration_seconds_count 1"));
+	CHECK(has_line(text, "rnd_gen_results_total 10"));
+}
+
+TEST(every_reply_carries_its_status) {
+	Generator gen;
+	load_words(gen);
+	eval_budget budget = gen.budget();
+	budget.max_bytes = 10;
+	gen.budget(budget);
+	server_config config = default_server_config(SERVER_SOCKET);
+	config.workers = 2;
+	config.max_connections = 4;
+	config.buffer_size = 4096;
+	config.coalesce_window = 0;
+	config.max_count = 100;
+	TestServer server(gen, config);
+
+	int fd = connect_to(SERVER_SOCKET);
+	CHECK(fd >= 0);
+	send_request(fd, 3, 100, "word");
+	test_reply ok = read_reply(fd);
+	send_request(fd, 3, 1, "word", 3);
+	test_reply mismatch = read_reply(fd);
+	send_request(fd, 3, 1, "nowhere");
+	test_reply unknown = read_reply(fd);
+	send_request(fd, 3, 101, "word");
+	test_reply too_many = read_reply(fd);
+	send_request(fd, 3, 2, "long");
+	test_reply too_long = read_reply(fd);
+	// The connection is still usable after every kind of failure
+	send_request(fd, 4, 1, "word");
+	test_reply again = read_reply(fd);
+	close(fd);
+
+	CHECK(ok.status == REQUEST_OK && ok.results.size() == 100 && ok.results[99] == gen.find("word")->evaluate_at(3, 99));
+	CHECK(mismatch.status == BAD_REQUEST && mismatch.results.empty());
+	CHECK(unknown.status == UNKNOWN_GENERATOR && unknown.results.empty());
+	CHECK(too_many.status == COUNT_TOO_LARGE && too_many.results.empty());
+	CHECK(too_long.status == BUDGET_EXCEEDED && too_long.results.empty());
+	CHECK(again.status == REQUEST_OK && again.results.size() == 1);
+
+	string text;
+	server.metrics().write(text);
+	CHECK(has_line(text, "rnd_gen_requests_total{status=\"ok\"} 2"));
+	CHECK(has_line(text, "rnd_gen_requests_total{status=\"budget_exceeded\"} 1"));
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "test.h"
+
+#ifdef __linux__
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+static const char* const RING_FILE = "rnd_gen_shm_ring_test";
+
+TEST(a_dropping_ring_counts_results_dropped_after_the_last_one_read) {
+	const unsigned int written = 1000;
+	{
+		ShmRing producer(RING_FILE, 4096, SHM_DROP);
+		char text[100] = { 0 };
+		for (unsigned int i = 0; i < written; i++) producer.write(text, sizeof(text));
+	}
+	ShmRing consumer(RING_FILE);
+	shm_result result;
+	unsigned int read = 0;
+	while (consumer.read(result, 0)) read++;
+	consumer.release();
+	ShmRing::remove(RING_FILE);
+	CHECK(read > 0 && read < written);
+	CHECK(read + consumer.lost() == written);
+	CHECK(!consumer.read(result, 0));
+	CHECK(read + consumer.lost() == written);
+}
+
+TEST(a_blocking_ring_hands_over_every_result_in_order) {
+	const unsigned int written = 20000;
+	ShmRing producer(RING_FILE, 4096, SHM_BLOCK);
+	ShmRing consumer(RING_FILE);
+	std::thread feed([&producer, written] {
+		for (unsigned int i = 0; i < written; i++) producer.write((const char*)&i, sizeof(i));
+		producer.close();
+	});
+	shm_result result;
+	unsigned int read = 0;
+	bool ordered = true;
+	while (true) {
+		if (!consumer.read(result, 0)) {
+			consumer.release();
+			if (!consumer.read(result)) break;
+		}
+		unsigned int value;
+		memcpy(&value, result.data, sizeof(value));
+		ordered = ordered && value == read && result.sequence == read;
+		read++;
+	}
+	feed.join();
+	ShmRing::remove(RING_FILE);
+	CHECK(ordered);
+	CHECK(read == written && consumer.lost() == 0);
+}
+TEST(a_blocking_ring_gives_up_once_its_consumer_detaches) {
+	ShmRing producer(RING_FILE, 4096, SHM_BLOCK);
+	char text[100] = { 0 };
+	std::thread feed;
+	{
+		ShmRing consumer(RING_FILE);
+		shm_result result;
+		CHECK(producer.write(text, sizeof(text)));
+		CHECK(consumer.read(result, 0));
+		consumer.release();
+		// Still attached when the ring fills, so the producer is asleep when it goes
+		feed = std::thread([&producer, &text] {
+			while (producer.write(text, sizeof(text))) { }
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	}
+	feed.join();
+	ShmRing::remove(RING_FILE);
+	CHECK(producer.abandoned());
+	CHECK(!producer.write(text, sizeof(text)));
+}
+
+TEST(recreating_a_ring_leaves_an_attached_consumer_its_own) {
+	ShmRing first(RING_FILE, 4096, SHM_DROP);
+	ShmRing consumer(RING_FILE);
+	first.write("old", 3);
+	{
+		ShmRing second(RING_FILE, 8192, SHM_DROP);
+		second.write("new", 3);
+		ShmRing other(RING_FILE);
+		shm_result result;
+		CHECK(other.read(result, 0) && string(result.data, result.length) == "new");
+	}
+	shm_result result;
+	CHECK(consumer.read(result, 0) && string(result.data, result.length) == "old");
+	CHECK(ShmRing::remove(RING_FILE));
+	CHECK(ShmRing::path_of("ring") == string(SHM_RING_DIR) + "ring" && ShmRing::path_of("./ring") == "./ring");
+}
+#endif
\ No newline at end of file
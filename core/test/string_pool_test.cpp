@@ -0,0 +1,51 @@
+#include "test.h"
+
+TEST(a_string_pool_round_trips_every_byte) {
+	StringPool pool;
+	string all;
+	for (unsigned int c = 1; c < 256; c++) all.push_back((char)c);
+	unsigned int id = pool.add(all);
+	unsigned int words = pool.add("the dragon the dragon the dragon");
+	pool.freeze();
+	CHECK(pool.get(id) == all);
+	CHECK(pool.length(id) == all.size());
+	CHECK(pool.get(words) == "the dragon the dragon the dragon");
+	CHECK(pool.get(StringPool::EMPTY).empty());
+}
+
+TEST(a_string_pool_does_not_grow_utf8) {
+	string text = "\xC3\xA9t\xC3\xA9 \xE2\x80\x94 \xF0\x9F\x90\x89";
+	StringPool pool;
+	size_t empty = pool.bytes();
+	unsigned int id = pool.add(text);
+	pool.freeze();
+	CHECK(pool.bytes() - empty == text.size() + sizeof(unsigned int));
+	CHECK(pool.get(id) == text);
+}
+
+TEST(a_string_pool_dedups_after_freeze) {
+	StringPool pool;
+	unsigned int first = pool.add("goblin");
+	pool.freeze();
+	CHECK(pool.add("goblin") == first);
+	unsigned int later = pool.add("kobold");
+	CHECK(pool.add("kobold") == later);
+	CHECK(pool.size() == 3);
+}
+
+// freeze() re-encodes every text with its dictionary, and the dedup table, which
+// hashes encoded bytes, is rebuilt to match
+TEST(a_string_pool_finds_every_text_again_after_freeze) {
+	StringPool pool;
+	vector<unsigned int> ids;
+	for (unsigned int i = 0; i < 500; i++) ids.push_back(pool.add("the ancient goblin warlord number " + std::to_string(i)));
+	size_t before = pool.bytes();
+	pool.freeze();
+	CHECK(pool.bytes() < before);
+	size_t frozen = pool.bytes();
+	for (unsigned int i = 0; i < 500; i++) CHECK(pool.add("the ancient goblin warlord number " + std::to_string(i)) == ids[i]);
+	CHECK(pool.size() == 501 && pool.bytes() == frozen);
+	unsigned int later = pool.add("the ancient goblin warlord number 500");
+	CHECK(later == 501 && pool.get(later) == "the ancient goblin warlord number 500");
+	CHECK(pool.add("") == StringPool::EMPTY);
+}
\ No newline at end of file
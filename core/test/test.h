@@ -0,0 +1,47 @@
+#ifndef __RND_GEN_CORE_TEST_H__
+#define __RND_GEN_CORE_TEST_H__
+
+#include "core.h"
+
+// Just enough of a harness for the core tests: each TEST registers itself, and a
+// failed CHECK ends that test with its file and line
+typedef void (*test_function)();
+
+typedef struct {
+	const char* file;
+	int line;
+	const char* expression;
+} test_failure;
+
+vector<std::pair<const char*, test_function>>& all_tests();
+
+class TestRegistration {
+public:
+	TestRegistration(const char* name, test_function run) {
+		all_tests().push_back(std::make_pair(name, run));
+	}
+};
+
+#define TEST(name) \
+	static void name(); \
+	static TestRegistration name##_registration(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { \
+		if (!(expression)) throw test_failure{ __FILE__, __LINE__, #expression }; \
+	} while (0)
+
+#define CHECK_THROWS(expression, error) \
+	do { \
+		bool thrown = false; \
+		try { \
+			expression; \
+		} \
+		catch (gen_errno err) { \
+			thrown = err == (error); \
+		} \
+		if (!thrown) throw test_failure{ __FILE__, __LINE__, #expression " throws " #error }; \
+	} while (0)
+
+#endif // !__RND_GEN_CORE_TEST_H__
\ No newline at end of file
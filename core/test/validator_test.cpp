@@ -0,0 +1,107 @@
+#include "test.h"
+
+static void write_doc(const char* path, const char* text) {
+	FILE* out = fopen(path, "w");
+	CHECK(out != 0);
+	fputs(text, out);
+	fclose(out);
+}
+
+static bool has_problem(const vector<load_problem> &problems, gen_errno code, const string &path) {
+	for (vector<load_problem>::const_iterator it = problems.begin(); it != problems.end(); ++it) {
+		if (it->code == code && it->path == path) return true;
+	}
+	return false;
+}
+
+TEST(documents_that_load_have_no_problems) {
+	const char* path = "core_test_valid.xml";
+	write_doc(path, "<library>\n"
+		"\t<group id=\"color\"><option weight=\"3\">red</option><option>blue</option></group>\n"
+		"\t<item id=\"palette\"><group_ref id=\"shade\" ref=\"color\"/></item>\n"
+		"\t<item id=\"npc\"><option>a </option><option_ref ref=\"color::#1\"/><group_ref ref=\"palette::shade\"/></item>\n"
+		"</library>");
+
+	Generator gen;
+	Validator validator(gen, 2);
+	validator.add_doc(path);
+	validator.add_entry("npc");
+	CHECK(validator.run().empty());
+	gen.load(path);
+	remove(path);
+	CHECK(gen.find("npc")->evaluate_at(0, 0).substr(0, 6) == "a blue");
+}
+
+TEST(every_problem_is_reported_at_once) {
+	const char* path = "core_test_broken.xml";
+	write_doc(path, "<library>\n"
+		"\t<group id=\"color\"><option weight=\"heavy\">red</option><option>blue</option><option id=\"#0\">teal</option></group>\n"
+		"\t<widget id=\"odd\"/>\n"
+		"\t<item id=\"npc\"><group_ref ref=\"nowhere\"/><option_ref ref=\"color\"/><item_ref/></item>\n"
+		"\t<item id=\"kids\"><item_ref id=\"of\" ref=\"color\"><option>x</option></item_ref></item>\n"
+		"</library>");
+
+	Generator gen;
+	Validator validator(gen, 1);
+	validator.add_doc(path);
+	validator.add_doc("core_test_missing.xml");
+	vector<load_problem> problems = validator.run();
+	remove(path);
+	CHECK(problems.size() == 8);
+	CHECK(has_problem(problems, PARSE_ERROR, "color::#0"));
+	CHECK(has_problem(problems, NAME_COLLISION, "color::#0"));
+	CHECK(has_problem(problems, UNKNOWN_ELEMENT, "odd"));
+	CHECK(has_problem(problems, BAD_REFERENCE, "npc::#0"));
+	CHECK(has_problem(problems, BAD_REFERENCE, "npc::#1"));
+	CHECK(has_problem(problems, BAD_REFERENCE, "npc::#2"));
+	CHECK(has_problem(problems, ITEM_NOT_FOUND, "kids::of"));
+	CHECK(has_problem(problems, FILE_NOT_READABLE, ""));
+	CHECK(problems[0].document == path);
+	CHECK_THROWS(gen.load(path), FILE_NOT_READABLE);
+}
+
+TEST(reference_cycles_are_found) {
+	const char* path = "core_test_cycles.xml";
+	write_doc(path, "<library>\n"
+		"\t<item id=\"loop\"><option>a</option><item id=\"inner\"><item_ref id=\"back\" ref=\"loop\"/></item></item>\n"
+		"\t<item id=\"self\"><item_ref id=\"me\" ref=\"self::me\"/></item>\n"
+		"\t<item id=\"everything\"><item_ref id=\"all\" ref=\"::\"/></item>\n"
+		"\t<item id=\"fine\"><item_ref ref=\"loop::#0\"/></item>\n"
+		"</library>");
+
+	Generator gen;
+	Validator validator(gen, 1);
+	validator.add_doc(path);
+	vector<load_problem> problems = validator.run();
+	remove(path);
+	CHECK(problems.size() == 3);
+	CHECK(has_problem(problems, REFERENCE_CYCLE, "loop::inner::back"));
+	CHECK(has_problem(problems, REFERENCE_CYCLE, "self::me"));
+	CHECK(has_problem(problems, REFERENCE_CYCLE, "everything::all"));
+}
+
+// Top level names are shared across documents, and unnamed items are numbered among
+// everything the earlier documents put there
+TEST(documents_are_checked_as_one_library) {
+	const char* first = "core_test_first_part.xml";
+	const char* second = "core_test_second_part.xml";
+	write_doc(first, "<library><item id=\"npc\"><group_ref ref=\"colors::#0\"/></item><option>top</option></library>");
+	write_doc(second, "<library><item id=\"colors\"><group><option>red</option></group></item>"
+		"<item id=\"npc\"/><option>next</option><item id=\"orphan\"/></library>");
+
+	Generator gen;
+	Validator validator(gen, 2);
+	validator.add_doc(first);
+	validator.add_doc(second);
+	validator.add_entry("npc");
+	validator.add_entry("#1");
+	validator.add_entry("missing");
+	vector<load_problem> problems = validator.run();
+	remove(first);
+	remove(second);
+	CHECK(problems.size() == 4);
+	CHECK(has_problem(problems, NAME_COLLISION, "npc"));
+	CHECK(has_problem(problems, ITEM_NOT_FOUND, "missing"));
+	CHECK(has_problem(problems, UNREACHABLE_ITEM, "#3"));
+	CHECK(has_problem(problems, UNREACHABLE_ITEM, "orphan"));
+}
\ No newline at end of file
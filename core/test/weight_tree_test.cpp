@@ -0,0 +1,104 @@
+#include "test.h"
+
+// Every target in [0, total) against a plain running sum
+static bool finds_like_a_scan(const WeightTree &tree, const vector<unsigned int> &weights) {
+	unsigned long long total = 0;
+	for (unsigned int i = 0; i < weights.size(); i++) {
+		for (unsigned long long target = total; target < total + weights[i]; target++) {
+			if (tree.find(target) != i) return false;
+		}
+		total += weights[i];
+	}
+	return tree.total() == total;
+}
+
+static vector<unsigned int> test_weights(unsigned int count) {
+	vector<unsigned int> ret;
+	for (unsigned int i = 0; i < count; i++) ret.push_back(i % 4 == 2 ? 0 : (i * 7) % 5 + 1);
+	return ret;
+}
+
+TEST(a_weight_tree_finds_every_target_at_every_size) {
+	for (unsigned int count = 1; count <= 40; count++) {
+		vector<unsigned int> weights = test_weights(count);
+		WeightTree built(weights);
+		WeightTree pushed;
+		for (unsigned int i = 0; i < count; i++) pushed.push_back(weights[i]);
+		CHECK(finds_like_a_scan(built, weights));
+		CHECK(finds_like_a_scan(pushed, weights));
+		CHECK_THROWS(built.find(built.total()), OPTION_NOT_FOUND);
+	}
+}
+
+TEST(a_weight_tree_follows_updates_and_pops) {
+	vector<unsigned int> weights = test_weights(23);
+	WeightTree tree(weights);
+	for (unsigned int i = 0; i < weights.size(); i += 3) {
+		weights[i] = weights[i] * 3 + 1;
+		tree.weight(i, weights[i]);
+	}
+	CHECK(finds_like_a_scan(tree, weights));
+	for (unsigned int i = 0; i < 9; i++) {
+		tree.pop_back();
+		weights.pop_back();
+	}
+	CHECK(finds_like_a_scan(tree, weights));
+	weights.push_back(6);
+	tree.push_back(6);
+	CHECK(finds_like_a_scan(tree, weights));
+	tree.clear();
+	CHECK(tree.empty() && tree.total() == 0);
+	CHECK_THROWS(tree.find(0), OPTION_NOT_FOUND);
+}
+
+TEST(excluded_slots_find_like_a_tree_with_them_zeroed) {
+	for (unsigned int count = 1; count <= 40; count++) {
+		vector<unsigned int> weights = test_weights(count);
+		WeightTree tree(weights);
+		weight_overlay excluded;
+		vector<unsigned int> zeroed = weights;
+		for (unsigned int i = count / 3; i < count; i += 5) {
+			tree.exclude(i, excluded);
+			zeroed[i] = 0;
+		}
+		WeightTree expected(zeroed);
+		for (unsigned long long target = 0; target < expected.total(); target++) {
+			CHECK(tree.find(target, excluded) == expected.find(target));
+		}
+		CHECK(tree.total() == WeightTree(weights).total());
+	}
+}
+
+TEST(removing_an_option_moves_the_last_one_into_its_slot) {
+	Generator gen;
+	Group* group = new Group(gen);
+	group->name("color");
+	gen.add_child(group);
+	const char* names[] = { "red", "green", "blue", "white" };
+	unsigned int weights[] = { 1, 2, 3, 4 };
+	vector<Option*> options;
+	for (unsigned int i = 0; i < 4; i++) {
+		Option* option = new Option(gen);
+		option->name(names[i]);
+		option->weight(weights[i]);
+		group->add_child(option);
+		options.push_back(option);
+	}
+
+	group->remove_child(options[1]);
+	delete options[1];
+	vector<Option*> left = group->options();
+	CHECK(left.size() == 3);
+	CHECK(left[0] == options[0] && left[1] == options[3] && left[2] == options[2]);
+	CHECK(group->total_weight() == 8);
+
+	random_engine rng(11, 0);
+	vector<unsigned int> seen(4, 0);
+	for (unsigned int i = 0; i < 800; i++) {
+		const Option* drawn = group->draw(rng);
+		for (unsigned int k = 0; k < 4; k++) {
+			if (drawn == options[k]) seen[k]++;
+		}
+	}
+	CHECK(seen[1] == 0 && seen[0] > 0 && seen[2] > seen[0] && seen[3] > seen[2]);
+}
\ No newline at end of file
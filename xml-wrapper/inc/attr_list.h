@@ -0,0 +1,43 @@
+#pragma once
+#ifndef __XML_WRAPPER_ATTR_LIST_H__
+#define __XML_WRAPPER_ATTR_LIST_H__
+
+#include "typedefs.h"
+
+namespace xml {
+const unsigned int INLINE_ATTRS = 3;
+
+// Attributes of one node, sorted by name. Almost every element has two or three, so
+// they live inline and are found by a linear scan; wider elements spill to the heap.
+class attr_list {
+private:
+	attribute _inline[INLINE_ATTRS];
+	vector<attribute> _spill;			// Holds every attribute once there are too many to inline
+	unsigned int _size;
+
+	attribute* data();
+	const attribute* data() const;
+public:
+	typedef const attribute* const_iterator;
+	typedef attribute* iterator;
+
+	attr_list();
+	~attr_list();
+
+	unsigned int size() const;
+	bool empty() const;
+
+	const_iterator begin() const;
+	const_iterator end() const;
+	iterator begin();
+	iterator end();
+
+	const attribute* find(const string &attr_name) const;
+	attribute* find(const string &attr_name);
+	attribute& insert(const attribute &new_attr);
+	bool erase(const string &attr_name);
+	void clear();
+};
+}
+
+#endif // !__XML_WRAPPER_ATTR_LIST_H__
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+#ifndef __XML_WRAPPER_BUNDLE_H__
+#define __XML_WRAPPER_BUNDLE_H__
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Shared by the xml wrapper and the core Generator, so it only leans on the standard
+// library rather than either module's typedefs, and throws its own errors
+namespace xml {
+/*
+ * One file holding many documents, all integers in host byte order:
+ *   header: "RNDBNDL1" | u32 count | u32 reserved | u64 index offset
+ *   index:  count * bundle_record, sorted by name, then the names
+ * Entry contents sit between the header and the index.
+ */
+const char BUNDLE_MAGIC[8] = { 'R', 'N', 'D', 'B', 'N', 'D', 'L', '1' };
+const unsigned int BUNDLE_HEADER_SIZE = 24;
+
+enum bundle_errno {
+	BUNDLE_NOT_READABLE,
+	BUNDLE_CORRUPT,
+	BUNDLE_NO_ENTRY
+};
+
+enum bundle_codec {
+	CODEC_NONE,
+	CODEC_LZ
+};
+
+typedef struct {
+	unsigned long long offset;
+	unsigned long long stored_size;		// Bytes in the file
+	unsigned long long size;			// Bytes once decompressed
+	unsigned int name_offset;			// Into the names that follow the records
+	unsigned int name_length;
+	unsigned int codec;
+	unsigned int reserved;
+} bundle_record;
+
+// Read side. The whole file is mapped once; after that, finding and reading an
+// entry makes no system calls. Compressed entries are expanded the first time
+// they are asked for and kept, so later reads are free.
+class bundle {
+private:
+	const char* _base;
+	size_t _size;
+	void* _mapping;						// Windows needs the mapping handle to unmap
+	const bundle_record* _records;
+	const char* _names;
+	unsigned int _count;
+
+	std::vector<std::vector<char>*> _expanded;
+	std::mutex _lock;
+
+	void map_file(const std::string &bundle_file);
+	void unmap();
+	unsigned int find(const char* name, size_t length) const;
+public:
+	static const unsigned int NO_ENTRY = ~0u;
+
+	bundle(const std::string &bundle_file);
+	~bundle();
+
+	unsigned int size() const;
+	std::string name(unsigned int entry) const;
+	std::vector<std::string> names() const;
+	bool has(const std::string &entry_name) const;
+
+	const char* data(unsigned int entry, size_t &length);
+	const char* data(const std::string &entry_name, size_t &length);
+};
+
+// Write side, used by the packing tool
+class bundle_writer {
+private:
+	typedef struct {
+		std::string name;
+		std::vector<char> bytes;
+		unsigned long long size;
+		unsigned int codec;
+	} pending;
+
+	std::vector<pending> _entries;
+public:
+	bundle_writer();
+	~bundle_writer();
+
+	void add(const std::string &entry_name, const char* contents, size_t length, bool compress);
+	bool add_file(const std::string &entry_name, const std::string &file, bool compress);
+	bool write(const std::string &bundle_file) const;
+};
+}
+
+#endif // !__XML_WRAPPER_BUNDLE_H__
\ No newline at end of file
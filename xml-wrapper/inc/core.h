@@ -20,9 +20,17 @@ class xml_wrapper;
 
 typedef node* (*node_factory)(xml_wrapper* wrapper, node* parent, const xml_node* node);
 
+// One bit per class; a class's typemask also carries the bits of all its ancestors
+enum node_type_bit {
+	NODE_BIT = 1 << 0,
+	NODE_REF_BIT = 1 << 1,
+	NAME_SPACE_BIT = 1 << 2,
+	DOCUMENT_BIT = 1 << 3
+};
+
 template<class node_type>
-typedef node_type* factory_for_(xml_wrapper* wrapper, node* parent, const xml_node* base_node) {
-	return new node_type(doc, base_node);
+node* factory_for_(xml_wrapper* wrapper, node* parent, const xml_node* base_node) {
+	return new node_type(wrapper, parent, base_node);
 }
 
 enum xml_errno {
@@ -38,15 +46,19 @@ enum xml_errno {
 	NAMESPACE_COLLISION,
 	FLOATING_REFERENCE,
 	REFERENCE_REBIND,
+	PARSE_ERROR,
 
 	OTHER_ERROR
 };
 
-const char* ID_STRING = "id";
+const char* const ID_STRING = "id";
 const unsigned int MIN_ID_LENGTH = 1;
-const char* REF_STRING = "ref";
-const char* DEFAULT_VALUE = "";
-const char* NAMESPACE_DELIMITER = "::";
+const char* const REF_STRING = "ref";
+const char* const DEFAULT_VALUE = "";
+const char* const NAMESPACE_DELIMITER = "::";
+
+// Attribute names are matched without regard to case
+string lowercase(const string &text);
 
 class node {
 protected:
@@ -54,18 +66,22 @@ protected:
 	name_space* _space;
 	node* _parent;
 	hashmap<string, node*> _children;
-	hashmap<string, attribute> _attrs;
+	attr_list _attrs;
 public:
 	static const string classname;
+	static constexpr type_mask typemask = NODE_BIT;
 
 	node();
 	node(xml_wrapper* wrapper, node* parent, const xml_node* node);
 	node(const string& id);
 	node(node* parent, const string& id);
 	node(node* parent, const string& id, const vector<attribute> &attributes);
-	~node();
+	virtual ~node();
 
-	virtual bool instanceof(const string &classname) const;
+	virtual type_mask types() const;
+	bool instanceof(type_mask mask) const {
+		return (types() & mask) == mask;
+	}
 
 	virtual string id() const;
 
@@ -113,13 +129,14 @@ protected:
 	node* _base;
 public:
 	static const string classname;
+	static constexpr type_mask typemask = NODE_REF_BIT | node::typemask;
 
 	node_ref();
 	node_ref(xml_wrapper* wrapper, node* parent, const xml_node *node);
 	node_ref(node* parent, const string &ref_id);
 	~node_ref();
 
-	virtual bool instanceof(const string &classname) const;
+	virtual type_mask types() const;
 
 	bool bound() const;
 
@@ -160,11 +177,14 @@ private:
 	hashmap<string, vector<node_ref*>> _refs;	// Map a node name to its references
 public:
 	static const string classname;
+	static constexpr type_mask typemask = NAME_SPACE_BIT | node::typemask;
 
 	name_space();
 	name_space(xml_wrapper* wrapper, node* parent, const xml_node* base_node);
 	~name_space();
 
+	virtual type_mask types() const;
+
 	virtual const name_space* child_space() const;
 	virtual name_space* child_space();
 
@@ -183,25 +203,30 @@ public:
 class document : public name_space {
 public:
 	static const string classname;
+	static constexpr type_mask typemask = DOCUMENT_BIT | name_space::typemask;
 
 	document();
 	document(xml_wrapper* wrapper, xml_node* base_node);
 	~document();
+
+	virtual type_mask types() const;
 };
 
 class xml_wrapper {
 private:
 	hashmap<string, document*> _docs;
-	hashmap<string, node_factory> _factories;
+	factory_table<node_factory> _factories;
 public:
 	xml_wrapper();
 	xml_wrapper(const string &xml_file);
 	~xml_wrapper();
 
+	// Register every factory, then freeze once before anything creates a node
 	template<class node_type>
 	void register_() {
-		_factories[node_type::classname] = factory_for_<node_type>;
+		_factories.add(node_type::classname, factory_for_<node_type>);
 	}
+	void freeze_factories();
 
 	vector<const document*> docs() const;
 	vector<document*> docs();
@@ -215,6 +240,18 @@ public:
 
 	node* create_node(node* parent, const xml_node* base_node);
 };
+
+// Checked downcast; the node classes only use single inheritance, so static_cast is safe
+template<class T>
+const T* node_cast(const node* base_node) {
+	if (base_node == 0 || !base_node->instanceof(T::typemask)) return 0;
+	return static_cast<const T*>(base_node);
+}
+template<class T>
+T* node_cast(node* base_node) {
+	if (base_node == 0 || !base_node->instanceof(T::typemask)) return 0;
+	return static_cast<T*>(base_node);
+}
 }
 
 #endif // !__RND_GEN_CORE_GEN_TREE_H__
\ No newline at end of file
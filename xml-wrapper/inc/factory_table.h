@@ -0,0 +1,120 @@
+#pragma once
+#ifndef __XML_WRAPPER_FACTORY_TABLE_H__
+#define __XML_WRAPPER_FACTORY_TABLE_H__
+
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Shared by the xml wrapper and the core Generator, so it only leans on the standard
+// library rather than either module's typedefs
+namespace xml {
+const unsigned int PERFECT_HASH_TRIES = 256;
+
+// Name -> factory map that is frozen into a collision-free (perfect) hash table once
+// registration is done. A frozen lookup reads the length and three characters of
+// the name, lands on exactly one slot and confirms it with a single compare.
+// Registration and freeze() are single-threaded set-up; find() never writes, so a
+// frozen table can be shared by any number of threads. Lookups before freeze() find
+// nothing, so a missing freeze shows up at once rather than as a race.
+template<class V>
+class factory_table {
+private:
+	typedef struct {
+		std::string key;
+		V value;
+		bool used;
+	} slot;
+
+	std::unordered_map<std::string, V> _pending;
+	std::vector<slot> _slots;
+	unsigned int _mask;
+	unsigned int _seed;
+	bool _whole_name;			// Three characters could not tell the names apart
+	bool _frozen;
+
+	unsigned int slot_of(const char* name, size_t length, unsigned int seed, bool whole_name) const {
+		unsigned int h = seed ^ ((unsigned int)length * 0x9E3779B1u);
+		if (whole_name) {
+			for (size_t i = 0; i < length; i++) h = (h ^ (unsigned char)name[i]) * 0x01000193u;
+		}
+		else if (length > 0) {
+			h = (h ^ (unsigned char)name[0]) * 0x01000193u;
+			h = (h ^ (unsigned char)name[length / 2]) * 0x01000193u;
+			h = (h ^ (unsigned char)name[length - 1]) * 0x01000193u;
+		}
+		h ^= h >> 15;
+		return h & _mask;
+	}
+
+	bool place(unsigned int seed, bool whole_name) {
+		_slots.assign(_mask + 1, slot());
+		for (typename std::unordered_map<std::string, V>::const_iterator it = _pending.begin(); it != _pending.end(); ++it) {
+			slot &target = _slots[slot_of(it->first.data(), it->first.size(), seed, whole_name)];
+			if (target.used) return false;
+			target.key = it->first;
+			target.value = it->second;
+			target.used = true;
+		}
+		_seed = seed;
+		_whole_name = whole_name;
+		return true;
+	}
+public:
+	factory_table() {
+		_mask = 0;
+		_seed = 0;
+		_whole_name = false;
+		_frozen = false;
+	}
+
+	unsigned int size() const {
+		return _pending.size();
+	}
+
+	bool frozen() const {
+		return _frozen;
+	}
+
+	void add(const std::string &name, V value) {
+		_pending[name] = value;
+		_frozen = false;
+	}
+
+	void freeze() {
+		if (_frozen) return;
+		// Start at a load factor of at most one half and double until some seed works
+		_mask = 1;
+		while (_mask + 1 < 2 * _pending.size()) _mask = (_mask << 1) | 1;
+		while (true) {
+			for (unsigned int seed = 0; seed < PERFECT_HASH_TRIES; seed++) {
+				if (place(seed * 0x85EBCA6Bu, false)) {
+					_frozen = true;
+					return;
+				}
+			}
+			for (unsigned int seed = 0; seed < PERFECT_HASH_TRIES; seed++) {
+				if (place(seed * 0x85EBCA6Bu, true)) {
+					_frozen = true;
+					return;
+				}
+			}
+			_mask = (_mask << 1) | 1;
+		}
+	}
+
+	const V* find(const char* name, size_t length) const {
+		if (!_frozen) return 0;
+		const slot &target = _slots[slot_of(name, length, _seed, _whole_name)];
+		if (!target.used || target.key.size() != length) return 0;
+		if (memcmp(target.key.data(), name, length) != 0) return 0;
+		return &target.value;
+	}
+	const V* find(const std::string &name) const {
+		return find(name.data(), name.size());
+	}
+};
+}
+
+#endif // !__XML_WRAPPER_FACTORY_TABLE_H__
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+#ifndef __XML_WRAPPER_LZ_H__
+#define __XML_WRAPPER_LZ_H__
+
+#include <stddef.h>
+#include <vector>
+
+// Shared by the xml wrapper and the core Generator, so it only leans on the standard
+// library rather than either module's typedefs
+namespace xml {
+// Byte-oriented LZ77 in the LZ4 sequence layout: a token with literal and match
+// lengths, the literals, then a 16-bit back offset. XML is mostly repeated tag and
+// attribute names, which this catches, and decoding is a tight copy loop.
+void lz_compress(const char* in, size_t size, std::vector<char> &out);
+bool lz_decompress(const char* in, size_t size, char* out, size_t out_size);
+}
+
+#endif // !__XML_WRAPPER_LZ_H__
\ No newline at end of file
@@ -2,8 +2,6 @@
 #ifndef __XML_WRAPPER_TYPEDEFS_H__
 #define __XML_WRAPPER_TYPEDEFS_H__
 
-#include "xml-wrapper.h"
-
 #include <string>
 #include <locale>
 #include <vector>
@@ -29,6 +27,8 @@ namespace xml {
 		string name;
 		string value;
 	} attribute;
+
+	typedef unsigned int type_mask;
 }
 
 #endif // !__XML_WRAPPER_TYPEDEFS_H__
@@ -1,4 +1,8 @@
 #pragma once
 
 #include "typedefs.h"
+#include "attr_list.h"
+#include "factory_table.h"
+#include "lz.h"
+#include "bundle.h"
 #include "core.h"
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "attr_list.h"
+
+using namespace xml;
+
+attr_list::attr_list() {
+	_size = 0;
+}
+
+attr_list::~attr_list() { }
+
+attribute* attr_list::data() {
+	return _spill.empty() ? _inline : _spill.data();
+}
+const attribute* attr_list::data() const {
+	return _spill.empty() ? _inline : _spill.data();
+}
+
+unsigned int attr_list::size() const {
+	return _size;
+}
+
+bool attr_list::empty() const {
+	return _size == 0;
+}
+
+attr_list::const_iterator attr_list::begin() const {
+	return data();
+}
+attr_list::const_iterator attr_list::end() const {
+	return data() + _size;
+}
+attr_list::iterator attr_list::begin() {
+	return data();
+}
+attr_list::iterator attr_list::end() {
+	return data() + _size;
+}
+
+const attribute* attr_list::find(const string &attr_name) const {
+	const attribute* attrs = data();
+	for (unsigned int i = 0; i < _size; i++) {
+		if (attrs[i].name == attr_name) return attrs + i;
+	}
+	return 0;
+}
+attribute* attr_list::find(const string &attr_name) {
+	return const_cast<attribute*>(static_cast<const attr_list*>(this)->find(attr_name));
+}
+
+attribute& attr_list::insert(const attribute &new_attr) {
+	attribute* existing = find(new_attr.name);
+	if (existing != 0) {
+		existing->value = new_attr.value;
+		return *existing;
+	}
+	if (_size == INLINE_ATTRS && _spill.empty()) {
+		_spill.reserve(2 * INLINE_ATTRS);
+		for (unsigned int i = 0; i < _size; i++) {
+			_spill.push_back(attribute());
+			_spill.back().name.swap(_inline[i].name);
+			_spill.back().value.swap(_inline[i].value);
+		}
+	}
+	if (!_spill.empty()) _spill.push_back(attribute());
+
+	// Shift larger names up one slot to keep the list sorted
+	attribute* attrs = data();
+	unsigned int pos = _size;
+	while (pos > 0 && new_attr.name < attrs[pos - 1].name) {
+		attrs[pos].name.swap(attrs[pos - 1].name);
+		attrs[pos].value.swap(attrs[pos - 1].value);
+		pos--;
+	}
+	attrs[pos].name = new_attr.name;
+	attrs[pos].value = new_attr.value;
+	_size++;
+	return attrs[pos];
+}
+
+bool attr_list::erase(const string &attr_name) {
+	attribute* attrs = data();
+	attribute* found = find(attr_name);
+	if (found == 0) return false;
+	for (unsigned int i = found - attrs; i + 1 < _size; i++) {
+		attrs[i].name.swap(attrs[i + 1].name);
+		attrs[i].value.swap(attrs[i + 1].value);
+	}
+	_size--;
+	if (_spill.empty()) {
+		attrs[_size].name.clear();
+		attrs[_size].value.clear();
+	}
+	else _spill.pop_back();
+	return true;
+}
+
+void attr_list::clear() {
+	for (unsigned int i = 0; i < INLINE_ATTRS; i++) {
+		_inline[i].name.clear();
+		_inline[i].value.clear();
+	}
+	_spill.clear();
+	_size = 0;
+}
\ No newline at end of file
@@ -0,0 +1,231 @@
+#include "bundle.h"
+#include "lz.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace xml;
+using std::string;
+using std::vector;
+
+static const unsigned int RECORD_ALIGNMENT = 8;
+
+bundle::bundle(const string &bundle_file) {
+	_base = 0;
+	_size = 0;
+	_mapping = 0;
+	map_file(bundle_file);
+
+	unsigned long long index_offset;
+	if (_size < BUNDLE_HEADER_SIZE || memcmp(_base, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC)) != 0) {
+		unmap();
+		throw(BUNDLE_CORRUPT);
+	}
+	memcpy(&_count, _base + 8, sizeof(_count));
+	memcpy(&index_offset, _base + 16, sizeof(index_offset));
+	unsigned long long names_offset = index_offset + (unsigned long long)_count * sizeof(bundle_record);
+	if (index_offset % RECORD_ALIGNMENT != 0 || index_offset > _size || names_offset > _size) {
+		unmap();
+		throw(BUNDLE_CORRUPT);
+	}
+	_records = (const bundle_record*)(_base + index_offset);
+	_names = _base + names_offset;
+
+	// Check every record up front so reads never have to
+	for (unsigned int i = 0; i < _count; i++) {
+		const bundle_record &rec = _records[i];
+		bool fits = rec.offset <= _size && rec.stored_size <= _size - rec.offset
+			&& rec.name_offset <= _size - names_offset && rec.name_length <= _size - names_offset - rec.name_offset;
+		bool known = rec.codec == CODEC_LZ || (rec.codec == CODEC_NONE && rec.stored_size == rec.size);
+		if (!fits || !known) {
+			unmap();
+			throw(BUNDLE_CORRUPT);
+		}
+	}
+	_expanded.assign(_count, 0);
+}
+
+bundle::~bundle() {
+	for (vector<vector<char>*>::iterator it = _expanded.begin(); it != _expanded.end(); ++it) delete *it;
+	unmap();
+}
+
+#ifdef _WIN32
+void bundle::map_file(const string &bundle_file) {
+	HANDLE file = CreateFileA(bundle_file.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE) throw(BUNDLE_NOT_READABLE);
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		CloseHandle(file);
+		throw(BUNDLE_CORRUPT);
+	}
+	HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+	CloseHandle(file);
+	if (mapping == 0) throw(BUNDLE_CORRUPT);
+	_base = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (_base == 0) {
+		CloseHandle(mapping);
+		throw(BUNDLE_CORRUPT);
+	}
+	_mapping = mapping;
+	_size = (size_t)size.QuadPart;
+}
+
+void bundle::unmap() {
+	if (_base != 0) UnmapViewOfFile(_base);
+	if (_mapping != 0) CloseHandle((HANDLE)_mapping);
+	_base = 0;
+	_mapping = 0;
+}
+#else
+void bundle::map_file(const string &bundle_file) {
+	int fd = open(bundle_file.c_str(), O_RDONLY);
+	if (fd < 0) throw(BUNDLE_NOT_READABLE);
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		close(fd);
+		throw(BUNDLE_CORRUPT);
+	}
+	void* base = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) throw(BUNDLE_CORRUPT);
+	_base = (const char*)base;
+	_size = info.st_size;
+}
+
+void bundle::unmap() {
+	if (_base != 0) munmap((void*)_base, _size);
+	_base = 0;
+}
+#endif
+
+unsigned int bundle::find(const char* name, size_t length) const {
+	unsigned int low = 0, high = _count;
+	while (low < high) {
+		unsigned int mid = (low + high) / 2;
+		const bundle_record &rec = _records[mid];
+		size_t common = rec.name_length < length ? rec.name_length : length;
+		int cmp = memcmp(_names + rec.name_offset, name, common);
+		if (cmp == 0) cmp = rec.name_length < length ? -1 : (rec.name_length > length ? 1 : 0);
+		if (cmp == 0) return mid;
+		if (cmp < 0) low = mid + 1;
+		else high = mid;
+	}
+	return NO_ENTRY;
+}
+
+unsigned int bundle::size() const {
+	return _count;
+}
+
+string bundle::name(unsigned int entry) const {
+	if (entry >= _count) throw(BUNDLE_NO_ENTRY);
+	return string(_names + _records[entry].name_offset, _records[entry].name_length);
+}
+
+vector<string> bundle::names() const {
+	vector<string> ret;
+	for (unsigned int i = 0; i < _count; i++) ret.push_back(name(i));
+	return ret;
+}
+
+bool bundle::has(const string &entry_name) const {
+	return find(entry_name.data(), entry_name.size()) != NO_ENTRY;
+}
+
+const char* bundle::data(unsigned int entry, size_t &length) {
+	if (entry >= _count) throw(BUNDLE_NO_ENTRY);
+	const bundle_record &rec = _records[entry];
+	length = rec.size;
+	if (rec.codec == CODEC_NONE) return _base + rec.offset;
+
+	std::lock_guard<std::mutex> guard(_lock);
+	if (_expanded[entry] == 0) {
+		vector<char>* bytes = new vector<char>(rec.size);
+		if (!lz_decompress(_base + rec.offset, rec.stored_size, bytes->data(), bytes->size())) {
+			delete bytes;
+			throw(BUNDLE_CORRUPT);
+		}
+		_expanded[entry] = bytes;
+	}
+	return _expanded[entry]->data();
+}
+
+const char* bundle::data(const string &entry_name, size_t &length) {
+	return data(find(entry_name.data(), entry_name.size()), length);
+}
+
+bundle_writer::bundle_writer() { }
+
+bundle_writer::~bundle_writer() { }
+
+// Compressed entries are only kept compressed when that actually saves space
+void bundle_writer::add(const string &entry_name, const char* contents, size_t length, bool compress) {
+	pending entry;
+	entry.name = entry_name;
+	entry.size = length;
+	entry.codec = CODEC_NONE;
+	if (compress) {
+		lz_compress(contents, length, entry.bytes);
+		if (entry.bytes.size() < length) entry.codec = CODEC_LZ;
+	}
+	if (entry.codec == CODEC_NONE) entry.bytes.assign(contents, contents + length);
+	_entries.push_back(entry);
+}
+
+bool bundle_writer::add_file(const string &entry_name, const string &file, bool compress) {
+	FILE* in = fopen(file.c_str(), "rb");
+	if (in == 0) return false;
+	vector<char> contents;
+	char chunk[4096];
+	size_t got;
+	while ((got = fread(chunk, 1, sizeof(chunk), in)) > 0) contents.insert(contents.end(), chunk, chunk + got);
+	bool ok = ferror(in) == 0;
+	fclose(in);
+	if (ok) add(entry_name, contents.data(), contents.size(), compress);
+	return ok;
+}
+
+bool bundle_writer::write(const string &bundle_file) const {
+	vector<unsigned int> order(_entries.size());
+	for (unsigned int i = 0; i < order.size(); i++) order[i] = i;
+	std::sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b) { return _entries[a].name < _entries[b].name; });
+
+	vector<char> out(BUNDLE_HEADER_SIZE, 0);
+	vector<bundle_record> records;
+	string names;
+	for (vector<unsigned int>::const_iterator it = order.begin(); it != order.end(); ++it) {
+		const pending &entry = _entries[*it];
+		if (!records.empty() && _entries[*(it - 1)].name == entry.name) return false;
+		bundle_record rec = { out.size(), entry.bytes.size(), entry.size, (unsigned int)names.size(), (unsigned int)entry.name.size(), entry.codec, 0 };
+		records.push_back(rec);
+		names += entry.name;
+		out.insert(out.end(), entry.bytes.begin(), entry.bytes.end());
+	}
+	out.resize((out.size() + RECORD_ALIGNMENT - 1) / RECORD_ALIGNMENT * RECORD_ALIGNMENT, 0);
+
+	unsigned int count = records.size();
+	unsigned long long index_offset = out.size();
+	memcpy(out.data(), BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC));
+	memcpy(out.data() + 8, &count, sizeof(count));
+	memcpy(out.data() + 16, &index_offset, sizeof(index_offset));
+	const char* raw = (const char*)records.data();
+	out.insert(out.end(), raw, raw + records.size() * sizeof(bundle_record));
+	out.insert(out.end(), names.begin(), names.end());
+
+	FILE* file = fopen(bundle_file.c_str(), "wb");
+	if (file == 0) return false;
+	bool ok = fwrite(out.data(), 1, out.size(), file) == out.size();
+	return fclose(file) == 0 && ok;
+}
\ No newline at end of file
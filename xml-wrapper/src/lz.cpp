@@ -0,0 +1,97 @@
+#include "lz.h"
+
+#include <string.h>
+
+using namespace xml;
+using std::vector;
+
+static const unsigned int MIN_MATCH = 4;
+static const unsigned int MAX_OFFSET = 0xFFFF;
+static const unsigned int HASH_BITS = 12;
+
+static unsigned int read32(const char* at) {
+	unsigned int v;
+	memcpy(&v, at, sizeof(v));
+	return v;
+}
+
+static unsigned int hash4(const char* at) {
+	return (read32(at) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Lengths of 15 and up continue in following bytes, 255 at a time
+static void put_length(vector<char> &out, size_t length) {
+	for (; length >= 255; length -= 255) out.push_back((char)255);
+	out.push_back((char)length);
+}
+
+static bool get_length(const unsigned char* &in, const unsigned char* end, size_t &length) {
+	unsigned char more;
+	do {
+		if (in >= end) return false;
+		more = *in++;
+		length += more;
+	} while (more == 255);
+	return true;
+}
+
+static void put_sequence(vector<char> &out, const char* literals, size_t literal_length, size_t match_length, size_t offset) {
+	size_t match_code = match_length >= MIN_MATCH ? match_length - MIN_MATCH : 0;
+	out.push_back((char)(((literal_length < 15 ? literal_length : 15) << 4) | (match_code < 15 ? match_code : 15)));
+	if (literal_length >= 15) put_length(out, literal_length - 15);
+	out.insert(out.end(), literals, literals + literal_length);
+	if (match_length == 0) return;
+	out.push_back((char)(offset & 0xFF));
+	out.push_back((char)(offset >> 8));
+	if (match_code >= 15) put_length(out, match_code - 15);
+}
+
+void xml::lz_compress(const char* in, size_t size, vector<char> &out) {
+	out.clear();
+	vector<size_t> table(1 << HASH_BITS, ~(size_t)0);
+	size_t anchor = 0, pos = 0;
+	while (pos + MIN_MATCH <= size) {
+		unsigned int h = hash4(in + pos);
+		size_t candidate = table[h];
+		table[h] = pos;
+		if (candidate == ~(size_t)0 || pos - candidate > MAX_OFFSET || read32(in + candidate) != read32(in + pos)) {
+			pos++;
+			continue;
+		}
+		size_t length = MIN_MATCH;
+		while (pos + length < size && in[candidate + length] == in[pos + length]) length++;
+		put_sequence(out, in + anchor, pos - anchor, length, pos - candidate);
+		pos += length;
+		anchor = pos;
+	}
+	put_sequence(out, in + anchor, size - anchor, 0, 0);
+}
+
+// Rejects anything that would read or write out of bounds, so a damaged bundle
+// fails cleanly instead of corrupting memory
+bool xml::lz_decompress(const char* in, size_t size, char* out, size_t out_size) {
+	const unsigned char* src = (const unsigned char*)in;
+	const unsigned char* end = src + size;
+	size_t done = 0;
+	while (src < end) {
+		unsigned char token = *src++;
+		size_t literal_length = token >> 4;
+		if (literal_length == 15 && !get_length(src, end, literal_length)) return false;
+		if ((size_t)(end - src) < literal_length || out_size - done < literal_length) return false;
+		if (literal_length > 0) memcpy(out + done, src, literal_length);
+		src += literal_length;
+		done += literal_length;
+		if (src == end) break;
+
+		if (end - src < 2) return false;
+		size_t offset = src[0] | (src[1] << 8);
+		src += 2;
+		size_t match_length = token & 0x0F;
+		if (match_length == 15 && !get_length(src, end, match_length)) return false;
+		match_length += MIN_MATCH;
+		if (offset == 0 || offset > done || out_size - done < match_length) return false;
+		// Byte by byte, since the match may overlap what it is copying
+		for (size_t i = 0; i < match_length; i++, done++) out[done] = out[done - offset];
+	}
+	return done == out_size;
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#include "core.h"
+
+using namespace xml;
+
+type_mask name_space::types() const {
+	return name_space::typemask;
+}
+
+type_mask document::types() const {
+	return document::typemask;
+}
\ No newline at end of file
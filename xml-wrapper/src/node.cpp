@@ -5,6 +5,12 @@ using namespace xml;
 
 const string node::classname = "node";
 
+string xml::lowercase(const string &text) {
+	string ret = text;
+	for (string::iterator it = ret.begin(); it != ret.end(); ++it) *it = (char)std::tolower((unsigned char)*it);
+	return ret;
+}
+
 node::node() {
 	_space = 0;
 	_parent = 0;
@@ -13,19 +19,19 @@ node::node() {
 node::node(xml_wrapper* wrapper, node* my_parent, const xml_node* base_node) : node() {
 	const xml_attribute* curr_attr = base_node->first_attribute();
 	while (curr_attr != 0) {
-		add_attr(std::tolower(curr_attr->name(), std::locale()), curr_attr->value());
+		add_attr(lowercase(curr_attr->name()), curr_attr->value());
 		curr_attr = curr_attr->next_attribute();
 	}
 	if (!has_attr(ID_STRING)) throw(NO_ID);
 	else if (attr(ID_STRING).size() < MIN_ID_LENGTH) throw(NO_ID);
-	else _id = _attrs[ID_STRING].value;
+	else _id = _attrs.find(ID_STRING)->value;
 
 	_parent = my_parent;
 	if (_parent != 0) my_parent->add_child(this);
 
 	const xml_node* child_base = base_node->first_node();
 	while (child_base != 0) {
-		node* new_node = wrapper->create_node(this, child_base);
+		wrapper->create_node(this, child_base);
 		child_base = child_base->next_sibling();
 	}
 }
@@ -42,21 +48,24 @@ node::node(node* my_parent, const string& id) : node(id) {
 
 node::node(node* my_parent, const string& id, const vector<attribute> &new_attrs) : node(my_parent, id) {
 	for (vector<attribute>::const_iterator it = new_attrs.begin(); it != new_attrs.end(); it++) {
-		add_attr(std::tolower(it->name, std::locale()), it->value);
+		add_attr(lowercase(it->name), it->value);
 	}
 }
 
+// Each child would remove itself from _children as it goes, so they are taken out first
 node::~node() {
-	for (hashmap<string, node*>::iterator it = _children.begin(); it != _children.end(); ++it) {
+	hashmap<string, node*> kids;
+	kids.swap(_children);
+	for (hashmap<string, node*>::iterator it = kids.begin(); it != kids.end(); ++it) {
+		it->second->_parent = 0;
 		delete it->second;
 	}
 	if (has_parent()) _parent->remove_child(this);
 	if (has_space()) _space->remove_node(this);
 }
 
-bool node::instanceof(const string &class_name) const {
-	if (class_name == node::classname) return true;
-	return false;
+type_mask node::types() const {
+	return node::typemask;
 }
 
 string node::id() const {
@@ -167,37 +176,34 @@ name_space* node::child_space() {
 
 vector<attribute> node::attributes() const {
 	vector<attribute> ret;
-	for (hashmap<string, attribute>::const_iterator it = _attrs.begin(); it != _attrs.end(); ++it) {
-		ret.push_back(it->second);
+	for (attr_list::const_iterator it = _attrs.begin(); it != _attrs.end(); ++it) {
+		ret.push_back(*it);
 	}
 	return ret;
 }
 
 string node::attr(const string& attr_name) const {
 	if (!has_attr(attr_name)) throw(ATTRIBUTE_NOT_FOUND);
-	return _attrs.find(attr_name)->second.value;
+	return _attrs.find(attr_name)->value;
 }
 void node::attr(const string& attr_name, const string& attr_val) {
 	if (!has_attr(attr_name)) throw(ATTRIBUTE_NOT_FOUND);
-	_attrs.find(attr_name)->second.value = attr_val;
+	_attrs.find(attr_name)->value = attr_val;
 }
 void node::attr(const attribute attr_pair) {
 	if (!has_attr(attr_pair.name)) throw(ATTRIBUTE_NOT_FOUND);
-	_attrs.find(attr_pair.name)->second.value = attr_pair.value;
+	_attrs.find(attr_pair.name)->value = attr_pair.value;
 }
 
 bool node::has_attr(const string& attr_name) const {
-	return _attrs.find(attr_name) != _attrs.end();
+	return _attrs.find(attr_name) != 0;
 }
 bool node::has_attr(const attribute attr) const {
-	return _attrs.find(attr.name) != _attrs.end();
+	return _attrs.find(attr.name) != 0;
 }
 
 void node::add_attr(const attribute new_attr) {
-	if (has_attr(new_attr)) attr(new_attr);
-	else {
-		_attrs[new_attr.name] = new_attr;
-	}
+	_attrs.insert(new_attr);
 }
 void node::add_attr(const string &attr_name, const string& attr_value) {
 	attribute new_attr = { attr_name, attr_value };
@@ -208,7 +214,6 @@ void node::add_attr(const string &attr_name) {
 }
 
 void node::remove_attr(const string& attr_name) {
-	if (!has_attr(attr_name)) return;
 	_attrs.erase(attr_name);
 }
 void node::remove_attr(const attribute old_attr) {
@@ -216,15 +221,19 @@ void node::remove_attr(const attribute old_attr) {
 }
 
 const string& node::operator[](const string &attr_name) const {
-	return _attrs.find(attr_name)->second.value;
+	const attribute* found = _attrs.find(attr_name);
+	if (found == 0) throw(ATTRIBUTE_NOT_FOUND);
+	return found->value;
 }
 string& node::operator[](const string &attr_name) {
-	return _attrs.find(attr_name)->second.value;
+	attribute* found = _attrs.find(attr_name);
+	if (found == 0) throw(ATTRIBUTE_NOT_FOUND);
+	return found->value;
 }
 
 
 
 string node::path() const {
-	if (!has_space) return NAMESPACE_DELIMITER + _id;
-	else return space()->path + NAMESPACE_DELIMITER + _id;
+	if (!has_space()) return NAMESPACE_DELIMITER + _id;
+	else return space()->path() + NAMESPACE_DELIMITER + _id;
 }
\ No newline at end of file
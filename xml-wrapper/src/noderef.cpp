@@ -9,10 +9,11 @@ node_ref::node_ref() : node() {
 	_base = 0;
 }
 
-node_ref::node_ref(xml_wrapper* wrapper, node* my_parent, const xml_node* base_node) : node_ref() {
+// References have no children of their own, so the wrapper is not needed to build them
+node_ref::node_ref(xml_wrapper*, node* my_parent, const xml_node* base_node) : node_ref() {
 	const xml_attribute* curr_attr = base_node->first_attribute();
 	while (curr_attr != 0) {
-		add_attr(std::tolower(curr_attr->name(), std::locale()), curr_attr->value());
+		add_attr(lowercase(curr_attr->name()), curr_attr->value());
 		curr_attr = curr_attr->next_attribute();
 	}
 	if (has_attr(ID_STRING)) throw(REF_WITH_ID);
@@ -24,17 +25,18 @@ node_ref::node_ref(xml_wrapper* wrapper, node* my_parent, const xml_node* base_n
 	if (_parent != 0) my_parent->add_child(this);
 }
 
-node_ref::node_ref(node* my_parent, const string &ref_id) {
+node_ref::node_ref(node* my_parent, const string &ref_id) : node_ref() {
 	if (ref_id.size() < MIN_ID_LENGTH) throw(NO_ID);
 	else _base_id = ref_id;
+
+	_parent = my_parent;
+	if (_parent != 0) my_parent->add_child(this);
 }
 
 node_ref::~node_ref() { }
 
-bool node_ref::instanceof(const string& class_name) const {
-	if (class_name == node::classname) return true;
-	if (class_name == node_ref::classname) return true;
-	return false;
+type_mask node_ref::types() const {
+	return node_ref::typemask;
 }
 
 bool node_ref::bound() const {
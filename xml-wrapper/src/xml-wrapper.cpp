@@ -0,0 +1,14 @@
+#include "core.h"
+
+using namespace xml;
+
+void xml_wrapper::freeze_factories() {
+	_factories.freeze();
+}
+
+node* xml_wrapper::create_node(node* parent, const xml_node* base_node) {
+	if (!_factories.frozen()) throw(OTHER_ERROR);
+	const node_factory* factory = _factories.find(base_node->name(), base_node->name_size());
+	if (factory == 0) return new node(this, parent, base_node);
+	return (*factory)(this, parent, base_node);
+}
\ No newline at end of file